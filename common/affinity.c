@@ -0,0 +1,488 @@
+/**
+ *  \file affinity.c
+ *  \brief Implements topology discovery and thread pinning; see
+ *  'affinity.h'.
+ *
+ *  Everything comes from /sys/devices/system/{cpu,node}; if sysfs is
+ *  missing, every online CPU is treated as its own core on socket 0.
+ */
+
+#if !defined (_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <assert.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined (_OPENMP)
+#include <omp.h>
+#endif
+
+#include "affinity.h"
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+#define SYSFS_NODE "/sys/devices/system/node"
+
+int
+readSysfsLine (const char* path, char* buf, size_t len)
+{
+  FILE* fp = fopen (path, "r");
+  if (!fp) return -1;
+  char* s = fgets (buf, (int)len, fp);
+  fclose (fp);
+  return s ? 0 : -1;
+}
+
+int
+parseCpuList (const char* s, void (*visit) (int, void*), void* arg)
+{
+  int max = -1;
+  while (s && *s && *s != '\n') {
+    char* end;
+    long lo = strtol (s, &end, 10), hi = lo;
+    if (end == s) break;
+    if (*end == '-') {
+      s = end + 1;
+      hi = strtol (s, &end, 10);
+    }
+    for (long i = lo; i <= hi; ++i)
+      if (visit) visit ((int)i, arg);
+    if (hi > max) max = (int)hi;
+    s = (*end == ',') ? end + 1 : end;
+  }
+  return max;
+}
+
+/** Reads an integer from a sysfs file, or returns 'def' */
+static long
+readSysfsLong (const char* path, long def)
+{
+  char buf[64];
+  if (readSysfsLine (path, buf, sizeof (buf)))
+    return def;
+  return strtol (buf, NULL, 10);
+}
+
+/* ====================================================================== */
+
+struct list_t
+{
+  int n;
+  int max_n;
+  int* items;
+};
+
+static void
+appendItem (int i, void* arg)
+{
+  struct list_t* L = (struct list_t *)arg;
+  if (L->n < L->max_n)
+    L->items[L->n++] = i;
+}
+
+static void
+countItem (int i, void* arg)
+{
+  (void)i;
+  ++*(int *)arg;
+}
+
+/** Counts the listed indices below i, e.g., in a list of SMT siblings */
+struct rank_t
+{
+  int i;
+  int rank;
+};
+
+static void
+rankItem (int j, void* arg)
+{
+  struct rank_t* R = (struct rank_t *)arg;
+  if (j < R->i) ++R->rank;
+}
+
+/** Parses a size such as "32K" or "30M" into bytes */
+static size_t
+parseSize (const char* s)
+{
+  char* end;
+  size_t bytes = (size_t)strtoul (s, &end, 10);
+  switch (*end) {
+  case 'K': return bytes << 10;
+  case 'M': return bytes << 20;
+  case 'G': return bytes << 30;
+  default: return bytes;
+  }
+}
+
+static void
+discoverCaches (struct topology_t* T)
+{
+  T->n_caches = 0;
+  for (int k = 0; T->n_caches < MAX_CACHES; ++k) {
+    char path[128], buf[256];
+    struct cache_t* c = &T->caches[T->n_caches];
+    snprintf (path, sizeof (path), SYSFS_CPU "/cpu%d/cache/index%d/level",
+              T->cpus[0].cpu, k);
+    if (readSysfsLine (path, buf, sizeof (buf))) break;
+    c->level = atoi (buf);
+
+    snprintf (path, sizeof (path), SYSFS_CPU "/cpu%d/cache/index%d/type",
+              T->cpus[0].cpu, k);
+    if (readSysfsLine (path, c->type, sizeof (c->type)))
+      strcpy (c->type, "Unified");
+    c->type[strcspn (c->type, "\n")] = '\0';
+
+    snprintf (path, sizeof (path), SYSFS_CPU "/cpu%d/cache/index%d/size",
+              T->cpus[0].cpu, k);
+    c->bytes = readSysfsLine (path, buf, sizeof (buf)) ? 0 : parseSize (buf);
+
+    snprintf (path, sizeof (path), SYSFS_CPU "/cpu%d/cache/index%d/shared_cpu_list",
+              T->cpus[0].cpu, k);
+    c->shared_by = 0;
+    if (!readSysfsLine (path, buf, sizeof (buf)))
+      parseCpuList (buf, countItem, &c->shared_by);
+    if (c->shared_by < 1) c->shared_by = 1;
+    ++T->n_caches;
+  }
+}
+
+static void
+discoverTopology (struct topology_t* T)
+{
+  char path[128], buf[1024];
+  struct list_t online;
+  int* core_ids;
+  int* socket_ids;
+
+  /* Online CPUs */
+  online.n = 0;
+  online.max_n = (int)sysconf (_SC_NPROCESSORS_CONF);
+  if (!readSysfsLine (SYSFS_CPU "/online", buf, sizeof (buf))) {
+    int max = parseCpuList (buf, NULL, NULL);
+    if (max + 1 > online.max_n) online.max_n = max + 1;
+  } else {
+    buf[0] = '\0';
+  }
+  if (online.max_n < 1) online.max_n = 1;
+  online.items = (int *)malloc (online.max_n * sizeof (int));
+  assert (online.items);
+  parseCpuList (buf, appendItem, &online);
+  if (!online.n) {
+    long n_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+    for (long i = 0; i < n_cpus && i < online.max_n; ++i)
+      appendItem ((int)i, &online);
+  }
+  if (!online.n)
+    appendItem (0, &online);
+
+  T->n_cpus = online.n;
+  T->cpus = (struct cpu_t *)malloc (T->n_cpus * sizeof (struct cpu_t));
+  core_ids = (int *)malloc (T->n_cpus * sizeof (int));
+  socket_ids = (int *)malloc (T->n_cpus * sizeof (int));
+  assert (T->cpus && core_ids && socket_ids);
+
+  /* Raw package and core ids, and the SMT rank within each core */
+  for (int i = 0; i < T->n_cpus; ++i) {
+    struct cpu_t* c = &T->cpus[i];
+    struct rank_t R;
+    c->cpu = online.items[i];
+    c->node = 0;
+    snprintf (path, sizeof (path), SYSFS_CPU "/cpu%d/topology/physical_package_id", c->cpu);
+    socket_ids[i] = (int)readSysfsLong (path, 0);
+    snprintf (path, sizeof (path), SYSFS_CPU "/cpu%d/topology/core_id", c->cpu);
+    core_ids[i] = (int)readSysfsLong (path, c->cpu);
+    snprintf (path, sizeof (path), SYSFS_CPU "/cpu%d/topology/thread_siblings_list", c->cpu);
+    R.i = c->cpu;
+    R.rank = 0;
+    if (!readSysfsLine (path, buf, sizeof (buf)))
+      parseCpuList (buf, rankItem, &R);
+    c->smt = R.rank;
+  }
+
+  /* Renumber sockets 0, 1, ..., and cores 0, 1, ... within each socket */
+  T->n_sockets = 0;
+  T->n_cores = 0;
+  for (int i = 0; i < T->n_cpus; ++i) {
+    int socket = 0, core = 0, first = 1;
+    for (int j = 0; j < T->n_cpus; ++j) {
+      if (j < i && socket_ids[j] == socket_ids[i])
+        first = 0;
+      if (socket_ids[j] < socket_ids[i]) {
+        /* Count each lower package once, at its first CPU */
+        int k = 0;
+        while (socket_ids[k] != socket_ids[j]) ++k;
+        if (k == j) ++socket;
+      } else if (socket_ids[j] == socket_ids[i] && T->cpus[j].smt == 0
+                 && core_ids[j] < core_ids[i]) {
+        ++core;
+      }
+    }
+    T->cpus[i].socket = socket;
+    T->cpus[i].core = core;
+    if (first) ++T->n_sockets;
+    if (T->cpus[i].smt == 0) ++T->n_cores;
+  }
+  if (!T->n_cores) T->n_cores = T->n_cpus;
+
+  /* NUMA nodes */
+  T->n_nodes = 1;
+  if (!readSysfsLine (SYSFS_NODE "/online", buf, sizeof (buf)))
+    T->n_nodes = parseCpuList (buf, NULL, NULL) + 1;
+  if (T->n_nodes < 1) T->n_nodes = 1;
+  for (int k = 0; k < T->n_nodes; ++k) {
+    struct list_t L;
+    L.n = 0;
+    L.max_n = online.max_n;
+    L.items = core_ids; /* reused as scratch */
+    snprintf (path, sizeof (path), SYSFS_NODE "/node%d/cpulist", k);
+    if (readSysfsLine (path, buf, sizeof (buf))) continue;
+    if (L.max_n > T->n_cpus) L.max_n = T->n_cpus;
+    parseCpuList (buf, appendItem, &L);
+    for (int j = 0; j < L.n; ++j)
+      for (int i = 0; i < T->n_cpus; ++i)
+        if (T->cpus[i].cpu == L.items[j])
+          T->cpus[i].node = k;
+  }
+
+  discoverCaches (T);
+
+  free (socket_ids);
+  free (core_ids);
+  free (online.items);
+}
+
+const struct topology_t *
+getTopology (void)
+{
+  static struct topology_t T;
+  static int is_init = 0;
+  if (!is_init) {
+    discoverTopology (&T);
+    is_init = 1;
+  }
+  return &T;
+}
+
+void
+printTopology (FILE* fp)
+{
+  const struct topology_t* T = getTopology ();
+  fprintf (fp, "Topology: %d socket(s), %d core(s), %d logical CPU(s), %d NUMA node(s)\n",
+           T->n_sockets, T->n_cores, T->n_cpus, T->n_nodes);
+  for (int k = 0; k < T->n_caches; ++k) {
+    const struct cache_t* c = &T->caches[k];
+    fprintf (fp, "  L%d %-11s %8lu KiB, shared by %d CPU(s)\n",
+             c->level, c->type, (unsigned long)(c->bytes >> 10), c->shared_by);
+  }
+}
+
+size_t
+getCacheBytes (int level)
+{
+  const struct topology_t* T = getTopology ();
+  for (int k = 0; k < T->n_caches; ++k)
+    if (T->caches[k].level == level && strcmp (T->caches[k].type, "Instruction"))
+      return T->caches[k].bytes;
+  return 0;
+}
+
+int
+getLastCacheLevel (void)
+{
+  const struct topology_t* T = getTopology ();
+  int level = 0;
+  for (int k = 0; k < T->n_caches; ++k)
+    if (T->caches[k].level > level)
+      level = T->caches[k].level;
+  return level;
+}
+
+/* ====================================================================== */
+
+static const char* layout_names[NUM_LAYOUTS] = { "none", "compact", "scatter", "cores" };
+
+int
+parseLayout (const char* s, layout_t* layout)
+{
+  assert (s && layout);
+  for (int k = 0; k < NUM_LAYOUTS; ++k)
+    if (!strcmp (s, layout_names[k])) {
+      *layout = (layout_t)k;
+      return 0;
+    }
+  return -1;
+}
+
+const char *
+getLayoutName (layout_t layout)
+{
+  assert (layout >= 0 && layout < NUM_LAYOUTS);
+  return layout_names[layout];
+}
+
+/** Orders CPUs by socket, then core, then SMT thread. */
+static int
+compareCompact (const void* a, const void* b)
+{
+  const struct cpu_t* x = (const struct cpu_t *)a;
+  const struct cpu_t* y = (const struct cpu_t *)b;
+  if (x->socket != y->socket) return x->socket - y->socket;
+  if (x->core != y->core) return x->core - y->core;
+  if (x->smt != y->smt) return x->smt - y->smt;
+  return x->cpu - y->cpu;
+}
+
+/** Orders CPUs by SMT thread, then core, then socket. */
+static int
+compareScatter (const void* a, const void* b)
+{
+  const struct cpu_t* x = (const struct cpu_t *)a;
+  const struct cpu_t* y = (const struct cpu_t *)b;
+  if (x->smt != y->smt) return x->smt - y->smt;
+  if (x->core != y->core) return x->core - y->core;
+  if (x->socket != y->socket) return x->socket - y->socket;
+  return x->cpu - y->cpu;
+}
+
+/**
+ *  Writes, to 'order', the CPUs of node 'node' (all if node < 0) in
+ *  the order in which the layout assigns them; returns their number.
+ *  LAYOUT_NONE gets every CPU, in compact order.
+ */
+static int
+getLayoutOrder (layout_t layout, int node, int* order)
+{
+  const struct topology_t* T = getTopology ();
+  struct cpu_t* cpus = (struct cpu_t *)malloc (T->n_cpus * sizeof (struct cpu_t));
+  int m = 0;
+  assert (cpus);
+  for (int i = 0; i < T->n_cpus; ++i) {
+    if (node >= 0 && T->cpus[i].node != node) continue;
+    if (layout == LAYOUT_CORES && T->cpus[i].smt) continue;
+    cpus[m++] = T->cpus[i];
+  }
+  qsort (cpus, m, sizeof (struct cpu_t),
+         layout == LAYOUT_SCATTER ? compareScatter : compareCompact);
+  for (int i = 0; i < m; ++i)
+    order[i] = cpus[i].cpu;
+  free (cpus);
+  return m;
+}
+
+int
+getLayoutCpus (layout_t layout, int node, int n, int* cpus)
+{
+  const struct topology_t* T = getTopology ();
+  int* order;
+  int m;
+  if (layout == LAYOUT_NONE) return 0;
+  order = (int *)malloc (T->n_cpus * sizeof (int));
+  assert (order);
+  m = getLayoutOrder (layout, node, order);
+  if (!m) /* no such node */
+    m = getLayoutOrder (layout, -1, order);
+  for (int t = 0; t < n; ++t)
+    cpus[t] = order[t % m];
+  free (order);
+  return m;
+}
+
+void
+pinThreads (layout_t layout, int node)
+{
+  const struct topology_t* T;
+  int* order;
+  int m;
+  /* Nothing asked for: keep any pinning from outside (GOMP_CPU_AFFINITY,
+     OMP_PROC_BIND, numactl, taskset) */
+  if (layout == LAYOUT_NONE && node < 0)
+    return;
+  T = getTopology ();
+  order = (int *)malloc (T->n_cpus * sizeof (int));
+  assert (order);
+  m = getLayoutOrder (layout, node, order);
+  if (!m)
+    m = getLayoutOrder (layout, -1, order);
+
+#pragma omp parallel default(none) shared(order,m,layout)
+  {
+    int tid = 0;
+    cpu_set_t set;
+#if defined (_OPENMP)
+    tid = omp_get_thread_num ();
+#endif
+    CPU_ZERO (&set);
+    if (layout == LAYOUT_NONE) {
+      for (int i = 0; i < m; ++i)
+        if (order[i] < CPU_SETSIZE) CPU_SET (order[i], &set);
+    } else if (order[tid % m] < CPU_SETSIZE) {
+      CPU_SET (order[tid % m], &set);
+    }
+    if (sched_setaffinity (0, sizeof (set), &set))
+      perror ("sched_setaffinity");
+  }
+  free (order);
+}
+
+void
+printThreadMapping (FILE* fp)
+{
+  const struct topology_t* T = getTopology ();
+  int n_threads = 1;
+  int* where;
+#if defined (_OPENMP)
+  n_threads = omp_get_max_threads ();
+#endif
+  where = (int *)malloc (n_threads * sizeof (int));
+  assert (where);
+
+#pragma omp parallel default(none) shared(where,n_threads)
+  {
+    int tid = 0;
+#if defined (_OPENMP)
+    tid = omp_get_thread_num ();
+#pragma omp master
+    n_threads = omp_get_num_threads ();
+#endif
+    where[tid] = sched_getcpu ();
+  }
+
+  fprintf (fp, "Thread mapping (%d thread(s)):\n", n_threads);
+  for (int t = 0; t < n_threads; ++t) {
+    const struct cpu_t* c = NULL;
+    for (int i = 0; i < T->n_cpus; ++i)
+      if (T->cpus[i].cpu == where[t])
+        c = &T->cpus[i];
+    if (c)
+      fprintf (fp, "  thread %3d -> cpu %3d (socket %d, core %d, smt %d, node %d)\n",
+               t, c->cpu, c->socket, c->core, c->smt, c->node);
+    else
+      fprintf (fp, "  thread %3d -> cpu %3d\n", t, where[t]);
+  }
+  free (where);
+}
+
+layout_t
+setupAffinity (const char* name)
+{
+  layout_t layout = LAYOUT_NONE;
+  if (!name)
+    name = getenv ("AFFINITY");
+  if (name && parseLayout (name, &layout)) {
+    fprintf (stderr, "*** Unknown thread layout, '%s'; expected none, compact, scatter, or cores. ***\n",
+             name);
+    layout = LAYOUT_NONE;
+  }
+  if (layout != LAYOUT_NONE)
+    pinThreads (layout, -1);
+  printTopology (stderr);
+  fprintf (stderr, "Thread layout: %s\n", getLayoutName (layout));
+  printThreadMapping (stderr);
+  return layout;
+}
+
+/* eof */
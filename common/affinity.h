@@ -0,0 +1,139 @@
+/**
+ *  \file affinity.h
+ *  \brief Discovers the machine topology from sysfs and pins OpenMP
+ *  threads to CPUs in a few standard layouts.
+ */
+
+#if !defined (INC_AFFINITY_H)
+#define INC_AFFINITY_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/** One logical CPU (hardware thread) */
+struct cpu_t
+{
+  int cpu;    /*!< OS CPU number */
+  int socket; /*!< Physical package */
+  int core;   /*!< Core number within the socket: 0, 1, 2, ... */
+  int smt;    /*!< Hardware thread number within the core: 0, 1, ... */
+  int node;   /*!< NUMA node */
+};
+
+/** One level of the cache hierarchy, as seen by CPU 0 */
+struct cache_t
+{
+  int level;        /*!< 1, 2, 3, ... */
+  char type[16];    /*!< "Data", "Instruction", or "Unified" */
+  size_t bytes;     /*!< Capacity of one instance */
+  int shared_by;    /*!< Number of logical CPUs sharing one instance */
+};
+
+#define MAX_CACHES 8
+
+struct topology_t
+{
+  int n_cpus;
+  struct cpu_t* cpus; /*!< Sorted by 'cpu' */
+  int n_sockets;
+  int n_cores;        /*!< Physical cores, over all sockets */
+  int n_nodes;
+  int n_caches;
+  struct cache_t caches[MAX_CACHES];
+};
+
+/** Returns the (cached) topology of the machine; never NULL. */
+const struct topology_t* getTopology (void);
+
+/** Prints a summary of the topology. */
+void printTopology (FILE* fp);
+
+/**
+ *  Returns the capacity, in bytes, of one instance of the data (or
+ *  unified) cache at the given level, or 0 if there is none.
+ */
+size_t getCacheBytes (int level);
+
+/** Returns the level of the last-level cache, or 0 if unknown. */
+int getLastCacheLevel (void);
+
+/* ====================================================================== */
+
+typedef enum
+{
+  LAYOUT_NONE = 0, /*!< Leave placement to the OS */
+  LAYOUT_COMPACT,  /*!< Fill each core, then each socket, in order */
+  LAYOUT_SCATTER,  /*!< Round-robin over sockets, SMT siblings last */
+  LAYOUT_CORES     /*!< One thread per physical core, socket by socket */
+} layout_t;
+
+#define NUM_LAYOUTS 4
+
+/**
+ *  Parses "none", "compact", "scatter", or "cores"; returns 0 on
+ *  success.
+ */
+int parseLayout (const char* s, layout_t* layout);
+
+/** Returns the name of a layout, as accepted by parseLayout(). */
+const char* getLayoutName (layout_t layout);
+
+/**
+ *  Fills cpus[0:n-1] with the CPUs on which threads 0..n-1 would run
+ *  under the given layout, using only the CPUs of NUMA node 'node'
+ *  (or all CPUs if node < 0) and wrapping around if n exceeds the
+ *  number of CPUs the layout uses. Returns that number of distinct
+ *  CPUs, or 0 for LAYOUT_NONE.
+ */
+int getLayoutCpus (layout_t layout, int node, int n, int* cpus);
+
+/**
+ *  Pins each thread of the current OpenMP team size (see
+ *  omp_set_num_threads()) to one CPU of node 'node' (all nodes if
+ *  node < 0) under the given layout. Under LAYOUT_NONE, lets every
+ *  thread run on any CPU of the node, or, if node < 0, leaves the
+ *  threads' affinity alone, as set by the OpenMP runtime or by
+ *  numactl or taskset.
+ */
+void pinThreads (layout_t layout, int node);
+
+/**
+ *  Prints the CPU, socket, core, and SMT thread on which each OpenMP
+ *  thread is running.
+ */
+void printThreadMapping (FILE* fp);
+
+/**
+ *  Convenience for drivers: parses 'name' (or, if NULL, the
+ *  AFFINITY environment variable), pins the threads, and prints the
+ *  topology and thread mapping to stderr. Returns the layout, or
+ *  LAYOUT_NONE if the name is missing or invalid.
+ */
+layout_t setupAffinity (const char* name);
+
+/* ====================================================================== */
+
+/**
+ *  Reads the first line of a (sysfs) file into buf. Returns 0 on
+ *  success.
+ */
+int readSysfsLine (const char* path, char* buf, size_t len);
+
+/**
+ *  Parses a Linux "cpulist"-style string, e.g., "0-5,12-17", calling
+ *  'visit (i, arg)' for every listed index. Returns the largest index
+ *  seen, or -1 if none.
+ */
+int parseCpuList (const char* s, void (*visit) (int, void*), void* arg);
+
+#if defined (__cplusplus)
+} // extern "C"
+#endif
+
+#endif
+
+/* eof */
@@ -0,0 +1,259 @@
+/**
+ *  \file bench.c
+ *  \brief Implements the benchmark harness; see 'bench.h'.
+ *
+ *  The bootstrap draws from its own generator, with a fixed seed, so
+ *  that it neither disturbs the drivers' drand48() streams nor makes
+ *  MPI processes disagree about when to stop.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/** Checks the CI again only once the trials grow by this factor */
+#define BENCH_CHECK_GROWTH 1.1
+
+static void
+getEnvSize (const char* name, size_t* x)
+{
+  const char* s = getenv (name);
+  if (s && *s) {
+    long v = atol (s);
+    assert (v >= 0);
+    *x = (size_t)v;
+  }
+}
+
+static void
+getEnvReal (const char* name, long double* x)
+{
+  const char* s = getenv (name);
+  if (s && *s) {
+    *x = strtold (s, NULL);
+    assert (*x >= 0);
+  }
+}
+
+void
+benchDefaults (bench_config_t* C)
+{
+  assert (C);
+  C->warmup = 1;
+  C->min_trials = 3;
+  C->max_trials = 100;
+  C->min_time = 0;
+  C->target = 0.02;
+  C->confidence = 0.95;
+  C->resamples = 1000;
+  getEnvSize ("BENCH_WARMUP", &C->warmup);
+  getEnvSize ("BENCH_MIN_TRIALS", &C->min_trials);
+  getEnvSize ("BENCH_MAX_TRIALS", &C->max_trials);
+  getEnvReal ("BENCH_MIN_TIME", &C->min_time);
+  getEnvReal ("BENCH_TARGET", &C->target);
+  if (C->min_trials < 1) C->min_trials = 1;
+  if (C->max_trials < C->min_trials) C->max_trials = C->min_trials;
+}
+
+void
+printBenchConfig (FILE* fp, const bench_config_t* C)
+{
+  assert (C);
+  fprintf (fp, "Trials: %lu warm-up, then %lu to %lu",
+	   (unsigned long)C->warmup, (unsigned long)C->min_trials,
+	   (unsigned long)C->max_trials);
+  if (C->min_time > 0)
+    fprintf (fp, ", at least %Lg s", C->min_time);
+  if (C->target > 0 && C->max_trials > C->min_trials)
+    fprintf (fp, ", until the median is within +/- %Lg%% (%Lg%% CI)",
+	     100 * C->target, 100 * C->confidence);
+  fprintf (fp, "\n");
+}
+
+/* ====================================================================== */
+
+static int
+compareTimes (const void* a, const void* b)
+{
+  const long double x = *(const long double *)a, y = *(const long double *)b;
+  return (x > y) - (x < y);
+}
+
+/** Returns the median of the n sorted values of x */
+static long double
+medianOfSorted (const long double* x, size_t n)
+{
+  assert (n > 0);
+  return (n % 2) ? x[n/2] : 0.5L * (x[n/2 - 1] + x[n/2]);
+}
+
+/** xorshift64*, for the bootstrap */
+static uint64_t
+nextRandom (uint64_t* state)
+{
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ *  Computes the percentile bootstrap CI of the median of x[0:n-1],
+ *  from 'resamples' resamples with replacement.
+ */
+static void
+bootstrapMedian (const long double* x, size_t n, size_t resamples,
+		 long double confidence, long double* lo, long double* hi)
+{
+  long double* medians;
+  long double* sample;
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  size_t b, i, k;
+
+  if (n < 2 || !resamples) {
+    *lo = *hi = x[0];
+    return;
+  }
+  medians = (long double *)malloc (resamples * sizeof (long double));
+  sample = (long double *)malloc (n * sizeof (long double));
+  assert (medians && sample);
+  for (b = 0; b < resamples; ++b) {
+    for (i = 0; i < n; ++i)
+      sample[i] = x[nextRandom (&state) % n];
+    qsort (sample, n, sizeof (long double), compareTimes);
+    medians[b] = medianOfSorted (sample, n);
+  }
+  qsort (medians, resamples, sizeof (long double), compareTimes);
+  k = (size_t)floorl ((1 - confidence) / 2 * (resamples - 1));
+  *lo = medians[k];
+  *hi = medians[resamples - 1 - k];
+  free (sample);
+  free (medians);
+}
+
+/** Computes the statistics of R->times[0:R->n-1] */
+static void
+computeStats (const bench_config_t* C, bench_result_t* R)
+{
+  const size_t n = R->n;
+  long double* dev;
+  size_t i;
+
+  assert (n > 0);
+  R->sorted = (long double *)realloc (R->sorted, n * sizeof (long double));
+  dev = (long double *)malloc (n * sizeof (long double));
+  assert (R->sorted && dev);
+  memcpy (R->sorted, R->times, n * sizeof (long double));
+  qsort (R->sorted, n, sizeof (long double), compareTimes);
+
+  R->min = R->sorted[0];
+  R->max = R->sorted[n-1];
+  R->mean = 0;
+  for (i = 0; i < n; ++i)
+    R->mean += R->times[i];
+  R->mean /= n;
+  R->median = medianOfSorted (R->sorted, n);
+  for (i = 0; i < n; ++i)
+    dev[i] = fabsl (R->times[i] - R->median);
+  qsort (dev, n, sizeof (long double), compareTimes);
+  R->mad = medianOfSorted (dev, n);
+  free (dev);
+
+  bootstrapMedian (R->times, n, C->resamples, C->confidence, &R->ci_lo, &R->ci_hi);
+  R->converged = (C->target <= 0)
+    || (R->ci_hi - R->ci_lo <= 2 * C->target * R->median);
+}
+
+void
+benchStats (const bench_config_t* C, const long double* times, size_t n,
+	    bench_result_t* R)
+{
+  assert (C && R && times && n > 0);
+  memset (R, 0, sizeof (bench_result_t));
+  R->times = (long double *)malloc (n * sizeof (long double));
+  assert (R->times);
+  memcpy (R->times, times, n * sizeof (long double));
+  R->n = n;
+  computeStats (C, R);
+}
+
+void
+benchRun (const bench_config_t* C, const bench_task_t* task,
+	  struct stopwatch_t* timer, bench_result_t* R)
+{
+  long double t_sum = 0;
+  size_t k, next_check;
+
+  assert (C && task && task->run && timer && R);
+  memset (R, 0, sizeof (bench_result_t));
+  R->times = (long double *)malloc (C->max_trials * sizeof (long double));
+  assert (R->times);
+
+  for (k = 0; k < C->warmup; ++k) {
+    if (task->setup) task->setup (task->arg);
+    task->run (task->arg);
+    if (task->teardown) task->teardown (task->arg);
+  }
+
+  stopwatch_reset (timer);
+  next_check = C->min_trials;
+  for (k = 0; k < C->max_trials; ) {
+    long double t;
+    if (task->setup) task->setup (task->arg);
+    stopwatch_start (timer);
+    task->run (task->arg);
+    t = stopwatch_stop (timer);
+    if (task->teardown) task->teardown (task->arg);
+    if (task->reduce) t = task->reduce (t, task->arg);
+    R->times[k++] = t;
+    t_sum += t;
+
+    if (k < next_check || t_sum < C->min_time)
+      continue;
+    if (C->target <= 0)
+      break;
+    R->n = k;
+    computeStats (C, R);
+    if (R->converged)
+      break;
+    next_check = (size_t)(k * BENCH_CHECK_GROWTH);
+    if (next_check <= k) next_check = k + 1;
+  }
+  if (R->n != k) {
+    R->n = k;
+    computeStats (C, R);
+  }
+}
+
+long double
+benchPercentile (const bench_result_t* R, double p)
+{
+  long double pos, frac;
+  size_t i;
+  assert (R && R->n > 0 && p >= 0 && p <= 1);
+  pos = p * (R->n - 1);
+  i = (size_t)pos;
+  if (i + 1 >= R->n)
+    return R->sorted[R->n - 1];
+  frac = pos - i;
+  return R->sorted[i] + frac * (R->sorted[i+1] - R->sorted[i]);
+}
+
+void
+benchRelease (bench_result_t* R)
+{
+  if (R) {
+    free (R->sorted);
+    free (R->times);
+    memset (R, 0, sizeof (bench_result_t));
+  }
+}
+
+/* eof */
@@ -0,0 +1,104 @@
+/**
+ *  \file bench.h
+ *  \brief Benchmark harness shared by the lab drivers: warm-up runs,
+ *  then timed trials until the median is known to a given precision,
+ *  with robust summary statistics.
+ *
+ *  A benchmark is a set of hooks: 'setup' and 'teardown' run around
+ *  each trial, outside the timed region (e.g., to rebuild the input,
+ *  or to flush the cache); 'run' is the timed code. After the
+ *  min_trials-th trial, the harness computes a bootstrap confidence
+ *  interval of the median, and stops once its half-width is within
+ *  'target' of the median (or at max_trials).
+ *
+ *  Under MPI, a 'reduce' hook combines each trial's time over the
+ *  processes (e.g., the max over ranks); every process then sees the
+ *  same times, and so stops after the same trial.
+ */
+
+#if !defined (INC_BENCH_H)
+#define INC_BENCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "timer.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/** How many trials to run */
+typedef struct
+{
+  size_t warmup;          /*!< Untimed runs before the trials */
+  size_t min_trials;
+  size_t max_trials;
+  long double min_time;   /*!< Run at least this many seconds of trials */
+  long double target;     /*!< Relative half-width of the median's CI to stop at; 0: stop at min_trials */
+  long double confidence; /*!< Of the CI, e.g., 0.95 */
+  size_t resamples;       /*!< Bootstrap resamples per CI */
+} bench_config_t;
+
+/** The hooks of a benchmark; all but 'run' may be NULL */
+typedef struct
+{
+  void (*setup) (void* arg);
+  void (*run) (void* arg);
+  void (*teardown) (void* arg);
+  long double (*reduce) (long double t, void* arg);
+  void* arg;
+} bench_task_t;
+
+/** The times of a benchmark's trials, and their statistics (seconds) */
+typedef struct
+{
+  size_t n;             /*!< Trials run */
+  long double* times;   /*!< In the order run */
+  long double* sorted;  /*!< In increasing order */
+  long double min, max, mean;
+  long double median;
+  long double mad;      /*!< Median absolute deviation from the median */
+  long double ci_lo, ci_hi; /*!< Bootstrap CI of the median */
+  int converged;        /*!< Whether the CI met the target */
+} bench_result_t;
+
+/**
+ *  Sets the defaults: 1 warm-up run, 3 to 100 trials, no minimum time,
+ *  and a +/- 2% target at 95% confidence. The environment variables
+ *  BENCH_WARMUP, BENCH_MIN_TRIALS, BENCH_MAX_TRIALS, BENCH_MIN_TIME,
+ *  and BENCH_TARGET override them.
+ */
+void benchDefaults (bench_config_t* C);
+
+/** Prints the configuration on one line. */
+void printBenchConfig (FILE* fp, const bench_config_t* C);
+
+/**
+ *  Runs the benchmark under configuration C, timing each trial with
+ *  'timer' (whose total then covers just these trials), and stores
+ *  the times and their statistics in R; release R with
+ *  benchRelease().
+ */
+void benchRun (const bench_config_t* C, const bench_task_t* task,
+	       struct stopwatch_t* timer, bench_result_t* R);
+
+/**
+ *  Computes the statistics of n times measured some other way, as
+ *  benchRun() would (the CI with C's confidence and resamples).
+ */
+void benchStats (const bench_config_t* C, const long double* times, size_t n,
+		 bench_result_t* R);
+
+/** Returns the p-th quantile (0 <= p <= 1) of the times, interpolated. */
+long double benchPercentile (const bench_result_t* R, double p);
+
+void benchRelease (bench_result_t* R);
+
+#if defined (__cplusplus)
+} // extern "C"
+#endif
+
+#endif
+
+/* eof */
@@ -0,0 +1,327 @@
+/**
+ *  \file hugepages.c
+ *  \brief Implements the huge-page allocator; see 'hugepages.h'.
+ *
+ *  Every array is its own anonymous mmap() region, recorded in a
+ *  small list so that freePages() and the reports know its length and
+ *  the kind of pages it got.
+ */
+
+#if !defined (_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "hugepages.h"
+
+#define THP_BYTES ((size_t)2 << 20) /*!< Transparent huge page size (x86-64) */
+
+#if defined (MAP_HUGETLB) && !defined (MAP_HUGE_SHIFT)
+#  define MAP_HUGE_SHIFT 26
+#endif
+#if defined (MAP_HUGETLB) && !defined (MAP_HUGE_2MB)
+#  define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#if defined (MAP_HUGETLB) && !defined (MAP_HUGE_1GB)
+#  define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+static const char* page_kind_names[NUM_PAGE_KINDS] = {
+  "default", "4k", "thp", "2m", "1g"
+};
+
+static page_kind_t default_kind__ = PAGES_DEFAULT;
+
+/** One array from allocPages() */
+struct mapping_t
+{
+  void* addr;
+  size_t len;            /*!< Bytes mapped, a multiple of the page size */
+  size_t bytes;          /*!< Bytes requested */
+  page_kind_t requested;
+  page_kind_t obtained;
+  struct mapping_t* next;
+};
+
+static struct mapping_t* mappings__ = NULL;
+
+/* ====================================================================== */
+
+int
+parsePageKind (const char* s, page_kind_t* kind)
+{
+  int k;
+  assert (kind);
+  if (!s) return -1;
+  for (k = 0; k < NUM_PAGE_KINDS; ++k)
+    if (!strcasecmp (s, page_kind_names[k])) {
+      *kind = (page_kind_t)k;
+      return 0;
+    }
+  return -1;
+}
+
+const char *
+getPageKindName (page_kind_t kind)
+{
+  return (kind >= 0 && kind < NUM_PAGE_KINDS) ? page_kind_names[kind] : "?";
+}
+
+void
+setDefaultPageKind (page_kind_t kind)
+{
+  assert (kind >= 0 && kind < NUM_PAGE_KINDS);
+  default_kind__ = kind;
+}
+
+page_kind_t
+getDefaultPageKind (void)
+{
+  return default_kind__;
+}
+
+int
+setupPageKind (const char* name)
+{
+  page_kind_t kind = PAGES_DEFAULT;
+  if (!name)
+    name = getenv ("PAGES");
+  if (name && parsePageKind (name, &kind)) {
+    fprintf (stderr, "*** Unknown page kind, '%s'; expected default, 4k, thp, 2m, or 1g. ***\n",
+             name);
+    return -1;
+  }
+  setDefaultPageKind (kind);
+  fprintf (stderr, "Pages: %s\n", getPageKindName (kind));
+  return 0;
+}
+
+/* ====================================================================== */
+
+static size_t
+getBasePageBytes (void)
+{
+  return (size_t)sysconf (_SC_PAGESIZE);
+}
+
+static size_t
+getPageBytes (page_kind_t kind)
+{
+  switch (kind) {
+  case PAGES_THP: return THP_BYTES;
+  case PAGES_2M: return (size_t)2 << 20;
+  case PAGES_1G: return (size_t)1 << 30;
+  default: return getBasePageBytes ();
+  }
+}
+
+static size_t
+roundUp (size_t bytes, size_t page)
+{
+  return (bytes + page - 1) / page * page;
+}
+
+/** Maps 'len' bytes of explicit huge pages, or returns NULL if the pool cannot supply them */
+static void *
+mapHugetlb (size_t len, page_kind_t kind)
+{
+#if defined (MAP_HUGETLB)
+  const int size_flag = (kind == PAGES_1G) ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+  void* p = mmap (NULL, len, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | size_flag, -1, 0);
+  return (p == MAP_FAILED) ? NULL : p;
+#else
+  (void)len; (void)kind;
+  return NULL;
+#endif
+}
+
+/**
+ *  Maps 'len' bytes of base pages aligned to 'align', by over-mapping
+ *  and trimming the ends, so that whole huge pages fit in the range.
+ */
+static void *
+mapAligned (size_t len, size_t align)
+{
+  const size_t base = getBasePageBytes ();
+  const size_t extra = (align > base) ? align : 0;
+  char* p = (char *)mmap (NULL, len + extra, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  char* q;
+  if (p == (char *)MAP_FAILED) return NULL;
+  q = (char *)roundUp ((size_t)p, align > base ? align : base);
+  if (q > p) munmap (p, q - p);
+  if (p + len + extra > q + len) munmap (q + len, p + len + extra - (q + len));
+  return q;
+}
+
+/** Prints a fallback warning once per requested kind */
+static void
+warnFallback (page_kind_t requested, page_kind_t obtained)
+{
+  static int warned[NUM_PAGE_KINDS] = { 0 };
+  if (warned[requested]) return;
+  warned[requested] = 1;
+  fprintf (stderr, "*** No %s huge pages available (see /proc/sys/vm/nr_hugepages"
+           " and /sys/kernel/mm/hugepages); falling back to %s. ***\n",
+           getPageKindName (requested), getPageKindName (obtained));
+}
+
+void *
+allocPages (size_t bytes, page_kind_t kind)
+{
+  struct mapping_t* M = (struct mapping_t *)malloc (sizeof (struct mapping_t));
+  page_kind_t got = kind;
+  void* p = NULL;
+  assert (M);
+  if (!bytes) bytes = 1;
+
+  /* Explicit pages: 1 GiB, else 2 MiB, else transparent */
+  if (got == PAGES_1G) {
+    p = mapHugetlb (roundUp (bytes, getPageBytes (PAGES_1G)), PAGES_1G);
+    if (!p) got = PAGES_2M;
+  }
+  if (!p && got == PAGES_2M) {
+    p = mapHugetlb (roundUp (bytes, getPageBytes (PAGES_2M)), PAGES_2M);
+    if (!p) got = PAGES_THP;
+  }
+  if (got != kind)
+    warnFallback (kind, got);
+
+  if (!p) {
+    p = mapAligned (roundUp (bytes, getPageBytes (got)), getPageBytes (got));
+    assert (p);
+#if defined (MADV_HUGEPAGE)
+    if (got == PAGES_THP || got == PAGES_4K) {
+      const int advice = (got == PAGES_THP) ? MADV_HUGEPAGE : MADV_NOHUGEPAGE;
+      if (madvise (p, roundUp (bytes, getPageBytes (got)), advice))
+        perror ("madvise");
+    }
+#endif
+  }
+
+  M->addr = p;
+  M->len = roundUp (bytes, getPageBytes (got));
+  M->bytes = bytes;
+  M->requested = kind;
+  M->obtained = got;
+  M->next = mappings__;
+  mappings__ = M;
+  return p;
+}
+
+/** Returns the record of an array from allocPages(), or NULL */
+static const struct mapping_t *
+findMapping (const void* p)
+{
+  const struct mapping_t* M;
+  for (M = mappings__; M; M = M->next)
+    if (M->addr == p)
+      return M;
+  return NULL;
+}
+
+void
+freePages (void* p)
+{
+  struct mapping_t** link;
+  if (!p) return;
+  for (link = &mappings__; *link; link = &(*link)->next) {
+    struct mapping_t* M = *link;
+    if (M->addr == p) {
+      int err = munmap (M->addr, M->len);
+      assert (!err);
+      *link = M->next;
+      free (M);
+      return;
+    }
+  }
+  assert (0 && "freePages: not from allocPages()");
+}
+
+void *
+growPages (void* p, size_t bytes, page_kind_t kind)
+{
+  size_t len = 0;
+  if (p) {
+    const struct mapping_t* M = findMapping (p);
+    assert (M && "growPages: not from allocPages()");
+    if (M->requested == kind && M->len >= bytes)
+      return p;
+    len = M->len;
+    freePages (p);
+  }
+  return allocPages ((bytes > 2 * len) ? bytes : 2 * len, kind);
+}
+
+page_kind_t
+getPageKind (const void* p)
+{
+  const struct mapping_t* M = findMapping (p);
+  return M ? M->obtained : PAGES_DEFAULT;
+}
+
+/* ====================================================================== */
+
+/**
+ *  Sums 'AnonHugePages' over the /proc/self/smaps entries that
+ *  overlap [lo, lo+len). The kernel may merge an array's mapping with
+ *  a neighbouring one that has the same flags, so the sum is clamped
+ *  to 'len'; it is exact for arrays with their own mapping.
+ */
+static size_t
+getAnonHugeBytes (const void* lo, size_t len)
+{
+  FILE* fp = fopen ("/proc/self/smaps", "r");
+  const unsigned long a = (unsigned long)lo, b = a + len;
+  size_t huge = 0;
+  int in_range = 0;
+  char line[256];
+  if (!fp) return 0;
+  while (fgets (line, sizeof (line), fp)) {
+    unsigned long start, end, kb;
+    if (sscanf (line, "%lx-%lx ", &start, &end) == 2)
+      in_range = (start < b && end > a);
+    else if (in_range && sscanf (line, "AnonHugePages: %lu kB", &kb) == 1)
+      huge += (size_t)kb << 10;
+  }
+  fclose (fp);
+  return (huge < len) ? huge : len;
+}
+
+size_t
+getHugePageBytes (const void* p)
+{
+  const struct mapping_t* M = findMapping (p);
+  if (!M) return 0;
+  if (M->obtained == PAGES_2M || M->obtained == PAGES_1G)
+    return M->len;
+  return getAnonHugeBytes (M->addr, M->len);
+}
+
+void
+printPageReport (FILE* fp, const char* name, const void* p)
+{
+  const struct mapping_t* M = findMapping (p);
+  size_t huge, page;
+  if (!M) {
+    fprintf (fp, "# %s: not from allocPages()\n", name);
+    return;
+  }
+  huge = getHugePageBytes (p);
+  page = (M->obtained == PAGES_1G) ? getPageBytes (PAGES_1G) : THP_BYTES;
+  fprintf (fp, "# %s: %s pages (requested %s); %lu of %lu KiB on huge pages"
+           " (%.1f%%, %lu x %lu KiB)\n",
+           name, getPageKindName (M->obtained), getPageKindName (M->requested),
+           (unsigned long)(huge >> 10), (unsigned long)(M->len >> 10),
+           100.0 * huge / M->len,
+           (unsigned long)(huge / page), (unsigned long)(page >> 10));
+}
+
+/* eof */
@@ -0,0 +1,105 @@
+/**
+ *  \file hugepages.h
+ *  \brief Allocates benchmark arrays on 4 KiB, transparent huge, or
+ *  explicit (hugetlbfs) 2 MiB or 1 GiB pages, and reports how much of
+ *  an array the kernel actually backed with huge pages.
+ */
+
+#if !defined (INC_HUGEPAGES_H)
+#define INC_HUGEPAGES_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+typedef enum
+{
+  PAGES_DEFAULT = 0, /*!< Whatever the system's THP policy gives */
+  PAGES_4K,          /*!< Base pages only (MADV_NOHUGEPAGE) */
+  PAGES_THP,         /*!< Transparent huge pages (MADV_HUGEPAGE) */
+  PAGES_2M,          /*!< Explicit 2 MiB pages from the hugetlbfs pool */
+  PAGES_1G           /*!< Explicit 1 GiB pages from the hugetlbfs pool */
+} page_kind_t;
+
+#define NUM_PAGE_KINDS 5
+
+/**
+ *  Parses "default", "4k", "thp", "2m", or "1g"; returns 0 on
+ *  success.
+ */
+int parsePageKind (const char* s, page_kind_t* kind);
+
+/** Returns the name of a page kind, as accepted by parsePageKind(). */
+const char* getPageKindName (page_kind_t kind);
+
+/**
+ *  Sets the kind of pages that drivers' array constructors (e.g.,
+ *  'newKeys', 'createRanksBuffer', 'mm_create') request; initially
+ *  PAGES_DEFAULT.
+ */
+void setDefaultPageKind (page_kind_t kind);
+page_kind_t getDefaultPageKind (void);
+
+/**
+ *  Convenience for drivers: parses 'name' (or, if NULL, the PAGES
+ *  environment variable) and makes it the default kind. Returns 0 on
+ *  success, including when neither is given.
+ */
+int setupPageKind (const char* name);
+
+/**
+ *  Returns a new, zeroed, 'bytes'-byte array on pages of the given
+ *  kind, aligned to the page size (2 MiB for PAGES_THP). The pages
+ *  are not touched, so first-touch placement still applies.
+ *
+ *  Explicit pages that cannot be had (an empty or too small hugetlbfs
+ *  pool) fall back to 2 MiB pages, then to transparent huge pages,
+ *  with a one-time warning on stderr. Free with freePages().
+ */
+void* allocPages (size_t bytes, page_kind_t kind);
+
+/** Frees an array from allocPages(); NULL is ignored. */
+void freePages (void* p);
+
+/**
+ *  Returns an array of at least 'bytes' bytes for reuse: 'p' itself
+ *  if it came from allocPages() (or growPages()) for the same kind
+ *  and is large enough, else a new one from allocPages() of at least
+ *  twice p's size, 'p' being freed. A run of similar sizes thus
+ *  allocates only a few times. Reused arrays keep their contents and
+ *  their placement; new ones are zeroed and untouched. 'p' may be
+ *  NULL.
+ */
+void* growPages (void* p, size_t bytes, page_kind_t kind);
+
+/**
+ *  Returns the kind of pages an array from allocPages() actually got,
+ *  after any fallback, or PAGES_DEFAULT for any other pointer.
+ */
+page_kind_t getPageKind (const void* p);
+
+/**
+ *  Returns the number of bytes of an array from allocPages() that are
+ *  currently backed by huge pages: all of them for explicit pages,
+ *  else the 'AnonHugePages' of its mapping in /proc/self/smaps (so
+ *  only pages already touched count). Returns 0 for other pointers.
+ */
+size_t getHugePageBytes (const void* p);
+
+/**
+ *  Prints, as a '#'-comment line, the requested and obtained page
+ *  kinds of an array from allocPages() and how many huge pages back
+ *  it.
+ */
+void printPageReport (FILE* fp, const char* name, const void* p);
+
+#if defined (__cplusplus)
+} // extern "C"
+#endif
+
+#endif
+
+/* eof */
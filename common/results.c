@@ -0,0 +1,341 @@
+/**
+ *  \file results.c
+ *  \brief Implements the JSON results writer; see 'results.h'.
+ *
+ *  The writer streams the record as it goes, so a run that dies part
+ *  of the way through still leaves the benchmarks it finished (in a
+ *  file that is missing its closing brackets).
+ */
+
+#if !defined (_GNU_SOURCE)
+#  define _GNU_SOURCE
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "results.h"
+
+struct results_t
+{
+  FILE* fp;
+  int run_params;   /*!< The run's "params" object is open */
+  int n_results;    /*!< Benchmarks begun */
+  int in_result;    /*!< Between beginResult() and endResult() */
+  int has_times;    /*!< The current benchmark's "params" object is closed */
+  int n_params;     /*!< Parameters in the open "params" object */
+};
+
+/* ====================================================================== */
+
+static void
+writeString (FILE* fp, const char* s)
+{
+  fputc ('"', fp);
+  for (; s && *s; ++s) {
+    const unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\')
+      fprintf (fp, "\\%c", c);
+    else if (c == '\n')
+      fputs ("\\n", fp);
+    else if (c == '\t')
+      fputs ("\\t", fp);
+    else if (c < 0x20)
+      fprintf (fp, "\\u%04x", c);
+    else
+      fputc (c, fp);
+  }
+  fputc ('"', fp);
+}
+
+/** JSON has no infinities or NaNs; writes those as null */
+static void
+writeReal (FILE* fp, long double x)
+{
+  if (x == x && x - x == 0)
+    fprintf (fp, "%.10Lg", x);
+  else
+    fputs ("null", fp);
+}
+
+/** Returns the first "model name" of /proc/cpuinfo in buf, or "unknown" */
+static const char *
+getCpuModel (char* buf, size_t len)
+{
+  FILE* fp = fopen ("/proc/cpuinfo", "r");
+  char line[256];
+  snprintf (buf, len, "unknown");
+  if (!fp) return buf;
+  while (fgets (line, sizeof (line), fp)) {
+    char* colon = strchr (line, ':');
+    if (colon && !strncmp (line, "model name", 10)) {
+      char* s = colon + 1;
+      while (*s == ' ') ++s;
+      s[strcspn (s, "\n")] = 0;
+      snprintf (buf, len, "%s", s);
+      break;
+    }
+  }
+  fclose (fp);
+  return buf;
+}
+
+static long
+readSysfsValue (const char* path, long def)
+{
+  FILE* fp = fopen (path, "r");
+  long x = def;
+  if (fp) {
+    if (fscanf (fp, "%ld", &x) != 1) x = def;
+    fclose (fp);
+  }
+  return x;
+}
+
+#define MAX_PROBED_CPUS 4096
+
+/**
+ *  Counts the sockets and physical cores among the first n_cpus
+ *  CPUs, from sysfs; both are 0 if sysfs is missing.
+ */
+static void
+countCores (int n_cpus, int* n_sockets, int* n_cores)
+{
+  long* ids = (long *)malloc (2 * MAX_PROBED_CPUS * sizeof (long));
+  int cpu, i, n = 0;
+  *n_sockets = *n_cores = 0;
+  if (!ids) return;
+  if (n_cpus > MAX_PROBED_CPUS) n_cpus = MAX_PROBED_CPUS;
+  for (cpu = 0; cpu < n_cpus; ++cpu) {
+    char path[128];
+    long socket, core;
+    snprintf (path, sizeof (path),
+	      "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    socket = readSysfsValue (path, -1);
+    snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+    core = readSysfsValue (path, -1);
+    if (socket < 0 || core < 0) continue;
+    for (i = 0; i < n && (ids[2*i] != socket || ids[2*i+1] != core); ++i)
+      ;
+    if (i == n) {
+      ids[2*n] = socket;
+      ids[2*n+1] = core;
+      ++n;
+      for (i = 0; i < n - 1 && ids[2*i] != socket; ++i)
+	;
+      if (i == n - 1) ++*n_sockets;
+    }
+  }
+  *n_cores = n;
+  free (ids);
+}
+
+static int
+countNodes (void)
+{
+  int k, n = 0;
+  for (k = 0; k < MAX_PROBED_CPUS; ++k) {
+    char path[64];
+    snprintf (path, sizeof (path), "/sys/devices/system/node/node%d", k);
+    if (!access (path, F_OK)) ++n;
+  }
+  return n;
+}
+
+static void
+writeHost (FILE* fp)
+{
+  char name[256], model[256];
+  struct utsname u;
+  const int n_cpus = (int)sysconf (_SC_NPROCESSORS_ONLN);
+  int n_sockets, n_cores;
+
+  memset (name, 0, sizeof (name));
+  if (gethostname (name, sizeof (name) - 1)) snprintf (name, sizeof (name), "unknown");
+  countCores (n_cpus, &n_sockets, &n_cores);
+
+  fputs ("  \"host\": { \"name\": ", fp);
+  writeString (fp, name);
+  if (!uname (&u)) {
+    char os[3 * sizeof (u.release)];
+    snprintf (os, sizeof (os), "%s %s %s", u.sysname, u.release, u.machine);
+    fputs (", \"os\": ", fp);
+    writeString (fp, os);
+  }
+  fputs (", \"cpu\": ", fp);
+  writeString (fp, getCpuModel (model, sizeof (model)));
+  fprintf (fp, ", \"cpus\": %d, \"sockets\": %d, \"cores\": %d, \"nodes\": %d,"
+	   " \"page_size\": %ld },\n",
+	   n_cpus, n_sockets, n_cores, countNodes (), sysconf (_SC_PAGESIZE));
+}
+
+/* ====================================================================== */
+
+results_t *
+openResults__ (const char* program, const char* compiler, const char* flags)
+{
+  const char* path = getenv ("RESULTS");
+  results_t* J;
+  char date[64];
+  time_t now = time (NULL);
+  struct tm utc;
+
+  if (!path || !*path)
+    return NULL;
+  J = (results_t *)calloc (1, sizeof (results_t));
+  assert (J);
+  J->fp = fopen (path, "w");
+  if (!J->fp) {
+    fprintf (stderr, "*** Could not create the results file, '%s'. ***\n", path);
+    free (J);
+    return NULL;
+  }
+  fprintf (stderr, "Results: %s\n", path);
+
+  gmtime_r (&now, &utc);
+  strftime (date, sizeof (date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+  fputs ("{\n  \"program\": ", J->fp);
+  writeString (J->fp, program);
+  fputs (",\n  \"date\": ", J->fp);
+  writeString (J->fp, date);
+  fputs (",\n", J->fp);
+  writeHost (J->fp);
+  fputs ("  \"build\": { \"compiler\": ", J->fp);
+  writeString (J->fp, compiler);
+  fputs (", \"flags\": ", J->fp);
+  writeString (J->fp, flags);
+  fputs (" },\n  \"timer\": { \"name\": ", J->fp);
+  writeString (J->fp, stopwatch_name ());
+  fputs (", \"resolution\": ", J->fp);
+  writeReal (J->fp, stopwatch_resolution ());
+  fputs (", \"overhead\": ", J->fp);
+  writeReal (J->fp, stopwatch_overhead ());
+  fprintf (J->fp, ", \"counters\": %d },\n", stopwatch_counters_enabled ());
+  fputs ("  \"params\": {", J->fp);
+  J->run_params = 1;
+  return J;
+}
+
+void
+closeResults (results_t* J)
+{
+  if (!J) return;
+  if (J->in_result)
+    endResult (J);
+  if (J->run_params)
+    fputs (" },\n  \"results\": [", J->fp);
+  fputs (J->n_results ? "\n  ]\n}\n" : "]\n}\n", J->fp);
+  fclose (J->fp);
+  free (J);
+}
+
+/**
+ *  Starts the next parameter of the open "params" object or, after
+ *  the current benchmark's times, its next field
+ */
+static int
+beginParam (results_t* J, const char* key)
+{
+  if (!J || !(J->run_params || J->in_result))
+    return 0;
+  if (J->in_result && J->has_times)
+    fputs (", ", J->fp);
+  else
+    fputs (J->n_params++ ? ", " : " ", J->fp);
+  writeString (J->fp, key);
+  fputs (": ", J->fp);
+  return 1;
+}
+
+void
+addResultInt (results_t* J, const char* key, long long x)
+{
+  if (beginParam (J, key))
+    fprintf (J->fp, "%lld", x);
+}
+
+void
+addResultReal (results_t* J, const char* key, long double x)
+{
+  if (beginParam (J, key))
+    writeReal (J->fp, x);
+}
+
+void
+addResultString (results_t* J, const char* key, const char* s)
+{
+  if (beginParam (J, key))
+    writeString (J->fp, s);
+}
+
+void
+beginResult (results_t* J, const char* name)
+{
+  if (!J) return;
+  if (J->in_result)
+    endResult (J);
+  if (J->run_params) {
+    fputs (" },\n  \"results\": [", J->fp);
+    J->run_params = 0;
+  }
+  fputs (J->n_results++ ? ",\n    { \"name\": " : "\n    { \"name\": ", J->fp);
+  writeString (J->fp, name);
+  fputs (", \"params\": {", J->fp);
+  J->in_result = 1;
+  J->has_times = 0;
+  J->n_params = 0;
+}
+
+void
+addResultTimes (results_t* J, const bench_result_t* R)
+{
+  size_t k;
+  if (!J || !J->in_result || J->has_times) return;
+  assert (R);
+  fputs (" },\n      \"trials\": ", J->fp);
+  fprintf (J->fp, "%lu", (unsigned long)R->n);
+  fputs (", \"min\": ", J->fp);     writeReal (J->fp, R->min);
+  fputs (", \"median\": ", J->fp);  writeReal (J->fp, R->median);
+  fputs (", \"max\": ", J->fp);     writeReal (J->fp, R->max);
+  fputs (", \"mean\": ", J->fp);    writeReal (J->fp, R->mean);
+  fputs (", \"mad\": ", J->fp);     writeReal (J->fp, R->mad);
+  fputs (", \"ci\": [ ", J->fp);    writeReal (J->fp, R->ci_lo);
+  fputs (", ", J->fp);              writeReal (J->fp, R->ci_hi);
+  fprintf (J->fp, " ], \"converged\": %s,\n      \"times\": [",
+	   R->converged ? "true" : "false");
+  for (k = 0; k < R->n; ++k) {
+    fputs (k ? ", " : " ", J->fp);
+    writeReal (J->fp, R->times[k]);
+  }
+  fputs (" ]", J->fp);
+  J->has_times = 1;
+}
+
+void
+endResult (results_t* J)
+{
+  if (!J || !J->in_result) return;
+  fputs (J->has_times ? " }" : " } }", J->fp);
+  fflush (J->fp);
+  J->in_result = 0;
+}
+
+void
+addResult (results_t* J, const char* name,
+	   const char* key, const char* value, const bench_result_t* R)
+{
+  if (!J) return;
+  beginResult (J, name);
+  if (key)
+    addResultString (J, key, value);
+  addResultTimes (J, R);
+  endResult (J);
+}
+
+/* eof */
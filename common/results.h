@@ -0,0 +1,98 @@
+/**
+ *  \file results.h
+ *  \brief Machine-readable results: a JSON record of one run of a
+ *  driver, with the host, its topology, the build, the parameters,
+ *  and every trial's time of every benchmark.
+ *
+ *  With RESULTS=<file> in the environment, openResults() creates the
+ *  file and returns a writer; otherwise it returns NULL, and every
+ *  other call here does nothing on NULL, so drivers call them
+ *  unconditionally. The file looks like
+ *
+ *    { "program": "triad", "date": "2024-01-31T12:00:00Z",
+ *      "host": { "name": ..., "cpu": ..., "cpus": 16, "cores": 8, ... },
+ *      "build": { "compiler": ..., "flags": "-O3 -g" },
+ *      "timer": { "name": "rdtscp", "resolution": ..., "overhead": ... },
+ *      "params": { "n": 1000000, ... },
+ *      "results": [
+ *        { "name": "triad", "params": { "type": "double", ... },
+ *          "trials": 12, "min": ..., "median": ..., "max": ...,
+ *          "mean": ..., "mad": ..., "ci": [ lo, hi ],
+ *          "times": [ ... ], "reps": 100 }, ... ] }
+ *
+ *  Times are in seconds. See 'tools/benchcmp.c' to compare two files.
+ */
+
+#if !defined (INC_RESULTS_H)
+#define INC_RESULTS_H
+
+#include "bench.h"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+typedef struct results_t results_t;
+
+/**
+ *  If RESULTS is set, creates that file and writes the header of the
+ *  record of 'program'; 'compiler' and 'flags' describe the build.
+ *  Call it after stopwatch_init(). Returns NULL if RESULTS is unset.
+ *  Use openResults(), which fills in the build from the macros below.
+ */
+results_t* openResults__ (const char* program,
+			  const char* compiler, const char* flags);
+
+/** Ends the record and closes the file. */
+void closeResults (results_t* J);
+
+/**
+ *  Adds a parameter: to the current benchmark, between beginResult()
+ *  and addResultTimes(), or else to the run (before the first
+ *  benchmark). Parameters say what was run, and 'tools/benchcmp.c'
+ *  matches benchmarks on them. After addResultTimes(), adds a field
+ *  of the benchmark next to its times instead, for values measured
+ *  along with them (e.g., repetitions per trial chosen at run time).
+ */
+void addResultInt (results_t* J, const char* key, long long x);
+void addResultReal (results_t* J, const char* key, long double x);
+void addResultString (results_t* J, const char* key, const char* s);
+
+/** Starts the record of one benchmark. */
+void beginResult (results_t* J, const char* name);
+
+/** Adds the times of the current benchmark, and their statistics. */
+void addResultTimes (results_t* J, const bench_result_t* R);
+
+void endResult (results_t* J);
+
+/** Records one benchmark in one call: its name, one parameter, and its times */
+void addResult (results_t* J, const char* name,
+		const char* key, const char* value, const bench_result_t* R);
+
+/** The compiler and flags a driver was built with, for openResults() */
+#if !defined (RESULTS_COMPILER)
+#  if defined (__INTEL_COMPILER)
+#    define RESULTS_COMPILER "icc " __VERSION__
+#  elif defined (__clang__)
+#    define RESULTS_COMPILER "clang " __VERSION__
+#  elif defined (__GNUC__)
+#    define RESULTS_COMPILER "gcc " __VERSION__
+#  else
+#    define RESULTS_COMPILER "unknown"
+#  endif
+#endif
+#if !defined (RESULTS_BUILD_FLAGS)
+#  define RESULTS_BUILD_FLAGS "" /*!< Set by the Makefiles: -DRESULTS_BUILD_FLAGS='"$(COPTFLAGS)"' */
+#endif
+
+#define openResults(program) \
+  openResults__ ((program), RESULTS_COMPILER, RESULTS_BUILD_FLAGS)
+
+#if defined (__cplusplus)
+} // extern "C"
+#endif
+
+#endif
+
+/* eof */
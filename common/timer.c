@@ -0,0 +1,566 @@
+/**
+ *  \file timer.c
+ *  \brief Implements the stopwatch timers; see 'timer.h'.
+ *
+ *  Times are kept as integer ticks (counter ticks, or nanoseconds) and
+ *  only converted to seconds when asked for, so long runs lose no
+ *  precision.
+ *
+ *  The hardware counters of a stopwatch form one perf event group,
+ *  which the kernel schedules onto the PMU all at once, read with a
+ *  single read() just before the start and just after the stop.
+ */
+
+#if !defined (_GNU_SOURCE)
+#  define _GNU_SOURCE /* CLOCK_MONOTONIC_RAW */
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined (__x86_64__)
+#  include <cpuid.h>
+#  define HAVE_TSC 1
+#endif
+
+#if defined (__linux__)
+#  include <errno.h>
+#  include <unistd.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#  define HAVE_PERF_EVENTS 1
+#endif
+
+#if defined (CLOCK_MONOTONIC_RAW)
+#  define TIMER_CLOCK CLOCK_MONOTONIC_RAW
+#  define TIMER_CLOCK_NAME "CLOCK_MONOTONIC_RAW"
+#else
+#  define TIMER_CLOCK CLOCK_MONOTONIC
+#  define TIMER_CLOCK_NAME "CLOCK_MONOTONIC"
+#endif
+
+#include "timer.h"
+
+typedef uint64_t ticks_t;
+
+/** A perf event group; counts of -1 mark events that did not open */
+struct counters_t
+{
+  int leader;                              /*!< File descriptor of the group */
+  int slot[STOPWATCH_NUM_COUNTERS];        /*!< Place in the group's read, or -1 */
+  int fd[STOPWATCH_NUM_COUNTERS];
+  long long start[STOPWATCH_NUM_COUNTERS]; /*!< At the start of the interval */
+  long long total[STOPWATCH_NUM_COUNTERS]; /*!< Over the ended intervals */
+};
+
+struct stopwatch_t
+{
+  ticks_t t_start_;
+  ticks_t t_stop_;
+  ticks_t total_; /*!< Sum of the ended intervals */
+  size_t laps_;   /*!< Number of ended intervals */
+  int is_running_;
+  struct counters_t* counters_; /*!< NULL if not counting */
+};
+
+static int use_tsc__ = -1; /* -1: stopwatch_init() has not run */
+static long double seconds_per_tick__ = 1e-9;
+static ticks_t overhead__ = 0; /* Ticks per start and stop */
+
+/** Time (ns) to count ticks against the clock, to calibrate the counter */
+#define CALIBRATION_NS 20000000
+
+/** Empty intervals to time, to measure the overhead */
+#define OVERHEAD_TRIALS 1000
+
+static ticks_t
+readClock (void)
+{
+  struct timespec t;
+  clock_gettime (TIMER_CLOCK, &t);
+  return (ticks_t)t.tv_sec * 1000000000u + (ticks_t)t.tv_nsec;
+}
+
+#if defined (HAVE_TSC)
+/* The fences keep the code being timed from starting before the
+ * start, or from still running at the stop. (Inline assembly rather
+ * than intrinsics, so that nvcc can compile this file too.) */
+static inline ticks_t
+readTscStart (void)
+{
+  unsigned int lo, hi;
+  __asm__ __volatile__ ("lfence\n\trdtsc\n\tlfence" : "=a" (lo), "=d" (hi) : : "memory");
+  return ((ticks_t)hi << 32) | lo;
+}
+
+static inline ticks_t
+readTscStop (void)
+{
+  unsigned int lo, hi;
+  __asm__ __volatile__ ("rdtscp\n\tlfence" : "=a" (lo), "=d" (hi) : : "ecx", "memory");
+  return ((ticks_t)hi << 32) | lo;
+}
+
+/** Returns 1 if the CPU has 'rdtscp' and a constant-rate counter */
+static int
+hasInvariantTsc (void)
+{
+  unsigned int a, b, c, d;
+  if (!__get_cpuid (0x80000001, &a, &b, &c, &d) || !(d & (1u << 27)))
+    return 0;
+  if (!__get_cpuid (0x80000007, &a, &b, &c, &d) || !(d & (1u << 8)))
+    return 0;
+  return 1;
+}
+
+/** Measures the seconds per counter tick against the clock */
+static void
+calibrateTsc (void)
+{
+  const ticks_t c0 = readClock ();
+  const ticks_t s0 = readTscStart ();
+  ticks_t c1, s1;
+  do {
+    c1 = readClock ();
+    s1 = readTscStop ();
+  } while (c1 - c0 < CALIBRATION_NS);
+  seconds_per_tick__ = (long double)(c1 - c0) * 1e-9L / (long double)(s1 - s0);
+}
+
+#  define STAMP_START() (use_tsc__ > 0 ? readTscStart () : readClock ())
+#  define STAMP_STOP()  (use_tsc__ > 0 ? readTscStop () : readClock ())
+#else
+#  define STAMP_START() readClock ()
+#  define STAMP_STOP()  readClock ()
+#endif
+
+static long double
+toSeconds (ticks_t t)
+{
+  return (long double)t * seconds_per_tick__;
+}
+
+/** Sets the overhead to the shortest of many empty intervals */
+static void
+measureOverhead (void)
+{
+  ticks_t best = 0;
+  int k;
+  for (k = 0; k < OVERHEAD_TRIALS; ++k) {
+    const ticks_t t_start = STAMP_START ();
+    const ticks_t t_stop = STAMP_STOP ();
+    if (!k || t_stop - t_start < best)
+      best = t_stop - t_start;
+  }
+  overhead__ = best;
+}
+
+/** Picks the clock ($TIMER: "tsc" or "clock"), calibrates it, and measures the overhead */
+static void
+setupTimer (int verbose)
+{
+  const char* name = getenv ("TIMER");
+  int want_tsc = 1;
+
+  if (name && !strcmp (name, "clock"))
+    want_tsc = 0;
+  else if (name && strcmp (name, "tsc") && verbose)
+    fprintf (stderr, "*** Unknown timer, '%s'; expected tsc or clock. ***\n", name);
+
+  use_tsc__ = 0;
+  seconds_per_tick__ = 1e-9;
+#if defined (HAVE_TSC)
+  if (want_tsc && hasInvariantTsc ()) {
+    use_tsc__ = 1;
+    calibrateTsc ();
+  }
+#endif
+  if (want_tsc && !use_tsc__ && verbose)
+    fprintf (stderr, "*** No invariant time-stamp counter; using clock_gettime. ***\n");
+  measureOverhead ();
+
+  if (verbose) {
+    if (use_tsc__)
+      fprintf (stderr, "Timer: rdtscp (invariant TSC, %.3Lf GHz)\n",
+	       1e-9L / seconds_per_tick__);
+    else
+      fprintf (stderr, "Timer: clock_gettime (%s)\n", TIMER_CLOCK_NAME);
+    fprintf (stderr, "Timer resolution: %Lg ns\n", 1e9L * stopwatch_resolution ());
+    fprintf (stderr, "Timer overhead: %Lg ns per start/stop\n", 1e9L * stopwatch_overhead ());
+    fflush (stderr);
+  }
+}
+
+/* ====================================================================== */
+
+/** -1: not yet read from $COUNTERS */
+static int counters_enabled__ = -1;
+
+int
+stopwatch_counters_enabled (void)
+{
+  if (counters_enabled__ < 0) {
+    const char* s = getenv ("COUNTERS");
+    counters_enabled__ = (s && *s && strcmp (s, "0"));
+  }
+  return counters_enabled__;
+}
+
+void
+stopwatch_enable_counters (int enable)
+{
+  counters_enabled__ = (enable != 0);
+}
+
+#if defined (HAVE_PERF_EVENTS)
+static const struct
+{
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+} counter_events[STOPWATCH_NUM_COUNTERS] = {
+  { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { "LLC-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { "dTLB-misses", PERF_TYPE_HW_CACHE,
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+  { "branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+
+/** Error from the last group that failed to open; 0 if none did */
+static int counters_errno__ = 0;
+
+static int
+openEvent (int k, int group)
+{
+  struct perf_event_attr attr;
+  memset (&attr, 0, sizeof (attr));
+  attr.size = sizeof (attr);
+  attr.type = counter_events[k].type;
+  attr.config = counter_events[k].config;
+  attr.disabled = (group < 0); /* The group starts when the leader is enabled */
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP
+    | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall (SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/** Opens and starts the events this system has, or returns NULL if none */
+static struct counters_t *
+openCounters (void)
+{
+  struct counters_t* C = (struct counters_t *)malloc (sizeof (struct counters_t));
+  int k, n_open = 0;
+  if (!C) return NULL;
+  memset (C, 0, sizeof (struct counters_t));
+  C->leader = -1;
+  for (k = 0; k < STOPWATCH_NUM_COUNTERS; ++k) {
+    C->fd[k] = openEvent (k, C->leader);
+    C->slot[k] = (C->fd[k] >= 0) ? n_open++ : -1;
+    if (C->fd[k] < 0 && C->leader < 0)
+      counters_errno__ = errno;
+    if (C->leader < 0)
+      C->leader = C->fd[k];
+  }
+  if (C->leader < 0) {
+    free (C);
+    return NULL;
+  }
+  ioctl (C->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return C;
+}
+
+static void
+closeCounters (struct counters_t* C)
+{
+  int k;
+  if (!C) return;
+  for (k = STOPWATCH_NUM_COUNTERS - 1; k >= 0; --k)
+    if (C->fd[k] >= 0)
+      close (C->fd[k]);
+  free (C);
+}
+
+/**
+ *  Reads the group into v[], scaling up the counts if the kernel
+ *  multiplexed the PMU; -1 for missing events, or if the read fails.
+ */
+static void
+readCounters (const struct counters_t* C, long long* v)
+{
+  uint64_t buf[3 + STOPWATCH_NUM_COUNTERS];
+  const int ok = read (C->leader, buf, sizeof (buf)) > 0 && buf[2] > 0;
+  int k;
+  for (k = 0; k < STOPWATCH_NUM_COUNTERS; ++k) {
+    if (!ok || C->slot[k] < 0)
+      v[k] = -1;
+    else if (buf[2] < buf[1])
+      v[k] = (long long)((long double)buf[3 + C->slot[k]] * buf[1] / buf[2]);
+    else
+      v[k] = (long long)buf[3 + C->slot[k]];
+  }
+}
+
+/** Prints which events new stopwatches count */
+static void
+printCounters (FILE* fp)
+{
+  struct counters_t* C;
+  int k;
+  if (!stopwatch_counters_enabled ()) {
+    fprintf (fp, "Counters: off (set COUNTERS=1 to count events)\n");
+    return;
+  }
+  C = openCounters ();
+  if (!C) {
+    fprintf (fp, "Counters: unavailable (perf_event_open: %s)\n", strerror (counters_errno__));
+    return;
+  }
+  fprintf (fp, "Counters:");
+  for (k = 0; k < STOPWATCH_NUM_COUNTERS; ++k)
+    fprintf (fp, " %s%s", counter_events[k].name, C->slot[k] < 0 ? " (unavailable)" : "");
+  fprintf (fp, "\n");
+  closeCounters (C);
+}
+#else
+static struct counters_t *
+openCounters (void)
+{
+  return NULL;
+}
+
+static void
+closeCounters (struct counters_t* C)
+{
+}
+
+static void
+readCounters (const struct counters_t* C, long long* v)
+{
+  int k;
+  for (k = 0; k < STOPWATCH_NUM_COUNTERS; ++k)
+    v[k] = -1;
+}
+
+static void
+printCounters (FILE* fp)
+{
+  if (stopwatch_counters_enabled ())
+    fprintf (fp, "Counters: unavailable (no perf_event_open)\n");
+}
+#endif
+
+/** Adds the counts since the start of the interval to the totals, and restarts it */
+static void
+lapCounters (struct counters_t* C)
+{
+  long long now[STOPWATCH_NUM_COUNTERS];
+  int k;
+  readCounters (C, now);
+  for (k = 0; k < STOPWATCH_NUM_COUNTERS; ++k) {
+    if (now[k] < 0 || C->start[k] < 0 || C->total[k] < 0)
+      C->total[k] = -1;
+    else
+      C->total[k] += now[k] - C->start[k];
+    C->start[k] = now[k];
+  }
+}
+
+long long
+stopwatch_counter (const struct stopwatch_t* T, stopwatch_counter_t c)
+{
+  assert (T && (int)c >= 0 && (int)c < STOPWATCH_NUM_COUNTERS);
+  return T->counters_ ? T->counters_->total[c] : -1;
+}
+
+void
+stopwatch_print_counters_header (FILE* fp, char sep)
+{
+  if (!stopwatch_counters_enabled ()) return;
+  fprintf (fp, "%ccycles%cinstructions%cIPC%cLLC-misses/elem%cdTLB-misses/elem%cbranch-misses/elem",
+	   sep, sep, sep, sep, sep, sep);
+}
+
+/** Prints x, or "-" if negative (missing) */
+static void
+printCount (FILE* fp, char sep, long double x, const char* fmt)
+{
+  fputc (sep, fp);
+  if (x < 0)
+    fputc ('-', fp);
+  else
+    fprintf (fp, fmt, x);
+}
+
+void
+stopwatch_print_counters (FILE* fp, const struct stopwatch_t* T,
+			  size_t n, char sep)
+{
+  const long double laps = (T && T->laps_) ? (long double)T->laps_ : 1;
+  long long v[STOPWATCH_NUM_COUNTERS];
+  int k;
+  if (!stopwatch_counters_enabled ()) return;
+  assert (T);
+  for (k = 0; k < STOPWATCH_NUM_COUNTERS; ++k)
+    v[k] = stopwatch_counter (T, (stopwatch_counter_t)k);
+  if (!n) n = 1;
+  printCount (fp, sep, v[STOPWATCH_CYCLES] < 0 ? -1 : v[STOPWATCH_CYCLES] / laps, "%.0Lf");
+  printCount (fp, sep, v[STOPWATCH_INSTRUCTIONS] < 0 ? -1 : v[STOPWATCH_INSTRUCTIONS] / laps, "%.0Lf");
+  printCount (fp, sep, (v[STOPWATCH_CYCLES] <= 0 || v[STOPWATCH_INSTRUCTIONS] < 0) ? -1
+	      : (long double)v[STOPWATCH_INSTRUCTIONS] / v[STOPWATCH_CYCLES], "%.3Lf");
+  for (k = STOPWATCH_LLC_MISSES; k <= STOPWATCH_BRANCH_MISSES; ++k)
+    printCount (fp, sep, v[k] < 0 ? -1 : v[k] / (laps * n), "%.4Lg");
+}
+
+/* ====================================================================== */
+
+void
+stopwatch_init (void)
+{
+  setupTimer (1);
+  printCounters (stderr);
+}
+
+const char *
+stopwatch_name (void)
+{
+  return use_tsc__ > 0 ? "rdtscp" : "clock_gettime";
+}
+
+long double
+stopwatch_resolution (void)
+{
+  struct timespec res;
+  if (use_tsc__ > 0)
+    return seconds_per_tick__;
+  if (clock_getres (TIMER_CLOCK, &res))
+    return 1e-9;
+  return (long double)res.tv_sec + (long double)res.tv_nsec * 1e-9L;
+}
+
+long double
+stopwatch_overhead (void)
+{
+  return toSeconds (overhead__);
+}
+
+struct stopwatch_t *
+stopwatch_create (void)
+{
+  struct stopwatch_t* new_timer;
+  if (use_tsc__ < 0)
+    setupTimer (0);
+  new_timer = (struct stopwatch_t *)malloc (sizeof (struct stopwatch_t));
+  if (new_timer) {
+    memset (new_timer, 0, sizeof (struct stopwatch_t));
+    if (stopwatch_counters_enabled ())
+      new_timer->counters_ = openCounters ();
+  }
+  return new_timer;
+}
+
+void
+stopwatch_destroy (struct stopwatch_t* T)
+{
+  if (T) {
+    stopwatch_stop (T);
+    closeCounters (T->counters_);
+    free (T);
+  }
+}
+
+void
+stopwatch_start (struct stopwatch_t* T)
+{
+  assert (T);
+  T->is_running_ = 1;
+  if (T->counters_)
+    readCounters (T->counters_, T->counters_->start);
+  T->t_start_ = STAMP_START ();
+}
+
+long double
+stopwatch_stop (struct stopwatch_t* T)
+{
+  long double dt = 0;
+  if (T) {
+    if (T->is_running_) {
+      T->t_stop_ = STAMP_STOP ();
+      if (T->counters_)
+	lapCounters (T->counters_);
+      T->is_running_ = 0;
+      T->total_ += T->t_stop_ - T->t_start_;
+      ++T->laps_;
+    }
+    dt = toSeconds (T->t_stop_ - T->t_start_);
+  }
+  return dt;
+}
+
+long double
+stopwatch_lap (struct stopwatch_t* T)
+{
+  const ticks_t now = STAMP_STOP ();
+  ticks_t dt;
+  assert (T && T->is_running_);
+  if (T->counters_)
+    lapCounters (T->counters_);
+  dt = now - T->t_start_;
+  T->total_ += dt;
+  ++T->laps_;
+  T->t_start_ = T->t_stop_ = now;
+  return toSeconds (dt);
+}
+
+long double
+stopwatch_elapsed (const struct stopwatch_t* T)
+{
+  long double dt = 0;
+  if (T) {
+    if (T->is_running_)
+      dt = toSeconds (STAMP_STOP () - T->t_start_);
+    else
+      dt = toSeconds (T->t_stop_ - T->t_start_);
+  }
+  return dt;
+}
+
+long double
+stopwatch_total (const struct stopwatch_t* T)
+{
+  ticks_t charge;
+  assert (T);
+  charge = (ticks_t)T->laps_ * overhead__;
+  return T->total_ > charge ? toSeconds (T->total_ - charge) : 0;
+}
+
+size_t
+stopwatch_laps (const struct stopwatch_t* T)
+{
+  assert (T);
+  return T->laps_;
+}
+
+void
+stopwatch_reset (struct stopwatch_t* T)
+{
+  struct counters_t* C;
+  assert (T);
+  C = T->counters_;
+  memset (T, 0, sizeof (struct stopwatch_t));
+  if (C) {
+    memset (C->start, 0, sizeof (C->start));
+    memset (C->total, 0, sizeof (C->total));
+    T->counters_ = C;
+  }
+}
+
+/* eof */
@@ -0,0 +1,130 @@
+/**
+ *  \file timer.h
+ *  \brief Stopwatch timers, shared by all the labs.
+ *
+ *  On x86 CPUs with an invariant time-stamp counter, a stopwatch reads
+ *  the counter with 'rdtscp' between fences, which costs a few dozen
+ *  cycles, and converts ticks to seconds at the rate measured by
+ *  stopwatch_init(). Elsewhere (or with TIMER=clock in the
+ *  environment) it reads clock_gettime (CLOCK_MONOTONIC_RAW).
+ *
+ *  A stopwatch also accumulates: every stop, or lap, adds the interval
+ *  just ended to a running total, so one stopwatch can time the same
+ *  region on each pass through a loop.
+ *
+ *  With counters enabled (COUNTERS=1 in the environment, or
+ *  stopwatch_enable_counters()), a stopwatch also counts hardware
+ *  events over its intervals, through Linux's perf_event_open(). The
+ *  counts cover the thread that creates the stopwatch and the threads
+ *  it starts afterwards, so create it before the first parallel
+ *  region. Where counters are unavailable (other systems, VMs without
+ *  a PMU, a restrictive perf_event_paranoid), counts read as -1.
+ */
+
+#if !defined (INC_TIMER_H)
+#define INC_TIMER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/**
+ *  Picks the clock, measures the tick rate and the cost of a start and
+ *  a stop, and prints them on stderr. Call it once, before the first
+ *  timing; stopwatch_create() calls it, silently, if no one has.
+ */
+void stopwatch_init (void);
+
+/** Returns the clock in use: "rdtscp" or "clock_gettime". */
+const char* stopwatch_name (void);
+
+/** Returns the smallest measurable interval, in seconds. */
+long double stopwatch_resolution (void);
+
+/** Returns the time one stopwatch_start() plus stopwatch_stop() adds, in seconds. */
+long double stopwatch_overhead (void);
+
+struct stopwatch_t * stopwatch_create (void);
+void stopwatch_destroy (struct stopwatch_t* T);
+
+/** Starts a new interval. */
+void stopwatch_start (struct stopwatch_t* T);
+
+/**
+ *  Ends the current interval, adds it to the total, and returns its
+ *  length in seconds; on a stopped stopwatch, returns the length of
+ *  the last interval.
+ */
+long double stopwatch_stop (struct stopwatch_t* T);
+
+/**
+ *  Ends the current interval, adds it to the total, and starts the
+ *  next one at the same instant; returns the length of the interval
+ *  that ended, in seconds.
+ */
+long double stopwatch_lap (struct stopwatch_t* T);
+
+/** Returns the seconds since the start of the current (or the last) interval. */
+long double stopwatch_elapsed (const struct stopwatch_t* T);
+
+/**
+ *  Returns the total, in seconds, of the intervals ended since the
+ *  stopwatch was created or reset, less stopwatch_overhead() for each.
+ */
+long double stopwatch_total (const struct stopwatch_t* T);
+
+/** Returns the number of intervals in stopwatch_total(). */
+size_t stopwatch_laps (const struct stopwatch_t* T);
+
+/** Stops the stopwatch and clears its total (and counts). */
+void stopwatch_reset (struct stopwatch_t* T);
+
+/** The hardware events a stopwatch counts */
+typedef enum
+{
+  STOPWATCH_CYCLES = 0,
+  STOPWATCH_INSTRUCTIONS,
+  STOPWATCH_LLC_MISSES,
+  STOPWATCH_DTLB_MISSES,
+  STOPWATCH_BRANCH_MISSES
+} stopwatch_counter_t;
+
+#define STOPWATCH_NUM_COUNTERS 5
+
+/** Turns counting on or off for the stopwatches created from now on. */
+void stopwatch_enable_counters (int enable);
+
+/** Returns 1 if new stopwatches count events. */
+int stopwatch_counters_enabled (void);
+
+/**
+ *  Returns the count of event 'c' over the intervals in
+ *  stopwatch_total(), or -1 if the stopwatch does not count it.
+ */
+long long stopwatch_counter (const struct stopwatch_t* T, stopwatch_counter_t c);
+
+/**
+ *  If counters are enabled, prints the names of the columns that
+ *  stopwatch_print_counters() prints, each preceded by 'sep'.
+ */
+void stopwatch_print_counters_header (FILE* fp, char sep);
+
+/**
+ *  If counters are enabled, prints the cycles and instructions per
+ *  interval, the instructions per cycle, and the LLC, dTLB, and branch
+ *  misses per element (of 'n' per interval), each preceded by 'sep';
+ *  "-" stands for an event the stopwatch could not count.
+ */
+void stopwatch_print_counters (FILE* fp, const struct stopwatch_t* T,
+			       size_t n, char sep);
+
+#if defined (__cplusplus)
+} // extern "C"
+#endif
+
+#endif
+
+/* eof */
@@ -12,6 +12,9 @@
  *  - sorts it using YOUR parallel implementation, also noting the
  *    execution time;
  *
+ *    (each sort runs on a fresh copy of the input, repeatedly, until
+ *    the median time is known to within a few percent; see 'bench.h')
+ *
  *  - checks that the two sorts produce the same result;
  *
  *  - outputs the execution times and effective sorting rate (i.e.,
@@ -21,13 +24,58 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "timer.c"
+#include "bench.c"
+#include "results.c"
 
 #include "sort.hh"
 
 /* ============================================================
  */
 
+/** One sort to benchmark: sorts a fresh copy of A_in into A */
+struct SortTrial
+{
+  int N;
+  const keytype* A_in;
+  keytype* A;
+  void (*sort) (int N, keytype* A);
+};
+
+static void
+copyKeys (void* arg)
+{
+  SortTrial* X = (SortTrial *)arg;
+  memcpy (X->A, X->A_in, X->N * sizeof (keytype));
+}
+
+static void
+runSort (void* arg)
+{
+  SortTrial* X = (SortTrial *)arg;
+  X->sort (X->N, X->A);
+}
+
+/** Sorts a copy of A_in into A, repeatedly, and prints (and records) the times */
+static void
+benchmarkSort (const char* name, const bench_config_t* C,
+	       struct stopwatch_t* timer, results_t* J,
+	       int N, const keytype* A_in, keytype* A,
+	       void (*sort) (int N, keytype* A))
+{
+  SortTrial X = {N, A_in, A, sort};
+  bench_task_t task = {copyKeys, runSort, NULL, NULL, &X};
+  bench_result_t R;
+  benchRun (C, &task, timer, &R);
+  printf ("%s: %Lg seconds ==> %Lg million keys per second\n",
+	  name, R.median, 1e-6 * N / R.median);
+  printf ("  (median of %lu trials; min %Lg, MAD %Lg, %Lg%% CI %Lg to %Lg)\n",
+	  (unsigned long)R.n, R.min, R.mad, 100 * C->confidence, R.ci_lo, R.ci_hi);
+  addResult (J, name, NULL, NULL, &R);
+  benchRelease (&R);
+}
+
 int
 main (int argc, char* argv[])
 {
@@ -44,6 +92,11 @@ main (int argc, char* argv[])
 
   stopwatch_init ();
   struct stopwatch_t* timer = stopwatch_create (); assert (timer);
+  bench_config_t C;
+  benchDefaults (&C);
+  printBenchConfig (stderr, &C);
+  results_t* J = openResults ("qsort");
+  addResultInt (J, "n", N);
 
   /* Create an input array of length N, initialized to random values */
   keytype* A_in = newKeys (N);
@@ -53,21 +106,13 @@ main (int argc, char* argv[])
   printf ("\nN == %d\n\n", N);
 
   /* Sort sequentially */
-  keytype* A_seq = newCopy (N, A_in);
-  stopwatch_start (timer);
-  sequentialSort (N, A_seq);
-  long double t_seq = stopwatch_stop (timer);
-  printf ("Sequential: %Lg seconds ==> %Lg million keys per second\n",
-	  t_seq, 1e-6 * N / t_seq);
+  keytype* A_seq = newKeys (N);
+  benchmarkSort ("Sequential", &C, timer, J, N, A_in, A_seq, sequentialSort);
   assertIsSorted (N, A_seq);
 
   /* Sort in parallel, calling YOUR routine. */
-  keytype* A_par = newCopy (N, A_in);
-  stopwatch_start (timer);
-  parallelSort (N, A_par);
-  long double t_qs = stopwatch_stop (timer);
-  printf ("Parallel sort: %Lg seconds ==> %Lg million keys per second\n",
-	  t_qs, 1e-6 * N / t_qs);
+  keytype* A_par = newKeys (N);
+  benchmarkSort ("Parallel sort", &C, timer, J, N, A_in, A_par, parallelSort);
   assertIsSorted (N, A_par);
   assertIsEqual (N, A_par, A_seq);
 
@@ -76,6 +121,7 @@ main (int argc, char* argv[])
   free (A_par);
   free (A_seq);
   free (A_in);
+  closeResults (J);
   stopwatch_destroy (timer);
   return 0;
 }
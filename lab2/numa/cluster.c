@@ -0,0 +1,180 @@
+/**
+ *  \file cluster.c
+ *  \brief Implements the multi-rank bandwidth report; see 'cluster.h'.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mpi.h>
+#include "mpi_fprintf.h"
+#include "mpi_assert.h"
+
+#include "cluster.h"
+
+static int rank__ = 0;
+static int size__ = 1;
+
+/** Number of nodes, and the node (0 to n_nodes__-1) of each rank */
+static int n_nodes__ = 1;
+static int* node_of__ = NULL;
+
+/** Host names of all ranks, MPI_MAX_PROCESSOR_NAME+1 bytes each */
+static char* names__ = NULL;
+
+#define NAME_LEN (MPI_MAX_PROCESSOR_NAME + 1)
+#define NAME_OF(r) (names__ + (size_t)(r) * NAME_LEN)
+
+void
+initCluster (int* argc, char*** argv)
+{
+  const MPI_Comm comm = MPI_COMM_WORLD;
+  char name[NAME_LEN];
+  int len = 0, r, s;
+
+  MPI_Init (argc, argv);
+  MPI_Comm_rank (comm, &rank__);
+  MPI_Comm_size (comm, &size__);
+
+  memset (name, 0, sizeof (name));
+  MPI_Get_processor_name (name, &len);
+  names__ = (char *)malloc ((size_t)size__ * NAME_LEN);
+  node_of__ = (int *)malloc ((size_t)size__ * sizeof (int));
+  MPI_Assert (comm, names__ && node_of__);
+  MPI_Allgather (name, NAME_LEN, MPI_CHAR, names__, NAME_LEN, MPI_CHAR, comm);
+
+  /* Number the nodes in order of their lowest rank */
+  n_nodes__ = 0;
+  for (r = 0; r < size__; ++r) {
+    for (s = 0; s < r && strcmp (NAME_OF (s), NAME_OF (r)); ++s)
+      ;
+    node_of__[r] = (s < r) ? node_of__[s] : n_nodes__++;
+  }
+  MPI_fprintf (comm, stderr, "node %d of %d\n", node_of__[rank__], n_nodes__);
+}
+
+void
+finalizeCluster (void)
+{
+  free (node_of__);
+  free (names__);
+  node_of__ = NULL;
+  names__ = NULL;
+  MPI_Finalize ();
+}
+
+int
+getClusterRank (void)
+{
+  return rank__;
+}
+
+int
+getClusterSize (void)
+{
+  return size__;
+}
+
+int
+getClusterNodes (void)
+{
+  return n_nodes__;
+}
+
+void
+syncCluster (void)
+{
+  MPI_Barrier (MPI_COMM_WORLD);
+}
+
+long double
+getClusterMaxTime (long double t)
+{
+  double t_local = (double)t, t_max = 0;
+  MPI_Allreduce (&t_local, &t_max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  return t_max;
+}
+
+static int
+compareDoubles (const void* a, const void* b)
+{
+  const double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/** Returns the median of x[0:n-1], which it sorts */
+static double
+median (double* x, int n)
+{
+  assert (n > 0);
+  qsort (x, n, sizeof (double), compareDoubles);
+  return (n % 2) ? x[n/2] : 0.5 * (x[n/2 - 1] + x[n/2]);
+}
+
+int
+reportCluster (FILE* fp, const char* kernel, const char* type,
+	       size_t n, size_t n_trials,
+	       long double gbs, long double gbs_all, double threshold)
+{
+  const MPI_Comm comm = MPI_COMM_WORLD;
+  double gbs_local = (double)gbs;
+  double* gbs_rank = NULL;
+  double* gbs_node;
+  double* sorted;
+  int* ranks_node;
+  double med;
+  int r, k, n_slow = 0;
+
+  if (rank__ == 0) {
+    gbs_rank = (double *)malloc ((size_t)size__ * sizeof (double));
+    MPI_Assert (comm, gbs_rank != NULL);
+  }
+  MPI_Gather (&gbs_local, 1, MPI_DOUBLE, gbs_rank, 1, MPI_DOUBLE, 0, comm);
+  if (rank__ != 0)
+    return 0;
+
+  gbs_node = (double *)calloc ((size_t)n_nodes__, sizeof (double));
+  sorted = (double *)malloc ((size_t)n_nodes__ * sizeof (double));
+  ranks_node = (int *)calloc ((size_t)n_nodes__, sizeof (int));
+  MPI_Assert (comm, gbs_node && sorted && ranks_node);
+
+  for (r = 0; r < size__; ++r) {
+    gbs_node[node_of__[r]] += gbs_rank[r];
+    ++ranks_node[node_of__[r]];
+    fprintf (fp, "cluster\trank\t%s\t%s\t%lu\t%lu\t%s:%d\t1\t%g\n",
+	     kernel, type, (unsigned long)n, (unsigned long)n_trials,
+	     NAME_OF (r), r, gbs_rank[r]);
+  }
+  for (k = 0, r = 0; k < n_nodes__; ++k) {
+    while (node_of__[r] != k) ++r;
+    fprintf (fp, "cluster\tnode\t%s\t%s\t%lu\t%lu\t%s\t%d\t%g\n",
+	     kernel, type, (unsigned long)n, (unsigned long)n_trials,
+	     NAME_OF (r), ranks_node[k], gbs_node[k]);
+  }
+  fprintf (fp, "cluster\tall\t%s\t%s\t%lu\t%lu\tall\t%d\t%Lg\n",
+	   kernel, type, (unsigned long)n, (unsigned long)n_trials,
+	   size__, gbs_all);
+
+  memcpy (sorted, gbs_node, (size_t)n_nodes__ * sizeof (double));
+  med = median (sorted, n_nodes__);
+  fprintf (fp, "# nodes(%s, %s): %d node(s), median %g GB/s, range %g to %g GB/s\n",
+	   kernel, type, n_nodes__, med, sorted[0], sorted[n_nodes__ - 1]);
+  for (k = 0, r = 0; k < n_nodes__; ++k) {
+    while (node_of__[r] != k) ++r;
+    if (gbs_node[k] < threshold * med) {
+      fprintf (fp, "# SLOW node %s (%s, %s): %g GB/s, %.0f%% of the median\n",
+	       NAME_OF (r), kernel, type, gbs_node[k], 100 * gbs_node[k] / med);
+      ++n_slow;
+    }
+  }
+  fflush (fp);
+
+  free (ranks_node);
+  free (sorted);
+  free (gbs_node);
+  free (gbs_rank);
+  return n_slow;
+}
+
+/* eof */
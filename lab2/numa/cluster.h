@@ -0,0 +1,57 @@
+/**
+ *  \file cluster.h
+ *  \brief Runs the STREAM-style kernels on every MPI rank at once and
+ *  aggregates the bandwidth per rank and per node, to spot nodes whose
+ *  memory system is slower than the rest (e.g., a missing DIMM, or a
+ *  neighbor job). Compiled into 'triad-mpi' only.
+ */
+
+#if !defined (INC_CLUSTER_H)
+#define INC_CLUSTER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/** Default fraction of the median node bandwidth below which a node is flagged */
+#define CLUSTER_THRESHOLD 0.9
+
+/**
+ *  Initializes MPI and groups the ranks into nodes by processor (host)
+ *  name. Each rank reports its node on stderr.
+ */
+void initCluster (int* argc, char*** argv);
+
+/** Shuts down MPI. */
+void finalizeCluster (void);
+
+/** Returns this process's rank in MPI_COMM_WORLD. */
+int getClusterRank (void);
+
+/** Returns the number of ranks. */
+int getClusterSize (void);
+
+/** Returns the number of distinct nodes the ranks run on. */
+int getClusterNodes (void);
+
+/** Waits until every rank gets here (a barrier). */
+void syncCluster (void);
+
+/** Returns the largest 't' over all ranks, on every rank. */
+long double getClusterMaxTime (long double t);
+
+/**
+ *  Gathers each rank's best bandwidth, 'gbs', to rank 0, which prints
+ *  one row per rank, one per node (the sum over its ranks, which ran
+ *  at the same time), and one for all ranks together ('gbs_all',
+ *  the total bytes over the slowest rank's time), then the median
+ *  node bandwidth and every node below 'threshold' times it. Every
+ *  rank must call it. Returns the number of flagged nodes on rank 0,
+ *  and 0 elsewhere.
+ */
+int reportCluster (FILE* fp, const char* kernel, const char* type,
+		   size_t n, size_t n_trials,
+		   long double gbs, long double gbs_all, double threshold);
+
+#endif
+
+/* eof */
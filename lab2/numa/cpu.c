@@ -0,0 +1,41 @@
+/**
+ *  \file cpu.c
+ *  \brief Implements the helpers shared by the kernels; see 'cpu.h'.
+ */
+
+#include <assert.h>
+
+#include "cpu.h"
+
+simd_t
+getSimd (void)
+{
+  static int isa = -1;
+  if (isa < 0) {
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx512f"))
+      isa = SIMD_AVX512F;
+    else if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")
+	     && __builtin_cpu_supports ("f16c"))
+      isa = SIMD_FMA;
+    else if (__builtin_cpu_supports ("avx") && __builtin_cpu_supports ("f16c"))
+      isa = SIMD_F16C;
+    else if (__builtin_cpu_supports ("avx"))
+      isa = SIMD_AVX;
+    else
+      isa = SIMD_SSE2;
+  }
+  return (simd_t)isa;
+}
+
+void
+getThreadChunk (size_t n, size_t align, size_t tid, size_t n_threads,
+		size_t* lo, size_t* hi)
+{
+  assert (align > 0 && tid < n_threads && lo && hi);
+  *lo = (n * tid / n_threads) / align * align;
+  *hi = (tid + 1 == n_threads) ? n
+    : (n * (tid + 1) / n_threads) / align * align;
+}
+
+/* eof */
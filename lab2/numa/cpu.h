@@ -0,0 +1,57 @@
+/**
+ *  \file cpu.h
+ *  \brief Machine parameters and helpers shared by the hand-written
+ *  kernels: the cache-line size, the run-time instruction-set
+ *  dispatch, and the split of an array among OpenMP threads.
+ */
+
+#if !defined (INC_CPU_H)
+#define INC_CPU_H
+
+#include <stddef.h>
+
+#if defined (_OPENMP)
+#include <omp.h>
+#endif
+
+#define CACHE_LINE 64 /*!< Bytes per cache line */
+
+/** Sets 'tid' and 'n_threads' inside a parallel region; leaves them be otherwise */
+#if defined (_OPENMP)
+#  define SET_THREAD_INFO(tid, n_threads)	\
+  tid = omp_get_thread_num ();			\
+  n_threads = omp_get_num_threads ()
+#else
+#  define SET_THREAD_INFO(tid, n_threads)
+#endif
+
+/**
+ *  Instruction-set levels, in increasing order: each implies the ones
+ *  before it on every CPU that has it.
+ */
+typedef enum
+{
+  SIMD_SSE2 = 0,
+  SIMD_AVX,
+  SIMD_F16C,    /*!< AVX and F16C */
+  SIMD_FMA,     /*!< AVX2, FMA, and F16C */
+  SIMD_AVX512F,
+  SIMD_LEVELS   /*!< Number of levels */
+} simd_t;
+
+/** Returns the highest level the CPU supports, detected on first use */
+simd_t getSimd (void);
+
+/**
+ *  Returns, in [*lo, *hi), the chunk of thread 'tid' of 'n_threads'
+ *  over n elements: each thread takes a contiguous chunk, as
+ *  'schedule(static)' would, that starts on a multiple of 'align'
+ *  elements, so that no two threads share a cache line when 'align'
+ *  spans one.
+ */
+void getThreadChunk (size_t n, size_t align, size_t tid, size_t n_threads,
+		     size_t* lo, size_t* hi);
+
+#endif
+
+/* eof */
@@ -1,67 +1,309 @@
 /**
  *  \file flush.c
- *  \brief Implements a routine to flush the cache.
+ *  \brief Implements routines to flush the cache.
+ *
+ *  flushBuffer() evicts the caches by reading one word per cache line
+ *  of a buffer larger than them, which is much cheaper than filling
+ *  one with random numbers: the reads run at memory bandwidth, and
+ *  clean lines need no write-back when they are evicted in turn.
  */
 
+#define _GNU_SOURCE
 #include <assert.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define CACHE_BYTES (12 * 1024 * 1024)
+#include <cpuid.h>
+#include <x86intrin.h>
 
-#ifdef _OPENMP /********** OpenMP implementation **********/
-#include <omp.h>
-void flushBuffer (void)
+#include "affinity.h"
+#include "cpu.h"
+#include "flush.h"
+
+#define CACHE_BYTES (12 * 1024 * 1024) /*!< Last-level cache size if detection fails */
+#define FLUSH_FACTOR 2 /*!< Bytes read per byte of cache */
+
+static size_t
+getThreadNum (void)
+{
+#if defined (_OPENMP)
+  return (size_t)omp_get_thread_num ();
+#else
+  return 0;
+#endif
+}
+
+/** Receives the sums of flushBuffer()'s reads, so that they are not optimized away */
+static volatile size_t flush_sink__ = 0;
+
+/* ====================================================================== */
+
+/** Returns the size of the last-level (data or unified) cache, from CPUID leaf 4, or 0 */
+static size_t
+getCpuidLastCacheBytes (void)
+{
+  unsigned int a, b, c, d, k;
+  unsigned int max_level = 0;
+  size_t bytes = 0;
+  if (__get_cpuid_max (0, NULL) < 4) return 0;
+  for (k = 0; ; ++k) {
+    unsigned int type, level;
+    __cpuid_count (4, k, a, b, c, d);
+    type = a & 0x1f;
+    if (!type) break; /* no more caches */
+    level = (a >> 5) & 0x7;
+    if (type != 2 && level >= max_level) { /* skip instruction caches */
+      max_level = level;
+      bytes = (size_t)((b >> 22) + 1) /* ways */
+        * (((b >> 12) & 0x3ff) + 1)   /* partitions */
+        * ((b & 0xfff) + 1)           /* line size */
+        * (c + 1);                    /* sets */
+    }
+  }
+  return bytes;
+}
+
+size_t
+getLastCacheBytes (void)
+{
+  static size_t bytes = 0;
+  if (!bytes) {
+    bytes = getCacheBytes (getLastCacheLevel ());
+    if (!bytes) bytes = getCpuidLastCacheBytes ();
+    if (!bytes) bytes = CACHE_BYTES;
+  }
+  return bytes;
+}
+
+/** Returns the total capacity of the data and unified caches of one socket */
+static size_t
+getSocketCacheBytes (void)
+{
+  static size_t bytes = 0;
+  if (!bytes) {
+    const struct topology_t* T = getTopology ();
+    const int cpus_per_socket = T->n_cpus / (T->n_sockets > 0 ? T->n_sockets : 1);
+    int k;
+    for (k = 0; k < T->n_caches; ++k) {
+      const struct cache_t* c = &T->caches[k];
+      int n_instances = cpus_per_socket / c->shared_by;
+      if (!strcmp (c->type, "Instruction")) continue;
+      if (n_instances < 1) n_instances = 1;
+      bytes += c->bytes * n_instances;
+    }
+    if (!bytes) bytes = getLastCacheBytes ();
+  }
+  return bytes;
+}
+
+/** Returns the socket of the calling thread's CPU */
+static int
+getCurrentSocket (void)
 {
-  static size_t n_cache = 0; /* in 'size_t' words */
-  static size_t* volatile * buffer = NULL;
+  const struct topology_t* T = getTopology ();
+  const int cpu = sched_getcpu ();
+  int i;
+  for (i = 0; i < T->n_cpus; ++i)
+    if (T->cpus[i].cpu == cpu)
+      return T->cpus[i].socket;
+  return 0;
+}
 
-  size_t n_threads = 0;
-#pragma omp parallel default(none) shared(n_threads)
+/**
+ *  Writes the socket of each thread to sockets[0:n-1], where n is at
+ *  most the maximum number of threads, and returns n.
+ */
+static size_t
+getThreadSockets (int* sockets)
+{
+  size_t n_threads = 1;
+#pragma omp parallel default(none) shared(sockets,n_threads)
   {
-#pragma omp master
-      n_threads = omp_get_num_threads ();
+    size_t tid = 0, n = 1;
+    SET_THREAD_INFO (tid, n);
+    sockets[tid] = getCurrentSocket ();
+    if (!tid) n_threads = n;
   }
+  return n_threads;
+}
 
+static size_t
+getMaxThreads (void)
+{
+#if defined (_OPENMP)
+  return (size_t)omp_get_max_threads ();
+#else
+  return 1;
+#endif
+}
 
-  if (!n_cache) {
-    n_cache = 4 * CACHE_BYTES / sizeof (size_t) / n_threads;
-    assert (n_cache);
+/** Returns the number of threads on each socket, in counts[0:n_sockets-1] */
+static void
+countThreadsPerSocket (size_t n_threads, const int* sockets, size_t* counts)
+{
+  const int n_sockets = getTopology ()->n_sockets;
+  size_t t;
+  memset (counts, 0, n_sockets * sizeof (size_t));
+  for (t = 0; t < n_threads; ++t)
+    if (sockets[t] >= 0 && sockets[t] < n_sockets)
+      ++counts[sockets[t]];
+}
 
-    assert (!buffer);
+size_t
+getFlushBytes (void)
+{
+  const int n_sockets = getTopology ()->n_sockets;
+  int* sockets = (int *)malloc (getMaxThreads () * sizeof (int));
+  size_t* counts = (size_t *)malloc (n_sockets * sizeof (size_t));
+  size_t n_threads, bytes = 0;
+  int s;
+  assert (sockets && counts);
+  n_threads = getThreadSockets (sockets);
+  countThreadsPerSocket (n_threads, sockets, counts);
+  for (s = 0; s < n_sockets; ++s)
+    if (counts[s])
+      bytes += FLUSH_FACTOR * getSocketCacheBytes ();
+  free (counts);
+  free (sockets);
+  return bytes;
+}
+
+/* ====================================================================== */
+
+void
+flushBuffer (void)
+{
+  static size_t n_buffers = 0; /* threads the buffers were allocated for */
+  static int* buffer_sockets = NULL; /* socket of each buffer's thread */
+  static size_t* n_words = NULL; /* length of each buffer, in 'size_t' words */
+  static size_t** buffer = NULL;
+
+  const int n_sockets = getTopology ()->n_sockets;
+  int* sockets = (int *)malloc (getMaxThreads () * sizeof (int));
+  size_t n_threads, t;
+  assert (sockets);
+  n_threads = getThreadSockets (sockets);
+
+  /* (Re)allocate after a change in the number of threads or their sockets */
+  if (n_threads != n_buffers
+      || memcmp (sockets, buffer_sockets, n_threads * sizeof (int))) {
+    size_t* counts = (size_t *)malloc (n_sockets * sizeof (size_t));
+    assert (counts);
+    for (t = 0; t < n_buffers; ++t)
+      free (buffer[t]);
+    free (buffer);
+    free (n_words);
+    free (buffer_sockets);
+
+    n_buffers = n_threads;
     buffer = (size_t **)malloc (n_threads * sizeof (size_t *));
-    assert (buffer);
+    n_words = (size_t *)malloc (n_threads * sizeof (size_t));
+    buffer_sockets = (int *)malloc (n_threads * sizeof (int));
+    assert (buffer && n_words && buffer_sockets);
+    memcpy (buffer_sockets, sockets, n_threads * sizeof (int));
 
-#pragma omp parallel default(none) shared(n_threads,buffer,n_cache)
+    countThreadsPerSocket (n_threads, sockets, counts);
+    for (t = 0; t < n_threads; ++t) {
+      const size_t share = counts[sockets[t]] ? counts[sockets[t]] : 1;
+      n_words[t] = FLUSH_FACTOR * getSocketCacheBytes () / share / sizeof (size_t);
+      assert (n_words[t]);
+    }
+    free (counts);
+
+    /* Each thread first-touches its own buffer, so it lands on its node */
+#pragma omp parallel default(none) shared(buffer,n_words)
     {
-      size_t tid = omp_get_thread_num ();
-      buffer[tid] = (size_t *)malloc (n_cache * sizeof (size_t));
+      const size_t tid = getThreadNum ();
+      buffer[tid] = (size_t *)malloc (n_words[tid] * sizeof (size_t));
       assert (buffer[tid]);
+      memset (buffer[tid], 0, n_words[tid] * sizeof (size_t));
     }
   }
+  free (sockets);
 
-#pragma omp parallel default(none) shared(buffer,n_cache)
+#pragma omp parallel default(none) shared(buffer,n_words,flush_sink__)
   {
-    const size_t tid = omp_get_thread_num ();
-    size_t i;
-    for (i = 0; i < n_cache; ++i)
-      buffer[tid][i] = lrand48 ();
+    const size_t stride = CACHE_LINE / sizeof (size_t);
+    const size_t tid = getThreadNum ();
+    size_t i, sum = 0;
+    for (i = 0; i < n_words[tid]; i += stride)
+      sum += buffer[tid][i];
+    if (sum) flush_sink__ = sum; /* never true, but the compiler cannot tell */
   }
 }
-#else  /********** sequential implementation **********/
-void flushBuffer (void)
+
+/* ====================================================================== */
+
+static int
+hasClflushopt (void)
+{
+  static int has = -1;
+  if (has < 0) {
+    unsigned int a, b, c, d;
+    has = __get_cpuid_max (0, NULL) >= 7;
+    if (has) {
+      __cpuid_count (7, 0, a, b, c, d);
+      has = (b >> 23) & 1;
+    }
+  }
+  return has;
+}
+
+__attribute__ ((target ("clflushopt")))
+static void
+flushLines__clflushopt (const char* A, size_t n_lines)
+{
+  size_t i;
+  for (i = 0; i < n_lines; ++i)
+    _mm_clflushopt ((void *)(A + i * CACHE_LINE));
+}
+
+static void
+flushLines__clflush (const char* A, size_t n_lines)
 {
-  static size_t n_cache = 0; /* in 'size_t' words */
-  static size_t* volatile buffer = NULL;
   size_t i;
-  if (!n_cache) {
-    n_cache = 4 * CACHE_BYTES / sizeof (size_t);
+  for (i = 0; i < n_lines; ++i)
+    _mm_clflush (A + i * CACHE_LINE);
+}
+
+void
+flushRange (const void* A, size_t bytes)
+{
+  const char* lo;
+  size_t n_lines;
+  int opt;
+  if (!A || !bytes) return;
 
-    assert (!buffer);
-    buffer = (size_t *)malloc (n_cache * sizeof (size_t));
-    assert (buffer);
+  lo = (const char *)((size_t)A & ~(size_t)(CACHE_LINE - 1));
+  n_lines = ((const char *)A + bytes - lo + CACHE_LINE - 1) / CACHE_LINE;
+  opt = hasClflushopt ();
+
+#pragma omp parallel default(none) shared(lo,n_lines,opt)
+  {
+    size_t tid = 0, n_threads = 1;
+    SET_THREAD_INFO (tid, n_threads);
+    const size_t first = n_lines * tid / n_threads;
+    const size_t last = n_lines * (tid + 1) / n_threads;
+    if (opt)
+      flushLines__clflushopt (lo + first * CACHE_LINE, last - first);
+    else
+      flushLines__clflush (lo + first * CACHE_LINE, last - first);
+    _mm_mfence (); /* CLFLUSHOPT is ordered only by fences */
+  }
+}
+
+void
+flushArrays (size_t bytes, const void* D, const void* A, const void* C)
+{
+  const size_t n_arrays = (D != NULL) + (A != NULL) + (C != NULL);
+  if (n_arrays * bytes < getFlushBytes ()) {
+    flushRange (D, bytes);
+    flushRange (A, bytes);
+    flushRange (C, bytes);
+  } else {
+    flushBuffer ();
   }
-  for (i = 0; i < n_cache; ++i)
-    buffer[i] = lrand48 ();
 }
-#endif
 
-// eof
+/* eof */
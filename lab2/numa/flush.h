@@ -1,8 +1,47 @@
 /**
  *  \file flush.h
- *  \brief Implements a routine to flush the cache.
+ *  \brief Implements routines to flush the cache.
  */
 
+#if !defined (INC_FLUSH_H)
+#define INC_FLUSH_H
+
+#include <stddef.h>
+
+/**
+ *  Returns the capacity, in bytes, of one instance of the last-level
+ *  cache: from sysfs if available, else from CPUID, else a default.
+ */
+size_t getLastCacheBytes (void);
+
+/**
+ *  Returns the number of bytes flushBuffer() reads, over all threads,
+ *  to evict the caches of every socket the threads run on.
+ */
+size_t getFlushBytes (void);
+
+/**
+ *  Evicts the caches by reading one buffer per thread. The buffers
+ *  are sized so that the threads on each socket together read twice
+ *  the capacity of that socket's caches, and each is first touched by
+ *  its own thread; they are reallocated whenever the number of
+ *  threads or their sockets change.
+ */
 void flushBuffer (void);
 
+/**
+ *  Writes back and invalidates every cache line of A[0:bytes-1], with
+ *  CLFLUSHOPT if the CPU has it (else CLFLUSH), in parallel.
+ */
+void flushRange (const void* A, size_t bytes);
+
+/**
+ *  Makes the arrays D, A, and C, each of 'bytes' bytes, cold in the
+ *  cache, by whichever of flushRange() and flushBuffer() touches less
+ *  memory. Any array may be NULL.
+ */
+void flushArrays (size_t bytes, const void* D, const void* A, const void* C);
+
+#endif
+
 /* eof */
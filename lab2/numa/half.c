@@ -0,0 +1,269 @@
+/**
+ *  \file half.c
+ *  \brief Implements the half-precision kernels; see 'half.h'.
+ *
+ *  Compilers do not vectorize conversions to and from half by
+ *  themselves, so, as in 'triad-nt.c', each kernel is written with the
+ *  F16C (or AVX-512F) conversion instructions, compiled once per
+ *  instruction set through the 'target' function attribute, and the
+ *  widest one the CPU supports is picked at run time. CPUs with
+ *  neither convert in software.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <x86intrin.h>
+
+#include "cpu.h"
+#include "half.h"
+
+/* ====================================================================== */
+
+float
+halfToFloat (half_t h)
+{
+  const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1f;
+  uint32_t man = h & 0x3ff;
+  uint32_t bits;
+  float x;
+
+  if (exp == 0x1f)      /* infinity or NaN */
+    bits = sign | 0x7f800000 | (man << 13);
+  else if (exp)         /* normal */
+    bits = sign | ((exp + 127 - 15) << 23) | (man << 13);
+  else if (!man)        /* zero */
+    bits = sign;
+  else {                /* subnormal: normalize */
+    exp = 127 - 15 + 1;
+    while (!(man & 0x400)) {
+      man <<= 1;
+      --exp;
+    }
+    bits = sign | (exp << 23) | ((man & 0x3ff) << 13);
+  }
+  memcpy (&x, &bits, sizeof (x));
+  return x;
+}
+
+half_t
+floatToHalf (float x)
+{
+  uint32_t bits, man, rem, halfway;
+  half_t sign, h;
+  int e, shift;
+
+  memcpy (&bits, &x, sizeof (bits));
+  sign = (half_t)((bits >> 16) & 0x8000);
+  man = bits & 0x7fffff;
+  if (((bits >> 23) & 0xff) == 0xff) /* infinity or NaN */
+    return sign | 0x7c00 | (man ? 0x200 : 0);
+
+  e = (int)((bits >> 23) & 0xff) - 127 + 15;
+  if (e >= 0x1f) /* overflow */
+    return sign | 0x7c00;
+  if (e <= 0) { /* subnormal, or too small */
+    if (e < -10) return sign;
+    man |= 0x800000;
+    shift = 14 - e;
+    h = (half_t)(man >> shift);
+    rem = man & ((1u << shift) - 1);
+    halfway = 1u << (shift - 1);
+  } else {
+    h = (half_t)((e << 10) | (man >> 13));
+    rem = man & 0x1fff;
+    halfway = 0x1000;
+  }
+  /* Round to nearest, ties to even; a carry correctly bumps the exponent */
+  if (rem > halfway || (rem == halfway && (h & 1)))
+    ++h;
+  return sign | h;
+}
+
+/* ====================================================================== */
+
+const char *
+getHalfSimdName (void)
+{
+  static const char* names[SIMD_LEVELS] = { "none", "none", "f16c", "f16c", "avx512f" };
+  return names[getSimd ()];
+}
+
+/** The kernels that convert; copy and fill only move bits */
+typedef enum { OP_SCALE, OP_ADD, OP_TRIAD, OP_SUM } op_t;
+
+/**
+ *  Per-thread kernels, for one instruction set: D[0:n-1] = op (A, C,
+ *  b), or, for OP_SUM, returns the sum of A[0:n-1]. Elements past the
+ *  last full vector are converted in software.
+ */
+#define DEFINE_HALF_SIMD(ISA, TARGET, VT, W, LOADH, STOREH, SET1, SETZERO, ADD, MUL) \
+  __attribute__ ((target (TARGET)))					\
+  static float								\
+  stream__half__##ISA (op_t op, size_t n, half_t* D, const half_t* A,	\
+		       const half_t* C, float b)			\
+  {									\
+    const VT vb = SET1 (b);						\
+    VT vsum = SETZERO ();						\
+    float sum = 0, lanes[W];						\
+    size_t i = 0;							\
+    int k;								\
+    switch (op) {							\
+    case OP_SCALE:							\
+      for (; i + W <= n; i += W)					\
+	STOREH (D + i, MUL (vb, LOADH (A + i)));			\
+      break;								\
+    case OP_ADD:							\
+      for (; i + W <= n; i += W)					\
+	STOREH (D + i, ADD (LOADH (A + i), LOADH (C + i)));		\
+      break;								\
+    case OP_TRIAD:							\
+      for (; i + W <= n; i += W)					\
+	STOREH (D + i, ADD (LOADH (A + i), MUL (vb, LOADH (C + i))));	\
+      break;								\
+    case OP_SUM:							\
+      for (; i + W <= n; i += W)					\
+	vsum = ADD (vsum, LOADH (A + i));				\
+      memcpy (lanes, &vsum, sizeof (lanes));				\
+      for (k = 0; k < W; ++k)						\
+	sum += lanes[k];						\
+      break;								\
+    }									\
+    return sum + stream__half__none (op, n - i, D + i, A + i, C + i, b); \
+  }
+
+static float
+stream__half__none (op_t op, size_t n, half_t* D, const half_t* A,
+		    const half_t* C, float b)
+{
+  float sum = 0;
+  size_t i;
+  switch (op) {
+  case OP_SCALE:
+    for (i = 0; i < n; ++i)
+      D[i] = floatToHalf (b * halfToFloat (A[i]));
+    break;
+  case OP_ADD:
+    for (i = 0; i < n; ++i)
+      D[i] = floatToHalf (halfToFloat (A[i]) + halfToFloat (C[i]));
+    break;
+  case OP_TRIAD:
+    for (i = 0; i < n; ++i)
+      D[i] = floatToHalf (halfToFloat (A[i]) + b * halfToFloat (C[i]));
+    break;
+  case OP_SUM:
+    for (i = 0; i < n; ++i)
+      sum += halfToFloat (A[i]);
+    break;
+  }
+  return sum;
+}
+
+#define LOADH_F16C(p) _mm256_cvtph_ps (_mm_loadu_si128 ((const __m128i *)(p)))
+#define STOREH_F16C(p, v)						\
+  _mm_storeu_si128 ((__m128i *)(p), _mm256_cvtps_ph ((v), _MM_FROUND_TO_NEAREST_INT))
+#define LOADH_AVX512F(p) _mm512_cvtph_ps (_mm256_loadu_si256 ((const __m256i *)(p)))
+#define STOREH_AVX512F(p, v)						\
+  _mm256_storeu_si256 ((__m256i *)(p), _mm512_cvtps_ph ((v), _MM_FROUND_TO_NEAREST_INT))
+
+DEFINE_HALF_SIMD (f16c, "avx,f16c", __m256, 8, LOADH_F16C, STOREH_F16C,
+		  _mm256_set1_ps, _mm256_setzero_ps, _mm256_add_ps, _mm256_mul_ps)
+DEFINE_HALF_SIMD (avx512f, "avx512f", __m512, 16, LOADH_AVX512F, STOREH_AVX512F,
+		  _mm512_set1_ps, _mm512_setzero_ps, _mm512_add_ps, _mm512_mul_ps)
+
+/* ======================================================================
+ * Parallel drivers: each thread takes its chunk (see 'getThreadChunk').
+ */
+
+static float
+stream__half__par (op_t op, size_t n, half_t* D, const half_t* A,
+		   const half_t* C, float b)
+{
+  const simd_t isa = getSimd ();
+  const size_t align = CACHE_LINE / sizeof (half_t);
+  float sum = 0;
+#pragma omp parallel default(none) shared(op,n,D,A,C,b,isa,align) reduction(+:sum)
+  {
+    size_t tid = 0, n_threads = 1;
+    SET_THREAD_INFO (tid, n_threads);
+    size_t lo, hi;
+    getThreadChunk (n, align, tid, n_threads, &lo, &hi);
+    switch (isa) {
+    case SIMD_AVX512F:
+      sum += stream__half__avx512f (op, hi - lo, D + lo, A + lo, C + lo, b);
+      break;
+    case SIMD_FMA:
+    case SIMD_F16C:
+      sum += stream__half__f16c (op, hi - lo, D + lo, A + lo, C + lo, b);
+      break;
+    default:
+      sum += stream__half__none (op, hi - lo, D + lo, A + lo, C + lo, b);
+      break;
+    }
+  }
+  return sum;
+}
+
+double
+copy__half (size_t n, void* D, const void* A, const void* C, double s)
+{
+  half_t* D_ = (half_t *)D;
+  const half_t* A_ = (const half_t *)A;
+  size_t i;
+#pragma omp parallel for simd default(none) shared(n,D_,A_) schedule(static)
+  for (i = 0; i < n; ++i)
+    D_[i] = A_[i];
+  return 0;
+}
+
+double
+scale__half (size_t n, void* D, const void* A, const void* C, double s)
+{
+  stream__half__par (OP_SCALE, n, (half_t *)D, (const half_t *)A, NULL, (float)s);
+  return 0;
+}
+
+double
+add__half (size_t n, void* D, const void* A, const void* C, double s)
+{
+  stream__half__par (OP_ADD, n, (half_t *)D, (const half_t *)A, (const half_t *)C, 0);
+  return 0;
+}
+
+double
+triad__half (size_t n, void* D, const void* A, const void* C, double s)
+{
+  stream__half__par (OP_TRIAD, n, (half_t *)D, (const half_t *)A, (const half_t *)C, (float)s);
+  return 0;
+}
+
+double
+sum__half (size_t n, void* D, const void* A, const void* C, double s)
+{
+  return stream__half__par (OP_SUM, n, NULL, (const half_t *)A, NULL, 0);
+}
+
+double
+fill__half (size_t n, void* D, const void* A, const void* C, double s)
+{
+  half_t* D_ = (half_t *)D;
+  const half_t b = floatToHalf ((float)s);
+  size_t i;
+#pragma omp parallel for simd default(none) shared(n,D_,b) schedule(static)
+  for (i = 0; i < n; ++i)
+    D_[i] = b;
+  return 0;
+}
+
+void
+initRandom__half (size_t n, half_t* A)
+{
+  size_t i;
+#pragma omp parallel for default(none) shared(n,A) schedule(static)
+  for (i = 0; i < n; ++i)
+    A[i] = floatToHalf ((float)drand48 ());
+}
+
+/* eof */
@@ -0,0 +1,44 @@
+/**
+ *  \file half.h
+ *  \brief IEEE binary16 ("half") elements, stored as 'uint16_t', and
+ *  the STREAM kernels over them; see 'stream.h'.
+ */
+
+#if !defined (INC_HALF_H)
+#define INC_HALF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint16_t half_t;
+
+/** Converts a half to a float (exactly). */
+float halfToFloat (half_t h);
+
+/** Converts a float to the nearest half (ties to even). */
+half_t floatToHalf (float x);
+
+/**
+ *  Returns the name of the instruction set the half kernels use at
+ *  run time: "avx512f" or "f16c" (hardware conversions), or "none"
+ *  (software conversions).
+ */
+const char* getHalfSimdName (void);
+
+/*
+ *  The kernels of 'stream.h', for half elements. Arithmetic is done in
+ *  single precision, and 'sum' accumulates in single precision.
+ */
+double copy__half (size_t n, void* D, const void* A, const void* C, double s);
+double scale__half (size_t n, void* D, const void* A, const void* C, double s);
+double add__half (size_t n, void* D, const void* A, const void* C, double s);
+double triad__half (size_t n, void* D, const void* A, const void* C, double s);
+double sum__half (size_t n, void* D, const void* A, const void* C, double s);
+double fill__half (size_t n, void* D, const void* A, const void* C, double s);
+
+/** Sets A[0:n-1] to uniform random values in [0, 1). */
+void initRandom__half (size_t n, half_t* A);
+
+#endif
+
+/* eof */
@@ -0,0 +1,211 @@
+/**
+ *  \file placement.c
+ *  \brief Implements NUMA page placement; see 'placement.h'.
+ *
+ *  The policies are applied through the mbind(2), set_mempolicy(2),
+ *  and move_pages(2) system calls directly, so that the benchmark
+ *  does not depend on libnuma.
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <linux/mempolicy.h>
+
+#if defined (_OPENMP)
+#include <omp.h>
+#endif
+
+#include "affinity.h"
+#include "placement.h"
+
+#define MAX_NODES 64 /*!< Largest node count supported by the node masks */
+#define MAX_PAGE_SAMPLES (1 << 16) /*!< Pages queried per array */
+
+/* ====================================================================== */
+
+int
+getNumNodes (void)
+{
+  static int n_nodes = 0;
+  if (!n_nodes) {
+    n_nodes = getTopology ()->n_nodes;
+    if (n_nodes > MAX_NODES) n_nodes = MAX_NODES;
+  }
+  return n_nodes;
+}
+
+/* ====================================================================== */
+
+/** Parses a NUMA node number, the whole of 's'; returns -1 if it is not one */
+static int
+parseNode (const char* s)
+{
+  char* end = NULL;
+  long node;
+  errno = 0;
+  node = strtol (s, &end, 10);
+  if (errno || end == s || *end || node < 0 || node > INT_MAX)
+    return -1;
+  return (int)node;
+}
+
+int
+parsePlacement (const char* s, placement_t* P)
+{
+  assert (s && P);
+  P->mem_node = -1;
+  P->cpu_node = -1;
+  if (!strcmp (s, "ft-par")) {
+    P->policy = PLACE_FT_PARALLEL;
+  } else if (!strcmp (s, "ft-serial")) {
+    P->policy = PLACE_FT_SERIAL;
+  } else if (!strcmp (s, "interleave")) {
+    P->policy = PLACE_INTERLEAVE;
+  } else if (!strncmp (s, "bind:", 5)) {
+    P->policy = PLACE_BIND;
+    P->mem_node = parseNode (s + 5);
+    if (P->mem_node < 0) return -1;
+  } else if (!strcmp (s, "remote") || !strncmp (s, "remote:", 7)) {
+    P->policy = PLACE_REMOTE;
+    P->cpu_node = s[6] ? parseNode (s + 7) : 0;
+    if (P->cpu_node < 0) return -1;
+    P->mem_node = (P->cpu_node + 1) % getNumNodes ();
+  } else {
+    return -1;
+  }
+  if (P->mem_node >= getNumNodes () || P->cpu_node >= getNumNodes ())
+    return -1;
+  return 0;
+}
+
+const char *
+getPlacementName (const placement_t* P, char* buf, size_t len)
+{
+  assert (P && buf);
+  switch (P->policy) {
+  case PLACE_FT_PARALLEL: snprintf (buf, len, "ft-par"); break;
+  case PLACE_FT_SERIAL: snprintf (buf, len, "ft-serial"); break;
+  case PLACE_INTERLEAVE: snprintf (buf, len, "interleave"); break;
+  case PLACE_BIND: snprintf (buf, len, "bind:%d", P->mem_node); break;
+  case PLACE_REMOTE: snprintf (buf, len, "remote:%d", P->cpu_node); break;
+  default: assert (0);
+  }
+  return buf;
+}
+
+/* ====================================================================== */
+
+void
+placeThreads (const placement_t* P, layout_t layout)
+{
+  assert (P);
+  pinThreads (layout, P->cpu_node);
+}
+
+/** Writes every page of A, serially, so that the master owns them. */
+static void
+touchPages (void* A, size_t bytes)
+{
+  const size_t page = (size_t)sysconf (_SC_PAGESIZE);
+  volatile char* p = (volatile char *)A;
+  for (size_t i = 0; i < bytes; i += page)
+    p[i] = 0;
+}
+
+static long
+mbind__ (void* A, size_t bytes, int mode, const unsigned long* mask)
+{
+  return syscall (SYS_mbind, A, bytes, mode, mask,
+                  mask ? (unsigned long)MAX_NODES + 1 : 0, MPOL_MF_MOVE);
+}
+
+void
+placeArray (const placement_t* P, void* A, size_t bytes)
+{
+  unsigned long mask[MAX_NODES / (8 * sizeof (unsigned long))];
+  assert (P);
+  assert (((size_t)A % (size_t)sysconf (_SC_PAGESIZE)) == 0);
+  if (!bytes) return;
+
+  memset (mask, 0, sizeof (mask));
+  switch (P->policy) {
+  case PLACE_FT_PARALLEL:
+  case PLACE_FT_SERIAL:
+    /* Undo any inherited policy (e.g., from numactl) for the master */
+    syscall (SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+    if (mbind__ (A, bytes, MPOL_DEFAULT, NULL))
+      perror ("mbind (MPOL_DEFAULT)");
+    if (P->policy == PLACE_FT_SERIAL)
+      touchPages (A, bytes);
+    break;
+  case PLACE_INTERLEAVE:
+    for (int k = 0; k < getNumNodes (); ++k)
+      mask[k / (8 * sizeof (unsigned long))] |= 1ul << (k % (8 * sizeof (unsigned long)));
+    if (mbind__ (A, bytes, MPOL_INTERLEAVE, mask))
+      perror ("mbind (MPOL_INTERLEAVE)");
+    break;
+  case PLACE_BIND:
+  case PLACE_REMOTE:
+    assert (P->mem_node >= 0 && P->mem_node < MAX_NODES);
+    mask[P->mem_node / (8 * sizeof (unsigned long))] |=
+      1ul << (P->mem_node % (8 * sizeof (unsigned long)));
+    if (mbind__ (A, bytes, MPOL_BIND, mask))
+      perror ("mbind (MPOL_BIND)");
+    break;
+  default:
+    assert (0);
+  }
+}
+
+/* ====================================================================== */
+
+void
+printPageDistribution (FILE* fp, const char* tag, const void* A, size_t bytes)
+{
+  const size_t page = (size_t)sysconf (_SC_PAGESIZE);
+  const size_t n_pages = (bytes + page - 1) / page;
+  const size_t stride = n_pages > MAX_PAGE_SAMPLES
+    ? (n_pages + MAX_PAGE_SAMPLES - 1) / MAX_PAGE_SAMPLES : 1;
+  const size_t n_samples = (n_pages + stride - 1) / stride;
+  const int n_nodes = getNumNodes ();
+  size_t counts[MAX_NODES + 1]; /* counts[n_nodes]: not resident */
+
+  if (!n_samples) return;
+
+  void** pages = (void **)malloc (n_samples * sizeof (void *));
+  int* status = (int *)malloc (n_samples * sizeof (int));
+  assert (pages && status);
+  for (size_t i = 0; i < n_samples; ++i)
+    pages[i] = (char *)A + i * stride * page;
+
+  memset (counts, 0, sizeof (counts));
+  if (syscall (SYS_move_pages, 0, n_samples, pages, NULL, status, 0)) {
+    perror ("move_pages");
+  } else {
+    for (size_t i = 0; i < n_samples; ++i) {
+      if (status[i] >= 0 && status[i] < n_nodes)
+        ++counts[status[i]];
+      else
+        ++counts[n_nodes];
+    }
+    fprintf (fp, "# pages(%s):", tag);
+    for (int k = 0; k < n_nodes; ++k)
+      fprintf (fp, " node%d=%.1f%%", k, 100.0 * counts[k] / n_samples);
+    if (counts[n_nodes])
+      fprintf (fp, " unmapped=%.1f%%", 100.0 * counts[n_nodes] / n_samples);
+    fprintf (fp, "\n");
+  }
+
+  free (status);
+  free (pages);
+}
+
+/* eof */
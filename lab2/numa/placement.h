@@ -0,0 +1,65 @@
+/**
+ *  \file placement.h
+ *  \brief NUMA page placement policies for the benchmark arrays.
+ */
+
+#if !defined (INC_PLACEMENT_H)
+#define INC_PLACEMENT_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "affinity.h"
+
+typedef enum
+{
+  PLACE_FT_PARALLEL = 0, /*!< First touch by the (parallel) initialization */
+  PLACE_FT_SERIAL,       /*!< First touch by the master thread */
+  PLACE_INTERLEAVE,      /*!< Pages interleaved round-robin over all nodes */
+  PLACE_BIND,            /*!< All pages on one node */
+  PLACE_REMOTE           /*!< Threads on one node, pages on another */
+} placement_policy_t;
+
+typedef struct
+{
+  placement_policy_t policy;
+  int mem_node; /*!< Node holding the pages (PLACE_BIND, PLACE_REMOTE) */
+  int cpu_node; /*!< Node the threads run on, or -1 for anywhere */
+} placement_t;
+
+/** Returns the number of NUMA nodes (at least 1). */
+int getNumNodes (void);
+
+/**
+ *  Parses a policy name: "ft-par", "ft-serial", "interleave",
+ *  "bind:<k>", "remote" or "remote:<k>" (threads on node k, pages on
+ *  node k+1). Returns 0 on success, or -1 for an unknown name or a
+ *  node k that is not a number of an existing node.
+ */
+int parsePlacement (const char* s, placement_t* P);
+
+/** Writes the name of a policy, as accepted by parsePlacement(), to buf. */
+const char* getPlacementName (const placement_t* P, char* buf, size_t len);
+
+/**
+ *  Pins the OpenMP threads under the given layout (see 'affinity.h')
+ *  to the CPUs of the policy's 'cpu_node', or of all nodes if it is
+ *  -1.
+ */
+void placeThreads (const placement_t* P, layout_t layout);
+
+/**
+ *  Applies the policy to a newly allocated, page-aligned array of
+ *  'bytes' bytes. Call it before the array is first written.
+ */
+void placeArray (const placement_t* P, void* A, size_t bytes);
+
+/**
+ *  Queries where the pages of A[0:bytes-1] reside, and prints the
+ *  percentage of pages on each node as a '#'-comment line.
+ */
+void printPageDistribution (FILE* fp, const char* tag, const void* A, size_t bytes);
+
+#endif
+
+/* eof */
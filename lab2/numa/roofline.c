@@ -0,0 +1,178 @@
+/**
+ *  \file roofline.c
+ *  \brief Implements the tunable-intensity kernel; see 'roofline.h'.
+ *
+ *  As in 'triad-nt.c', the kernel is compiled once per instruction
+ *  set, through the 'target' function attribute, and the widest one
+ *  the CPU supports is picked at run time. Each thread streams its
+ *  chunk ROOFLINE_CHAINS vectors at a time and runs the chain on all
+ *  of them in lockstep: the vectors are independent, so their
+ *  multiply-adds overlap in the pipeline.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <x86intrin.h>
+
+#include "cpu.h"
+#include "roofline.h"
+
+const char *
+getRooflineSimdName (void)
+{
+  static const char* names[SIMD_LEVELS] = { "sse2", "avx", "avx", "fma", "avx512f" };
+  return names[getSimd ()];
+}
+
+static size_t flops__ = 2;
+
+void
+setRooflineFlops (size_t flops)
+{
+  assert (flops == 1 || (flops > 0 && flops % 2 == 0));
+  flops__ = flops;
+}
+
+size_t
+getRooflineFlops (void)
+{
+  return flops__;
+}
+
+double
+getRooflineIntensity (elemtype_t type, size_t flops)
+{
+  return (double)flops / getStreamBytes (&roofline_kernel, type, 1);
+}
+
+size_t
+getRooflineFlopsFor (elemtype_t type, int log2)
+{
+  const double flops = ldexp ((double)getStreamBytes (&roofline_kernel, type, 1), log2);
+  if (flops < 1 || (flops > 1 && fmod (flops, 2) != 0))
+    return 0;
+  return (size_t)flops;
+}
+
+/* ======================================================================
+ * Per-thread kernels, for one element type and one instruction set.
+ * 'n_fma' is the chain length; 0 means a single add instead.
+ */
+
+#define ROOFLINE_CHAINS 8 /*!< Independent vectors per step */
+
+#define FOR_CHAINS(OP, ...)					\
+  OP (0, __VA_ARGS__) OP (1, __VA_ARGS__) OP (2, __VA_ARGS__) OP (3, __VA_ARGS__) \
+  OP (4, __VA_ARGS__) OP (5, __VA_ARGS__) OP (6, __VA_ARGS__) OP (7, __VA_ARGS__)
+
+#define DECLARE_CHAIN(k, VT, LOADU, W) VT x##k = LOADU (A + i + (k)*W);
+#define ADD_CHAIN(k, ADD) x##k = ADD (x##k, vb);
+#define STEP_CHAIN(k, MULADD) x##k = MULADD (x##k, va, vb);
+#define STORE_CHAIN(k, STOREU, W) STOREU (D + i + (k)*W, x##k);
+
+/* Multiply-add without FMA instructions: still 2 flops */
+#define MULADD_SSE_PS(x, a, b) _mm_add_ps (_mm_mul_ps ((x), (a)), (b))
+#define MULADD_SSE_PD(x, a, b) _mm_add_pd (_mm_mul_pd ((x), (a)), (b))
+#define MULADD_AVX_PS(x, a, b) _mm256_add_ps (_mm256_mul_ps ((x), (a)), (b))
+#define MULADD_AVX_PD(x, a, b) _mm256_add_pd (_mm256_mul_pd ((x), (a)), (b))
+
+#define DEFINE_ROOFLINE_SIMD(T, ISA, TARGET, VT, W, LOADU, STOREU, SET1, ADD, MULADD) \
+  __attribute__ ((target (TARGET)))					\
+  static void								\
+  roofline__##T##__##ISA (size_t n, T* D, const T* A, T a, T b, size_t n_fma) \
+  {									\
+    const VT va = SET1 (a), vb = SET1 (b);				\
+    size_t i = 0, m;							\
+    for (; i + ROOFLINE_CHAINS * W <= n; i += ROOFLINE_CHAINS * W) {	\
+      FOR_CHAINS (DECLARE_CHAIN, VT, LOADU, W)				\
+      if (!n_fma) {							\
+	FOR_CHAINS (ADD_CHAIN, ADD)					\
+      }									\
+      for (m = 0; m < n_fma; ++m) {					\
+	FOR_CHAINS (STEP_CHAIN, MULADD)					\
+      }									\
+      FOR_CHAINS (STORE_CHAIN, STOREU, W)				\
+    }									\
+    for (; i < n; ++i) {						\
+      T x = A[i];							\
+      if (!n_fma) x += b;						\
+      for (m = 0; m < n_fma; ++m)					\
+	x = x*a + b;							\
+      D[i] = x;								\
+    }									\
+  }
+
+DEFINE_ROOFLINE_SIMD (float, sse2, "sse2", __m128, 4,
+		      _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps,
+		      _mm_add_ps, MULADD_SSE_PS)
+DEFINE_ROOFLINE_SIMD (float, avx, "avx", __m256, 8,
+		      _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+		      _mm256_add_ps, MULADD_AVX_PS)
+DEFINE_ROOFLINE_SIMD (float, fma, "avx2,fma", __m256, 8,
+		      _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps,
+		      _mm256_add_ps, _mm256_fmadd_ps)
+DEFINE_ROOFLINE_SIMD (float, avx512f, "avx512f", __m512, 16,
+		      _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps,
+		      _mm512_add_ps, _mm512_fmadd_ps)
+
+DEFINE_ROOFLINE_SIMD (double, sse2, "sse2", __m128d, 2,
+		      _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd,
+		      _mm_add_pd, MULADD_SSE_PD)
+DEFINE_ROOFLINE_SIMD (double, avx, "avx", __m256d, 4,
+		      _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd,
+		      _mm256_add_pd, MULADD_AVX_PD)
+DEFINE_ROOFLINE_SIMD (double, fma, "avx2,fma", __m256d, 4,
+		      _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd,
+		      _mm256_add_pd, _mm256_fmadd_pd)
+DEFINE_ROOFLINE_SIMD (double, avx512f, "avx512f", __m512d, 8,
+		      _mm512_loadu_pd, _mm512_storeu_pd, _mm512_set1_pd,
+		      _mm512_add_pd, _mm512_fmadd_pd)
+
+/* ======================================================================
+ * Parallel drivers: each thread takes its chunk (see 'getThreadChunk').
+ */
+
+#define DEFINE_ROOFLINE_KERNEL(T)					\
+  static double								\
+  roofline__##T (size_t n, void* D_, const void* A_, const void* C_, double s) \
+  {									\
+    T* D = (T *)D_; const T* A = (const T *)A_;				\
+    const T a = (T)s, b = (T)(1 - s);					\
+    const simd_t isa = getSimd ();					\
+    const size_t n_fma = flops__ / 2;					\
+    const size_t align = CACHE_LINE / sizeof (T);			\
+    _Pragma ("omp parallel default(none) shared(n,D,A,a,b,isa,n_fma,align)") \
+    {									\
+      size_t tid = 0, n_threads = 1;					\
+      SET_THREAD_INFO (tid, n_threads);					\
+      size_t lo, hi;							\
+      getThreadChunk (n, align, tid, n_threads, &lo, &hi);		\
+      switch (isa) {							\
+      case SIMD_AVX512F:						\
+	roofline__##T##__avx512f (hi - lo, D + lo, A + lo, a, b, n_fma); \
+	break;								\
+      case SIMD_FMA:							\
+	roofline__##T##__fma (hi - lo, D + lo, A + lo, a, b, n_fma);	\
+	break;								\
+      case SIMD_F16C:							\
+      case SIMD_AVX:							\
+	roofline__##T##__avx (hi - lo, D + lo, A + lo, a, b, n_fma);	\
+	break;								\
+      default:								\
+	roofline__##T##__sse2 (hi - lo, D + lo, A + lo, a, b, n_fma);	\
+	break;								\
+      }									\
+    }									\
+    return 0;								\
+  }
+
+DEFINE_ROOFLINE_KERNEL (float)
+DEFINE_ROOFLINE_KERNEL (double)
+
+const stream_kernel_t roofline_kernel =
+  { "roofline", "D[i] = f(A[i]), a chain of multiply-adds", 1, 1, 0,
+    { roofline__float, roofline__double } };
+
+/* eof */
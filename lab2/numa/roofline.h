@@ -0,0 +1,59 @@
+/**
+ *  \file roofline.h
+ *  \brief A streaming kernel of tunable arithmetic intensity, for
+ *  locating the compute and memory ceilings of a roofline.
+ */
+
+#if !defined (INC_ROOFLINE_H)
+#define INC_ROOFLINE_H
+
+#include <stddef.h>
+
+#include "stream.h"
+
+/** Intensities, in flops per byte, from 2^ROOFLINE_MIN_LOG2 to 2^ROOFLINE_MAX_LOG2 */
+#define ROOFLINE_MIN_LOG2 (-4)
+#define ROOFLINE_MAX_LOG2 6
+
+/**
+ *  Returns the name of the instruction set the kernel uses at run
+ *  time ("avx512f", "fma", "avx", or "sse2"); only the first two have
+ *  fused multiply-adds, the others do a multiply and an add.
+ */
+const char* getRooflineSimdName (void);
+
+/**
+ *  Sets the flops per element of the kernel: 1 (a single add), or an
+ *  even number, 'flops/2' multiply-adds per element.
+ */
+void setRooflineFlops (size_t flops);
+
+/** Returns the current flops per element. */
+size_t getRooflineFlops (void);
+
+/**
+ *  Returns the flops per element that give the intensity 2^log2 for
+ *  the given type, or 0 if no valid setting does (e.g., less than one
+ *  flop per element).
+ */
+size_t getRooflineFlopsFor (elemtype_t type, int log2);
+
+/**
+ *  Returns the arithmetic intensity, in flops per byte, of the kernel
+ *  at 'flops' flops per element, counting the bytes as getStreamBytes()
+ *  does.
+ */
+double getRooflineIntensity (elemtype_t type, size_t flops);
+
+/**
+ *  D[i] = f(A[i]), where f is a chain of multiply-adds x <- s*x + (1-s)
+ *  (so values stay near 1), of the length set by setRooflineFlops().
+ *  Each thread runs several independent chains, so that the
+ *  multiply-add latency is hidden and the kernel can reach the peak
+ *  flop rate once it is compute-bound.
+ */
+extern const stream_kernel_t roofline_kernel;
+
+#endif
+
+/* eof */
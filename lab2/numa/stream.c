@@ -0,0 +1,169 @@
+/**
+ *  \file stream.c
+ *  \brief Implements the STREAM-style kernel suite; see 'stream.h'.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "stream.h"
+#include "triad-nt.h"
+#include "half.h"
+
+/* ======================================================================
+ * The kernels are written once, as a macro over the element type, and
+ * instantiated for each type in 'elemtype_t' but half (see 'half.h').
+ *
+ * Vectorization hints are portable: the OpenMP 'simd' construct, with
+ * an 'aligned' clause for the STREAM_ALIGN-byte aligned arrays,
+ * replaces Intel's __assume_aligned; and with GCC and Clang, each
+ * kernel is cloned per instruction set ('target_clones') and the
+ * widest clone the CPU supports is picked when the program loads. (For
+ * the same with icc, build with '-ax'; see the Makefile.)
+ */
+
+#define PRAGMA(...) PRAGMA__ (__VA_ARGS__) /* expands STREAM_ALIGN first */
+#define PRAGMA__(...) _Pragma (#__VA_ARGS__)
+
+#define OMP_FOR(...)							\
+  PRAGMA (omp parallel for simd schedule(static) aligned(__VA_ARGS__:STREAM_ALIGN))
+#define OMP_FOR_SUM(...)						\
+  PRAGMA (omp parallel for simd schedule(static) aligned(__VA_ARGS__:STREAM_ALIGN) reduction(+:sum))
+
+#if defined (__has_attribute) && !defined (__INTEL_COMPILER)
+#  if __has_attribute (target_clones)
+#    define TARGET_CLONES __attribute__ ((target_clones ("avx512f", "avx2", "avx", "default")))
+#  endif
+#endif
+#if !defined (TARGET_CLONES)
+#  define TARGET_CLONES
+#endif
+
+#define DEFINE_STREAM_KERNELS(T)					\
+  TARGET_CLONES static double copy__##T (size_t n, void* D_, const void* A_, const void* C_, double s) \
+  {									\
+    T* D = (T *)D_; const T* A = (const T *)A_;				\
+    size_t i;								\
+    OMP_FOR (D,A)							\
+    for (i = 0; i < n; ++i)						\
+      D[i] = A[i];							\
+    return 0;								\
+  }									\
+									\
+  TARGET_CLONES static double scale__##T (size_t n, void* D_, const void* A_, const void* C_, double s) \
+  {									\
+    T* D = (T *)D_; const T* A = (const T *)A_; const T b = (T)s;	\
+    size_t i;								\
+    OMP_FOR (D,A)							\
+    for (i = 0; i < n; ++i)						\
+      D[i] = b*A[i];							\
+    return 0;								\
+  }									\
+									\
+  TARGET_CLONES static double add__##T (size_t n, void* D_, const void* A_, const void* C_, double s) \
+  {									\
+    T* D = (T *)D_; const T* A = (const T *)A_; const T* C = (const T *)C_; \
+    size_t i;								\
+    OMP_FOR (D,A,C)							\
+    for (i = 0; i < n; ++i)						\
+      D[i] = A[i] + C[i];						\
+    return 0;								\
+  }									\
+									\
+  TARGET_CLONES static double triad__##T (size_t n, void* D_, const void* A_, const void* C_, double s) \
+  {									\
+    T* D = (T *)D_; const T* A = (const T *)A_; const T* C = (const T *)C_; \
+    const T b = (T)s;							\
+    size_t i;								\
+    OMP_FOR (D,A,C)							\
+    for (i = 0; i < n; ++i)						\
+      D[i] = A[i] + b*C[i];						\
+    return 0;								\
+  }									\
+									\
+  TARGET_CLONES static double sum__##T (size_t n, void* D_, const void* A_, const void* C_, double s) \
+  {									\
+    const T* A = (const T *)A_;						\
+    T sum = 0;								\
+    size_t i;								\
+    OMP_FOR_SUM (A)							\
+    for (i = 0; i < n; ++i)						\
+      sum += A[i];							\
+    return sum;								\
+  }									\
+									\
+  TARGET_CLONES static double fill__##T (size_t n, void* D_, const void* A_, const void* C_, double s) \
+  {									\
+    T* D = (T *)D_; const T b = (T)s;					\
+    size_t i;								\
+    OMP_FOR (D)								\
+    for (i = 0; i < n; ++i)						\
+      D[i] = b;								\
+    return 0;								\
+  }									\
+									\
+  static void initRandom__##T (size_t n, T* A)				\
+  {									\
+    size_t i;								\
+    _Pragma ("omp parallel for schedule(static)")			\
+    for (i = 0; i < n; ++i)						\
+      A[i] = (T)drand48 ();						\
+  }
+
+DEFINE_STREAM_KERNELS (float)
+DEFINE_STREAM_KERNELS (double)
+
+/* ====================================================================== */
+
+const stream_kernel_t stream_kernels[] = {
+  { "copy",  "D[i] = A[i]",          1, 1, 0, { copy__float,  copy__double,  copy__half  } },
+  { "scale", "D[i] = s*A[i]",        1, 1, 0, { scale__float, scale__double, scale__half } },
+  { "add",   "D[i] = A[i] + C[i]",   2, 1, 0, { add__float,   add__double,   add__half   } },
+  { "triad", "D[i] = A[i] + s*C[i]", 2, 1, 0, { triad__float, triad__double, triad__half } },
+  { "triad-nt", "triad, streaming stores", 2, 1, 0,
+    { triad_nt__float, triad_nt__double } },
+  { "triad-pf", "triad, software prefetch", 2, 1, 1,
+    { triad_pf__float, triad_pf__double } },
+  { "triad-ntpf", "triad, streaming stores and software prefetch", 2, 1, 1,
+    { triad_ntpf__float, triad_ntpf__double } },
+  { "sum",   "s += A[i]",            1, 0, 0, { sum__float,   sum__double,   sum__half   } },
+  { "fill",  "D[i] = s",             0, 1, 0, { fill__float,  fill__double,  fill__half  } }
+};
+
+const size_t stream_num_kernels = sizeof (stream_kernels) / sizeof (stream_kernels[0]);
+
+const char *
+getTypeName (elemtype_t type)
+{
+  static const char* names[NUM_TYPES] = { "float", "double", "half" };
+  assert (type < NUM_TYPES);
+  return names[type];
+}
+
+size_t
+getTypeSize (elemtype_t type)
+{
+  static const size_t sizes[NUM_TYPES] = { sizeof (float), sizeof (double), sizeof (half_t) };
+  assert (type < NUM_TYPES);
+  return sizes[type];
+}
+
+size_t
+getStreamBytes (const stream_kernel_t* kernel, elemtype_t type, size_t n)
+{
+  assert (kernel);
+  return (kernel->n_read + kernel->n_write) * getTypeSize (type) * n;
+}
+
+void
+initRandom__aligned (elemtype_t type, size_t n, void* A)
+{
+  switch (type) {
+  case TYPE_FLOAT: initRandom__float (n, (float *)A); break;
+  case TYPE_DOUBLE: initRandom__double (n, (double *)A); break;
+  case TYPE_HALF: initRandom__half (n, (half_t *)A); break;
+  default: assert (0);
+  }
+}
+
+/* eof */
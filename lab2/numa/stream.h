@@ -0,0 +1,67 @@
+/**
+ *  \file stream.h
+ *  \brief STREAM-style bandwidth kernels, in single, double, and half
+ *  precision.
+ */
+
+#if !defined (INC_STREAM_H)
+#define INC_STREAM_H
+
+#include <stddef.h>
+
+/** Element types for which the kernels are instantiated */
+typedef enum
+{
+  TYPE_FLOAT = 0,
+  TYPE_DOUBLE,
+  TYPE_HALF,   /*!< IEEE binary16, stored as 'uint16_t'; see 'half.h' */
+  NUM_TYPES
+} elemtype_t;
+
+/** Alignment, in bytes, that the kernels assume of every array */
+#define STREAM_ALIGN 64
+
+/** Returns the name of an element type, e.g., "float" */
+const char* getTypeName (elemtype_t type);
+
+/** Returns the size, in bytes, of an element */
+size_t getTypeSize (elemtype_t type);
+
+/**
+ *  A bandwidth kernel over n-element arrays D, A, and C, with scalar
+ *  s. Each kernel touches only the arrays it needs; reductions return
+ *  their result, all other kernels return 0.
+ */
+typedef double (*stream_fn_t) (size_t n, void* D, const void* A, const void* C, double s);
+
+typedef struct
+{
+  const char* name;
+  const char* desc;
+  size_t n_read;  /*!< Arrays read per element */
+  size_t n_write; /*!< Arrays written per element */
+  int prefetch;   /*!< Uses the prefetch distance; see 'triad-nt.h' */
+  stream_fn_t fn[NUM_TYPES]; /*!< NULL for types the kernel lacks */
+} stream_kernel_t;
+
+/**
+ *  The kernel suite: copy, scale, add, triad (plus its vectorized
+ *  variants from 'triad-nt.h', in single and double precision only),
+ *  sum, and fill.
+ */
+extern const stream_kernel_t stream_kernels[];
+extern const size_t stream_num_kernels;
+
+/**
+ *  Returns the number of bytes a kernel moves over n elements of the
+ *  given type, counting each array read or written once (as STREAM
+ *  does; write-allocate traffic is not counted).
+ */
+size_t getStreamBytes (const stream_kernel_t* kernel, elemtype_t type, size_t n);
+
+/** Sets A[0:n-1] to uniform random values in [0, 1). */
+void initRandom__aligned (elemtype_t type, size_t n, void* A);
+
+#endif
+
+/* eof */
@@ -0,0 +1,235 @@
+/**
+ *  \file sweep.c
+ *  \brief Implements the working-set sweep; see 'sweep.h'.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#if defined (_OPENMP)
+#include <omp.h>
+#endif
+
+#include "affinity.h"
+#include "cpu.h"
+#include "flush.h"
+#include "sweep.h"
+
+/** Shortest timing, in seconds, for a batch of warm repetitions */
+#define SWEEP_MIN_SECONDS 2e-3
+
+/** Sizes below this multiple of the last-level cache are flushed */
+#define SWEEP_FLUSH_FACTOR 4
+
+/** Largest relative deviation of a point from its plateau's level */
+#define PLATEAU_TOLERANCE 0.15
+
+/** Fewest points that make a plateau */
+#define PLATEAU_MIN_POINTS 3
+
+size_t
+getAggregateCacheBytes (int level)
+{
+  const struct topology_t* T = getTopology ();
+  int n_threads = 1;
+  int k;
+#if defined (_OPENMP)
+  n_threads = omp_get_max_threads ();
+#endif
+  for (k = 0; k < T->n_caches; ++k) {
+    const struct cache_t* c = &T->caches[k];
+    if (c->level == level && c->type[0] != 'I') {
+      /* Assume the threads spread over as many instances as they can */
+      int n_instances = T->n_cpus / c->shared_by;
+      if (n_instances > n_threads) n_instances = n_threads;
+      if (n_instances < 1) n_instances = 1;
+      return c->bytes * n_instances;
+    }
+  }
+  return 0;
+}
+
+/** Returns the best time of n_trials batches of 'reps' back-to-back calls */
+static long double
+timeBatches (const stream_kernel_t* kernel, elemtype_t type, size_t n,
+             size_t reps, size_t n_trials, int flush,
+             void* D, const void* A, const void* C, double b,
+             struct stopwatch_t* timer)
+{
+  long double t_min = 0;
+  size_t k, r;
+  for (k = 0; k < n_trials; ++k) {
+    long double t;
+    if (flush) flushArrays (n * getTypeSize (type), D, A, C);
+    stopwatch_start (timer);
+    for (r = 0; r < reps; ++r)
+      kernel->fn[type] (n, D, A, C, b);
+    t = stopwatch_stop (timer);
+    if (!k || t < t_min) t_min = t;
+  }
+  return t_min;
+}
+
+int
+sweepWorkingSets (const stream_kernel_t* kernel, elemtype_t type,
+                  size_t n_max, size_t n_trials,
+                  void* D, const void* A, const void* C, double b,
+                  struct stopwatch_t* timer,
+                  sweep_point_t* points, int max_points)
+{
+  const size_t line = CACHE_LINE / getTypeSize (type);
+  const size_t llc_bytes = getAggregateCacheBytes (getLastCacheLevel ());
+  const size_t bytes_per_elem = getStreamBytes (kernel, type, 1);
+  size_t n_last = 0;
+  int n_points = 0;
+  int k;
+
+  assert (kernel && points);
+  assert (bytes_per_elem > 0);
+  for (k = 0; n_points < max_points; ++k) {
+    const double target = SWEEP_MIN_BYTES * pow (2.0, (double)k / SWEEP_STEPS_PER_OCTAVE);
+    size_t n = (size_t)(target / bytes_per_elem) / line * line;
+    sweep_point_t* p = &points[n_points];
+    long double t;
+
+    if (n < line) n = line;
+    if (n > n_max) break;
+    if (n == n_last) continue;
+    n_last = n;
+
+    p->n = n;
+    p->bytes = getStreamBytes (kernel, type, n);
+    p->flushed = llc_bytes && p->bytes >= llc_bytes
+      && p->bytes < SWEEP_FLUSH_FACTOR * llc_bytes;
+    p->reps = 1;
+    if (!llc_bytes || p->bytes < llc_bytes) {
+      /* In cache: warm it up, then repeat until the timer can resolve it */
+      kernel->fn[type] (n, D, A, C, b);
+      while ((t = timeBatches (kernel, type, n, p->reps, 1, 0, D, A, C, b, timer))
+             < SWEEP_MIN_SECONDS)
+        p->reps = (t > SWEEP_MIN_SECONDS / 16) /* long enough to extrapolate */
+          ? (size_t)(p->reps * 1.25 * SWEEP_MIN_SECONDS / t) + 1
+          : p->reps * 8;
+    }
+    t = timeBatches (kernel, type, n, p->reps, n_trials, p->flushed,
+                     D, A, C, b, timer);
+    p->gbs = (long double)p->bytes * p->reps * 1e-9 / t;
+    ++n_points;
+  }
+  return n_points;
+}
+
+/* ====================================================================== */
+
+static int
+compareLongDouble (const void* a, const void* b)
+{
+  long double x = *(const long double *)a, y = *(const long double *)b;
+  return (x < y) ? -1 : (x > y);
+}
+
+/** Returns the smallest cache level whose aggregate capacity holds 'bytes', or 0 */
+static int
+getHoldingLevel (size_t bytes)
+{
+  const int last = getLastCacheLevel ();
+  int level;
+  for (level = 1; level <= last; ++level) {
+    const size_t capacity = getAggregateCacheBytes (level);
+    if (capacity && bytes <= capacity)
+      return level;
+  }
+  return 0;
+}
+
+/** Returns the median of three values */
+static long double
+median3 (long double a, long double b, long double c)
+{
+  if (a > b) { long double t = a; a = b; b = t; }
+  return (c < a) ? a : (c > b) ? b : c;
+}
+
+/** Tests whether two bandwidths are within PLATEAU_TOLERANCE of each other */
+static int
+isNear (long double x, long double y)
+{
+  return fabsl (logl (x / y)) < logl (1 + PLATEAU_TOLERANCE);
+}
+
+int
+findPlateaus (const sweep_point_t* points, int n_points,
+              plateau_t* plateaus, int max_plateaus)
+{
+  long double* gbs = (long double *)malloc (2 * n_points * sizeof (long double));
+  long double* smooth = gbs + n_points;
+  int n_plateaus = 0;
+  int i = 0, m;
+
+  assert (points && plateaus && (gbs || !n_points));
+
+  /* A 3-point median filter, so that single noisy timings do not split plateaus */
+  for (m = 0; m < n_points; ++m)
+    smooth[m] = (m == 0 || m == n_points - 1) ? points[m].gbs
+      : median3 (points[m-1].gbs, points[m].gbs, points[m+1].gbs);
+
+  while (i < n_points && n_plateaus < max_plateaus) {
+    /* Grow a run while every point stays near the run's (geometric) mean */
+    long double log_sum = logl (smooth[i]);
+    int j = i + 1;
+    while (j < n_points && isNear (smooth[j], expl (log_sum / (j - i)))) {
+      log_sum += logl (smooth[j]);
+      ++j;
+    }
+    if (j - i < PLATEAU_MIN_POINTS) {
+      ++i; /* a transition between levels */
+      continue;
+    }
+
+    plateau_t* P = &plateaus[n_plateaus];
+    P->first = i;
+    P->last = j - 1;
+    for (m = i; m < j; ++m)
+      gbs[m - i] = points[m].gbs;
+    qsort (gbs, j - i, sizeof (long double), compareLongDouble);
+    P->gbs = gbs[(j - i) / 2];
+
+    /* Merge with the previous plateau if only a transient separates them */
+    if (n_plateaus && isNear (P->gbs, plateaus[n_plateaus-1].gbs)) {
+      plateau_t* Q = &plateaus[n_plateaus-1];
+      Q->last = P->last;
+      for (m = Q->first; m <= Q->last; ++m)
+        gbs[m - Q->first] = points[m].gbs;
+      qsort (gbs, Q->last - Q->first + 1, sizeof (long double), compareLongDouble);
+      Q->gbs = gbs[(Q->last - Q->first + 1) / 2];
+      P = Q;
+    } else {
+      ++n_plateaus;
+    }
+    P->level = getHoldingLevel (points[(P->first + P->last) / 2].bytes);
+    i = j;
+  }
+  free (gbs);
+  return n_plateaus;
+}
+
+void
+printPlateaus (FILE* fp, const sweep_point_t* points,
+               const plateau_t* plateaus, int n_plateaus)
+{
+  int k;
+  for (k = 0; k < n_plateaus; ++k) {
+    const plateau_t* P = &plateaus[k];
+    fprintf (fp, "# plateau: %lu-%lu KiB, %Lg GB/s",
+             (unsigned long)(points[P->first].bytes >> 10),
+             (unsigned long)(points[P->last].bytes >> 10), P->gbs);
+    if (P->level)
+      fprintf (fp, " (L%d, %lu KiB)\n", P->level,
+               (unsigned long)(getAggregateCacheBytes (P->level) >> 10));
+    else
+      fprintf (fp, " (memory)\n");
+  }
+}
+
+/* eof */
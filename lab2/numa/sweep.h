@@ -0,0 +1,79 @@
+/**
+ *  \file sweep.h
+ *  \brief Working-set sweep: bandwidth of one kernel as a function of
+ *  the working-set size, with cache-level plateau detection.
+ */
+
+#if !defined (INC_SWEEP_H)
+#define INC_SWEEP_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "stream.h"
+#include "timer.h"
+
+/** Smallest working set (bytes, over all arrays) in a sweep */
+#define SWEEP_MIN_BYTES ((size_t)4 << 10)
+
+/** Sizes per doubling of the working set */
+#define SWEEP_STEPS_PER_OCTAVE 4
+
+/** One measured size */
+typedef struct
+{
+  size_t bytes; /*!< Working set, over all arrays the kernel touches */
+  size_t n;     /*!< Elements per array */
+  size_t reps;  /*!< Back-to-back calls per timing */
+  int flushed;  /*!< Whether the cache was flushed before each timing */
+  long double gbs; /*!< Best bandwidth over the trials, in GB/s */
+} sweep_point_t;
+
+/** A run of sizes with (nearly) constant bandwidth */
+typedef struct
+{
+  int first, last;  /*!< Indices of the first and last points */
+  long double gbs;  /*!< Median bandwidth over the run */
+  int level;        /*!< Cache level that holds the run, or 0 for memory */
+} plateau_t;
+
+/**
+ *  Returns the capacity, in bytes, of the instances of the data (or
+ *  unified) cache at the given level that the OpenMP threads can use,
+ *  assuming they spread over as many instances as they can; 0 if
+ *  there is no such level.
+ */
+size_t getAggregateCacheBytes (int level);
+
+/**
+ *  Runs 'kernel' on prefixes of D, A, and C (each holding at least
+ *  n_max elements), stepping the working set geometrically from
+ *  SWEEP_MIN_BYTES up to that of n_max elements. Writes up to
+ *  max_points results to 'points' and returns their number.
+ *
+ *  Sizes that fit in the last-level cache are run warm, repeating the
+ *  kernel enough times per timing to be well above the timer
+ *  resolution. Sizes just above it are flushed (see flushArrays() in
+ *  'flush.h') before each trial, so that no leftover lines are hit;
+ *  larger ones evict the cache by themselves and are run as is.
+ */
+int sweepWorkingSets (const stream_kernel_t* kernel, elemtype_t type,
+                      size_t n_max, size_t n_trials,
+                      void* D, const void* A, const void* C, double b,
+                      struct stopwatch_t* timer,
+                      sweep_point_t* points, int max_points);
+
+/**
+ *  Finds the plateaus of a sweep, in increasing order of size. Writes
+ *  up to max_plateaus of them and returns their number.
+ */
+int findPlateaus (const sweep_point_t* points, int n_points,
+                  plateau_t* plateaus, int max_plateaus);
+
+/** Prints plateaus as '#'-comment lines. */
+void printPlateaus (FILE* fp, const sweep_point_t* points,
+                    const plateau_t* plateaus, int n_plateaus);
+
+#endif
+
+/* eof */
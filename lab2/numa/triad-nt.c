@@ -0,0 +1,159 @@
+/**
+ *  \file triad-nt.c
+ *  \brief Implements the vectorized triad variants; see 'triad-nt.h'.
+ *
+ *  Every variant is compiled once per instruction set, through the
+ *  'target' function attribute, and the widest one the CPU supports
+ *  is picked at run time. With ordinary stores, each cache line of D
+ *  is first read (read-for-ownership) and then written back, so triad
+ *  moves 4 streams of data for 3 streams of useful work; streaming
+ *  stores write D without reading it.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include <x86intrin.h>
+
+#include "cpu.h"
+#include "triad-nt.h"
+
+const char *
+getTriadSimdName (void)
+{
+  static const char* names[SIMD_LEVELS] = { "sse2", "avx", "avx", "avx", "avx512f" };
+  return names[getSimd ()];
+}
+
+static size_t prefetch_bytes__ = 1024;
+
+void
+setTriadPrefetchDistance (size_t bytes)
+{
+  prefetch_bytes__ = bytes;
+}
+
+size_t
+getTriadPrefetchDistance (void)
+{
+  return prefetch_bytes__;
+}
+
+/* ======================================================================
+ * Per-thread kernels, for one element type and one instruction set.
+ * 'pf' is the prefetch distance in elements, or 0 for none.
+ */
+
+#define DEFINE_TRIAD_SIMD(T, ISA, TARGET, VT, W, LOADU, STORE, STREAM, SET1, ADD, MUL) \
+  __attribute__ ((target (TARGET)))					\
+  static void								\
+  triad__##T##__##ISA (size_t n, T* D, const T* A, const T* C, T b,	\
+		       int nt, size_t pf)				\
+  {									\
+    const VT vb = SET1 (b);						\
+    size_t i = 0;							\
+    /* Peel until D is cache-line aligned */				\
+    for (; i < n && ((size_t)(D + i) % CACHE_LINE); ++i)		\
+      D[i] = A[i] + b*C[i];						\
+    if (nt && pf) {							\
+      for (; i + W <= n; i += W) {					\
+	_mm_prefetch ((const char *)(A + i + pf), _MM_HINT_T0);		\
+	_mm_prefetch ((const char *)(C + i + pf), _MM_HINT_T0);		\
+	STREAM (D + i, ADD (LOADU (A + i), MUL (vb, LOADU (C + i))));	\
+      }									\
+    } else if (nt) {							\
+      for (; i + W <= n; i += W)					\
+	STREAM (D + i, ADD (LOADU (A + i), MUL (vb, LOADU (C + i))));	\
+    } else if (pf) {							\
+      for (; i + W <= n; i += W) {					\
+	_mm_prefetch ((const char *)(A + i + pf), _MM_HINT_T0);		\
+	_mm_prefetch ((const char *)(C + i + pf), _MM_HINT_T0);		\
+	STORE (D + i, ADD (LOADU (A + i), MUL (vb, LOADU (C + i))));	\
+      }									\
+    } else {								\
+      for (; i + W <= n; i += W)					\
+	STORE (D + i, ADD (LOADU (A + i), MUL (vb, LOADU (C + i))));	\
+    }									\
+    for (; i < n; ++i)							\
+      D[i] = A[i] + b*C[i];						\
+  }
+
+DEFINE_TRIAD_SIMD (float, sse2, "sse2", __m128, 4,
+		   _mm_loadu_ps, _mm_store_ps, _mm_stream_ps,
+		   _mm_set1_ps, _mm_add_ps, _mm_mul_ps)
+DEFINE_TRIAD_SIMD (float, avx, "avx", __m256, 8,
+		   _mm256_loadu_ps, _mm256_store_ps, _mm256_stream_ps,
+		   _mm256_set1_ps, _mm256_add_ps, _mm256_mul_ps)
+DEFINE_TRIAD_SIMD (float, avx512f, "avx512f", __m512, 16,
+		   _mm512_loadu_ps, _mm512_store_ps, _mm512_stream_ps,
+		   _mm512_set1_ps, _mm512_add_ps, _mm512_mul_ps)
+
+DEFINE_TRIAD_SIMD (double, sse2, "sse2", __m128d, 2,
+		   _mm_loadu_pd, _mm_store_pd, _mm_stream_pd,
+		   _mm_set1_pd, _mm_add_pd, _mm_mul_pd)
+DEFINE_TRIAD_SIMD (double, avx, "avx", __m256d, 4,
+		   _mm256_loadu_pd, _mm256_store_pd, _mm256_stream_pd,
+		   _mm256_set1_pd, _mm256_add_pd, _mm256_mul_pd)
+DEFINE_TRIAD_SIMD (double, avx512f, "avx512f", __m512d, 8,
+		   _mm512_loadu_pd, _mm512_store_pd, _mm512_stream_pd,
+		   _mm512_set1_pd, _mm512_add_pd, _mm512_mul_pd)
+
+/* ======================================================================
+ * Parallel drivers: each thread takes its chunk (see 'getThreadChunk')
+ * and fences its streaming stores before the implicit barrier.
+ */
+
+#define DEFINE_TRIAD_VARIANTS(T)					\
+  static void								\
+  triad__##T##__par (size_t n, T* D, const T* A, const T* C, T b,	\
+		     int nt, int use_pf)				\
+  {									\
+    const simd_t isa = getSimd ();					\
+    const size_t pf = use_pf ? prefetch_bytes__ / sizeof (T) : 0;	\
+    const size_t align = CACHE_LINE / sizeof (T);			\
+    _Pragma ("omp parallel default(none) shared(n,D,A,C,b,nt,isa,pf,align)") \
+    {									\
+      size_t tid = 0, n_threads = 1;					\
+      SET_THREAD_INFO (tid, n_threads);					\
+      size_t lo, hi;							\
+      getThreadChunk (n, align, tid, n_threads, &lo, &hi);		\
+      switch (isa) {							\
+      case SIMD_AVX512F:						\
+	triad__##T##__avx512f (hi - lo, D + lo, A + lo, C + lo, b, nt, pf); \
+	break;								\
+      case SIMD_FMA:							\
+      case SIMD_F16C:							\
+      case SIMD_AVX:							\
+	triad__##T##__avx (hi - lo, D + lo, A + lo, C + lo, b, nt, pf);	\
+	break;								\
+      default:								\
+	triad__##T##__sse2 (hi - lo, D + lo, A + lo, C + lo, b, nt, pf); \
+	break;								\
+      }									\
+      if (nt)								\
+	_mm_sfence ();							\
+    }									\
+  }									\
+									\
+  double triad_nt__##T (size_t n, void* D, const void* A, const void* C, double s) \
+  {									\
+    triad__##T##__par (n, (T *)D, (const T *)A, (const T *)C, (T)s, 1, 0); \
+    return 0;								\
+  }									\
+									\
+  double triad_pf__##T (size_t n, void* D, const void* A, const void* C, double s) \
+  {									\
+    triad__##T##__par (n, (T *)D, (const T *)A, (const T *)C, (T)s, 0, 1); \
+    return 0;								\
+  }									\
+									\
+  double triad_ntpf__##T (size_t n, void* D, const void* A, const void* C, double s) \
+  {									\
+    triad__##T##__par (n, (T *)D, (const T *)A, (const T *)C, (T)s, 1, 1); \
+    return 0;								\
+  }
+
+DEFINE_TRIAD_VARIANTS (float)
+DEFINE_TRIAD_VARIANTS (double)
+
+/* eof */
@@ -0,0 +1,41 @@
+/**
+ *  \file triad-nt.h
+ *  \brief Explicitly vectorized triad variants with non-temporal
+ *  (streaming) stores and software prefetching.
+ */
+
+#if !defined (INC_TRIAD_NT_H)
+#define INC_TRIAD_NT_H
+
+#include <stddef.h>
+
+/**
+ *  Returns the name of the widest vector instruction set available at
+ *  run time ("avx512f", "avx", or "sse2"); the variants below use it.
+ */
+const char* getTriadSimdName (void);
+
+/** Sets the software-prefetch distance, in bytes ahead of the current element. */
+void setTriadPrefetchDistance (size_t bytes);
+
+/** Returns the current software-prefetch distance, in bytes. */
+size_t getTriadPrefetchDistance (void);
+
+/*
+ *  Each variant computes D[i] = A[i] + s*C[i] with the same signature
+ *  as the kernels in 'stream.h':
+ *
+ *    triad_nt__T     streaming stores to D
+ *    triad_pf__T     ordinary stores, prefetching A and C
+ *    triad_ntpf__T   streaming stores and prefetching
+ */
+double triad_nt__float (size_t n, void* D, const void* A, const void* C, double s);
+double triad_pf__float (size_t n, void* D, const void* A, const void* C, double s);
+double triad_ntpf__float (size_t n, void* D, const void* A, const void* C, double s);
+double triad_nt__double (size_t n, void* D, const void* A, const void* C, double s);
+double triad_pf__double (size_t n, void* D, const void* A, const void* C, double s);
+double triad_ntpf__double (size_t n, void* D, const void* A, const void* C, double s);
+
+#endif
+
+/* eof */
@@ -1,117 +1,827 @@
 /**
  *  \file triad.c
- *  \brief Demo of "triad", forall i: D[i] <- A[i] + b*C[i]
+ *  \brief Demo of "triad", forall i: D[i] <- A[i] + b*C[i], and the
+ *  rest of the STREAM-style kernel suite; see 'stream.h'.
  */
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
+#include <unistd.h>
 
 #include <x86intrin.h>
 
+#if defined (_OPENMP)
+#include <omp.h>
+#endif
+
+#include "affinity.h"
+#include "hugepages.h"
 #include "timer.h"
+#include "bench.h"
+#include "results.h"
 #include "flush.h"
+#include "stream.h"
+#include "triad-nt.h"
+#include "placement.h"
+#include "sweep.h"
+#include "roofline.h"
+#include "half.h"
+#if defined (USE_MPI)
+#include "cluster.h"
+#endif
 
-typedef float real_t;
+/**
+ *  Returns a new array of n elements, each of 'size' bytes, on pages
+ *  of the default kind (see 'hugepages.h'), and so aligned to a page
+ *  boundary so that its pages can be placed (see 'placement.h') and
+ *  the kernels may assume STREAM_ALIGN (see 'stream.h').
+ */
+void* createArray__aligned (size_t n, size_t size)
+{
+  void* A = allocPages (n * size, getDefaultPageKind ());
+  assert (A && (size_t)A % STREAM_ALIGN == 0);
+  return A;
+}
 
-void triad__aligned (size_t n, real_t* D, const real_t* A, const real_t b, const real_t* C)
+static size_t get_size_t (const char* s)
 {
-  __assume_aligned (D, 16);
-  __assume_aligned (A, 16);
-  __assume_aligned (C, 16);
-  size_t i;
-#pragma omp parallel for private(i) schedule(static)
-  for (i = 0; i < n; ++i) {
-    D[i] = A[i] + b*C[i];
+  size_t n = 0;
+  if (s) {
+    long n_raw = atol (s);
+    assert (n_raw >= 0);
+    n = (size_t)n_raw;
   }
+  return n;
 }
 
-real_t* createArray__aligned (size_t n)
+/** Best, average, and worst bandwidth over a set of trials, in GB/s */
+struct bandwidth_t
 {
-  real_t* A = NULL;
-  posix_memalign (&((void *)A), 16, n * sizeof (size_t));
-  assert (A);
-  return A;
+  long double best;
+  long double avg;
+  long double worst;
+  long double all; /*!< 'cluster' mode: all ranks' bytes over the slowest rank's time */
+  size_t trials;   /*!< Trials run */
+};
+
+/** How many trials each kernel runs; see 'bench.h' */
+static bench_config_t bench_config;
+
+/** The results file, if any; see 'results.h' */
+static results_t* results = NULL;
+
+/** Where the next benchmarkKernel() runs, for the results file: the placement or mode */
+static char result_placement[64] = "";
+
+static void
+setNumThreads (int n_threads)
+{
+#if defined (_OPENMP)
+  omp_set_num_threads (n_threads);
+#endif
 }
 
-real_t createRandomValue (void)
+static int
+getMaxThreads (void)
 {
-  return (real_t)drand48 ();
+#if defined (_OPENMP)
+  return omp_get_max_threads ();
+#else
+  return 1;
+#endif
 }
 
-void initRandom__aligned (size_t n, real_t* A)
+
+#if defined (USE_MPI)
+/** Whether every trial starts on all ranks at once ('cluster' mode) */
+static int sync_ranks = 0;
+#endif
+
+/** One kernel's trial; see benchmarkKernel() */
+struct kernel_trial_t
 {
-  __assume_aligned (A, 16);
-  size_t i;
-#pragma omp parallel for private(i) schedule(static)
-  for (i = 0; i < n; ++i)
-    A[i] = createRandomValue ();
+  const stream_kernel_t* kernel;
+  elemtype_t type;
+  size_t n;
+  void* D;
+  const void* A;
+  const void* C;
+  double b;
+  struct stopwatch_t* timer;
+  long double t_all; /*!< 'cluster' mode: the best of the slowest rank's times */
+  size_t k;          /*!< Trials (and warm-up runs) so far */
+};
+
+static void
+setupKernelTrial (void* arg)
+{
+  struct kernel_trial_t* X = (struct kernel_trial_t *)arg;
+  flushArrays (X->n * getTypeSize (X->type), X->D, X->A, X->C);
+#if defined (USE_MPI)
+  if (sync_ranks) syncCluster ();
+#endif
 }
 
-static size_t get_size_t (const char* s)
+static void
+runKernelTrial (void* arg)
 {
-  size_t n = 0;
-  if (s) {
-    long n_raw = atol (s);
-    assert (n_raw >= 0);
-    n = (size_t)n_raw;
+  struct kernel_trial_t* X = (struct kernel_trial_t *)arg;
+  X->kernel->fn[X->type] (X->n, X->D, X->A, X->C, X->b);
+}
+
+static void
+teardownKernelTrial (void* arg)
+{
+  struct kernel_trial_t* X = (struct kernel_trial_t *)arg;
+#if defined (USE_MPI)
+  if (sync_ranks && X->k >= bench_config.warmup) {
+    const long double t_slowest = getClusterMaxTime (stopwatch_elapsed (X->timer));
+    if (X->k == bench_config.warmup || t_slowest < X->t_all) X->t_all = t_slowest;
   }
-  return n;
+#endif
+  ++X->k;
 }
 
-int
-main (int argc, char* argv[])
+/**
+ *  Times at least 'n_trials' runs of one kernel on n elements (more,
+ *  up to bench_config.max_trials, until the median settles), starting
+ *  each from a flushed cache, and returns the best, average, and worst
+ *  bandwidth. In 'cluster' mode, the ranks run exactly 'n_trials'
+ *  trials, each starting on all of them together, after a barrier.
+ *  The timer's totals (and counts) cover just the trials.
+ */
+static struct bandwidth_t
+benchmarkKernel (const stream_kernel_t* kernel, elemtype_t type,
+		 size_t n, size_t n_trials,
+		 void* D, const void* A, const void* C, double b,
+		 struct stopwatch_t* timer)
+{
+  const long double bytes = getStreamBytes (kernel, type, n);
+  struct kernel_trial_t X = { kernel, type, n, D, A, C, b, timer, 0, 0 };
+  bench_task_t task = { setupKernelTrial, runKernelTrial, teardownKernelTrial, NULL, &X };
+  bench_config_t config = bench_config;
+  bench_result_t R;
+  struct bandwidth_t bw;
+
+  config.min_trials = n_trials;
+  if (config.max_trials < n_trials) config.max_trials = n_trials;
+#if defined (USE_MPI)
+  /* Every rank must stop after the same trial */
+  if (sync_ranks) {
+    config.max_trials = n_trials;
+    config.min_time = 0;
+  }
+#endif
+  benchRun (&config, &task, timer, &R);
+
+  bw.best = bytes * 1e-9 / R.min;
+  bw.avg = bytes * 1e-9 / R.mean;
+  bw.worst = bytes * 1e-9 / R.max;
+#if defined (USE_MPI)
+  bw.all = sync_ranks ? getClusterSize () * bytes * 1e-9 / X.t_all : bw.best;
+#else
+  bw.all = bw.best;
+#endif
+  bw.trials = R.n;
+
+  beginResult (results, kernel->name);
+  addResultString (results, "type", getTypeName (type));
+  addResultInt (results, "n", (long long)n);
+  addResultString (results, "placement", result_placement);
+  addResultInt (results, "threads", getMaxThreads ());
+  if (kernel->prefetch)
+    addResultInt (results, "prefetch", (long long)getTriadPrefetchDistance ());
+  if (kernel == &roofline_kernel)
+    addResultInt (results, "flops", (long long)getRooflineFlops ());
+  addResultTimes (results, &R);
+  endResult (results);
+
+  benchRelease (&R);
+  return bw;
+}
+
+/** The arrays of one element type, allocated and initialized under a placement policy */
+struct arrays_t
 {
+  elemtype_t type;
   size_t n;
-  real_t* A;
-  real_t b;
-  real_t* C;
-  real_t* D;
+  void* A;
+  void* C;
+  void* D;
+  double b;
+};
 
-  size_t n_trials;
+static void
+createArrays (struct arrays_t* X, elemtype_t type, size_t n, const placement_t* P)
+{
+  const size_t bytes = n * getTypeSize (type);
+  X->type = type;
+  X->n = n;
+  X->A = createArray__aligned (n, getTypeSize (type));
+  X->C = createArray__aligned (n, getTypeSize (type));
+  X->D = createArray__aligned (n, getTypeSize (type));
+  placeArray (P, X->A, bytes);
+  placeArray (P, X->C, bytes);
+  placeArray (P, X->D, bytes);
+
+  initRandom__aligned (type, n, X->A);
+  X->b = drand48 ();
+  initRandom__aligned (type, n, X->C);
+  initRandom__aligned (type, n, X->D);
+}
+
+static void
+releaseArrays (struct arrays_t* X)
+{
+  freePages (X->D);
+  freePages (X->C);
+  freePages (X->A);
+}
+
+#define MAX_PREFETCH_DISTANCES 16
+
+/** Software-prefetch distances (bytes) at which to run the '-pf' kernels */
+static size_t prefetch_distances[MAX_PREFETCH_DISTANCES] = { 256, 1024, 4096 };
+static int n_prefetch_distances = 3;
+
+/** Parses a comma-separated list of prefetch distances; returns 0 on success. */
+static int
+parsePrefetchDistances (const char* s)
+{
+  n_prefetch_distances = 0;
+  while (*s && n_prefetch_distances < MAX_PREFETCH_DISTANCES) {
+    char* end;
+    long d = strtol (s, &end, 10);
+    if (end == s || d < 0) return -1;
+    prefetch_distances[n_prefetch_distances++] = (size_t)d;
+    s = (*end == ',') ? end + 1 : end;
+  }
+  return n_prefetch_distances > 0 ? 0 : -1;
+}
+
+/** Thread layout for every run; see 'affinity.h' */
+static layout_t layout = LAYOUT_NONE;
+
+static void
+printPlacementHeader (void)
+{
+  printf ("#placement\tkernel\ttype\tn\ttrials\tbest\tavg\tworst (GB/s)");
+  stopwatch_print_counters_header (stdout, '\t');
+  printf ("\n");
+}
+
+/**
+ *  Runs the whole kernel suite under placement policy P; with counters
+ *  enabled, each row ends with the counts per trial (see 'timer.h').
+ */
+static void
+benchmarkPlacement (const placement_t* P, size_t n, size_t n_trials,
+		    struct stopwatch_t* timer)
+{
+  char name[32];
+  int type;
+  size_t j;
+
+  getPlacementName (P, name, sizeof (name));
+  snprintf (result_placement, sizeof (result_placement), "%s", name);
+  placeThreads (P, layout);
+  for (type = 0; type < NUM_TYPES; ++type) {
+    struct arrays_t X;
+    const size_t bytes = n * getTypeSize ((elemtype_t)type);
+
+    fprintf (stderr, "... initializing (%s, %s) ...\n", name, getTypeName ((elemtype_t)type));
+    createArrays (&X, (elemtype_t)type, n, P);
+    printPageDistribution (stdout, "A", X.A, bytes);
+    printPageDistribution (stdout, "C", X.C, bytes);
+    printPageDistribution (stdout, "D", X.D, bytes);
+    printPageReport (stdout, "A", X.A);
+    printPageReport (stdout, "C", X.C);
+    printPageReport (stdout, "D", X.D);
+
+    fprintf (stderr, "... timing (%s, %s) ...\n", name, getTypeName ((elemtype_t)type));
+    for (j = 0; j < stream_num_kernels; ++j) {
+      const stream_kernel_t* kernel = &stream_kernels[j];
+      const int n_runs = kernel->prefetch ? n_prefetch_distances : 1;
+      int m;
+      if (!kernel->fn[type]) continue;
+      for (m = 0; m < n_runs; ++m) {
+	char kernel_name[64];
+	struct bandwidth_t bw;
+	if (kernel->prefetch) {
+	  setTriadPrefetchDistance (prefetch_distances[m]);
+	  snprintf (kernel_name, sizeof (kernel_name), "%s@%lu",
+		    kernel->name, (unsigned long)prefetch_distances[m]);
+	} else {
+	  snprintf (kernel_name, sizeof (kernel_name), "%s", kernel->name);
+	}
+	bw = benchmarkKernel (kernel, (elemtype_t)type, n, n_trials,
+			      X.D, X.A, X.C, X.b, timer);
+	printf ("%s\t%s\t%s\t%lu\t%lu\t%Lg\t%Lg\t%Lg",
+		name, kernel_name, getTypeName ((elemtype_t)type),
+		(unsigned long)n, (unsigned long)bw.trials,
+		bw.best, bw.avg, bw.worst);
+	stopwatch_print_counters (stdout, timer, n, '\t');
+	printf ("\n");
+      }
+    }
+    releaseArrays (&X);
+  }
+}
+
+/** Returns the kernel with the given name, or NULL if there is none */
+static const stream_kernel_t *
+findKernel (const char* name)
+{
   size_t k;
+  for (k = 0; k < stream_num_kernels; ++k)
+    if (!strcmp (stream_kernels[k].name, name))
+      return &stream_kernels[k];
+  return NULL;
+}
+
+/**
+ *  Measures the best triad bandwidth with the threads on node i and
+ *  the pages on node j, for every pair of nodes (i, j), and prints
+ *  the resulting local/remote bandwidth matrix.
+ */
+static void
+benchmarkNodeMatrix (size_t n, size_t n_trials, struct stopwatch_t* timer)
+{
+  const int n_nodes = getNumNodes ();
+  const stream_kernel_t* triad = findKernel ("triad");
+  int type, i, j;
+
+  assert (triad);
+  for (type = 0; type < NUM_TYPES; ++type) {
+    printf ("#matrix\ttriad\t%s\t%lu\t%lu (best GB/s; rows: CPU node, columns: memory node)\n",
+	    getTypeName ((elemtype_t)type), (unsigned long)n, (unsigned long)n_trials);
+    for (i = 0; i < n_nodes; ++i) {
+      printf ("cpu%d", i);
+      for (j = 0; j < n_nodes; ++j) {
+	placement_t P;
+	struct arrays_t X;
+	struct bandwidth_t bw;
+
+	P.policy = PLACE_BIND;
+	P.cpu_node = i;
+	P.mem_node = j;
+	placeThreads (&P, layout);
+	snprintf (result_placement, sizeof (result_placement), "matrix:cpu%d:mem%d", i, j);
+	createArrays (&X, (elemtype_t)type, n, &P);
+	bw = benchmarkKernel (triad, (elemtype_t)type, n, n_trials,
+			      X.D, X.A, X.C, X.b, timer);
+	releaseArrays (&X);
+	printf ("\t%Lg", bw.best);
+	fflush (stdout);
+      }
+      printf ("\n");
+    }
+  }
+}
+
+#define MAX_SWEEP_POINTS 256
+#define MAX_PLATEAUS 16
+
+/**
+ *  Sweeps the working set of one kernel from a few KiB up to that of
+ *  n elements per array, and prints the bandwidth-vs-size curve and
+ *  its plateaus; see 'sweep.h'.
+ */
+static void
+benchmarkWorkingSets (const stream_kernel_t* kernel, size_t n, size_t n_trials,
+		      struct stopwatch_t* timer)
+{
+  sweep_point_t points[MAX_SWEEP_POINTS];
+  plateau_t plateaus[MAX_PLATEAUS];
+  placement_t P;
+  int type, i;
+
+  parsePlacement ("ft-par", &P);
+  placeThreads (&P, layout);
+  printf ("#sweep\tkernel\ttype\tbytes\tn\treps\tflushed\tGB/s\n");
+  for (type = 0; type < NUM_TYPES; ++type) {
+    struct arrays_t X;
+    int n_points, n_plateaus;
+
+    if (!kernel->fn[type]) continue;
+    createArrays (&X, (elemtype_t)type, n, &P);
+    fprintf (stderr, "... sweeping (%s, %s) ...\n", kernel->name, getTypeName ((elemtype_t)type));
+    n_points = sweepWorkingSets (kernel, (elemtype_t)type, n, n_trials,
+				 X.D, X.A, X.C, X.b, timer, points, MAX_SWEEP_POINTS);
+    for (i = 0; i < n_points; ++i) {
+      printf ("sweep\t%s\t%s\t%lu\t%lu\t%lu\t%d\t%Lg\n",
+	      kernel->name, getTypeName ((elemtype_t)type),
+	      (unsigned long)points[i].bytes, (unsigned long)points[i].n,
+	      (unsigned long)points[i].reps, points[i].flushed, points[i].gbs);
+      /* Not timed with the harness: just the bandwidth, no trial times */
+      beginResult (results, "sweep");
+      addResultString (results, "kernel", kernel->name);
+      addResultString (results, "type", getTypeName ((elemtype_t)type));
+      addResultInt (results, "bytes", (long long)points[i].bytes);
+      addResultInt (results, "reps", (long long)points[i].reps);
+      addResultInt (results, "flushed", points[i].flushed);
+      addResultReal (results, "gbs", points[i].gbs);
+      endResult (results);
+    }
+    n_plateaus = findPlateaus (points, n_points, plateaus, MAX_PLATEAUS);
+    printPlateaus (stdout, points, plateaus, n_plateaus);
+    printPageReport (stdout, "A", X.A);
+    releaseArrays (&X);
+  }
+}
+
+/** Fraction of the peak bandwidth at which a layout counts as saturated */
+#define SATURATION_FRACTION 0.9
+
+/**
+ *  For each thread layout, measures the triad bandwidth at every
+ *  thread count from 1 up to the number of CPUs the layout uses, with
+ *  the arrays first-touched by the pinned threads, and reports the
+ *  saturation point: the fewest threads reaching SATURATION_FRACTION
+ *  of the layout's peak.
+ */
+static void
+benchmarkThreadSweep (size_t n, size_t n_trials, struct stopwatch_t* timer)
+{
+  const stream_kernel_t* triad = findKernel ("triad");
+  const int max_threads = getMaxThreads ();
+  const int n_cpus = getTopology ()->n_cpus;
+  long double* best = (long double *)malloc (n_cpus * sizeof (long double));
+  placement_t P;
+  int type, l, t;
+
+  assert (triad && best);
+  parsePlacement ("ft-par", &P);
+  printf ("#layout\tthreads\tkernel\ttype\tn\ttrials\tbest\tavg\tworst (GB/s)\n");
+  for (type = 0; type < NUM_TYPES; ++type) {
+    for (l = LAYOUT_COMPACT; l < NUM_LAYOUTS; ++l) {
+      const int n_used = getLayoutCpus ((layout_t)l, -1, 0, NULL);
+      int t_peak = 1, t_sat = 1;
+
+      fprintf (stderr, "... timing (%s, %s, 1-%d threads) ...\n",
+	       getLayoutName ((layout_t)l), getTypeName ((elemtype_t)type), n_used);
+      for (t = 1; t <= n_used; ++t) {
+	struct arrays_t X;
+	struct bandwidth_t bw;
+
+	setNumThreads (t);
+	placeThreads (&P, (layout_t)l);
+	snprintf (result_placement, sizeof (result_placement), "ft-par:%s",
+		  getLayoutName ((layout_t)l));
+	createArrays (&X, (elemtype_t)type, n, &P);
+	bw = benchmarkKernel (triad, (elemtype_t)type, n, n_trials,
+			      X.D, X.A, X.C, X.b, timer);
+	releaseArrays (&X);
+	best[t-1] = bw.best;
+	if (bw.best > best[t_peak-1]) t_peak = t;
+	printf ("%s\t%d\t%s\t%s\t%lu\t%lu\t%Lg\t%Lg\t%Lg\n",
+		getLayoutName ((layout_t)l), t, triad->name,
+		getTypeName ((elemtype_t)type), (unsigned long)n,
+		(unsigned long)bw.trials, bw.best, bw.avg, bw.worst);
+	fflush (stdout);
+      }
+
+      while (best[t_sat-1] < SATURATION_FRACTION * best[t_peak-1])
+	++t_sat;
+      printf ("# saturation(%s, %s): %d thread(s) reach %.0f%% of the peak, %Lg GB/s at %d thread(s)\n",
+	      getLayoutName ((layout_t)l), getTypeName ((elemtype_t)type),
+	      t_sat, 100 * SATURATION_FRACTION, best[t_peak-1], t_peak);
+    }
+  }
+
+  setNumThreads (max_threads);
+  placeThreads (&P, layout);
+  free (best);
+}
+
+/**
+ *  Runs the roofline kernel at every intensity from 2^ROOFLINE_MIN_LOG2
+ *  to 2^ROOFLINE_MAX_LOG2 flops per byte, for thread counts 1, 2, 4,
+ *  ..., up to the maximum, and prints the GB/s and GFLOP/s of each,
+ *  and the compute and memory ceilings (the best of each over the
+ *  intensities) and their ridge point per thread count; see
+ *  'roofline.gpi' to plot them.
+ */
+static void
+benchmarkRoofline (size_t n, size_t n_trials, struct stopwatch_t* timer)
+{
+  const int max_threads = getMaxThreads ();
+  placement_t P;
+  int type, t, k;
+
+  parsePlacement ("ft-par", &P);
+  snprintf (result_placement, sizeof (result_placement), "ft-par");
+  printf ("#roofline\tthreads\ttype\tn\tflops/elem\tflops/byte\tGB/s\tGFLOP/s\n");
+  for (type = 0; type < NUM_TYPES; ++type) {
+    if (!roofline_kernel.fn[type]) continue;
+    for (t = 1; ; t = (2*t < max_threads) ? 2*t : max_threads) {
+      struct arrays_t X;
+      long double peak_gbs = 0, peak_gflops = 0;
+
+      fprintf (stderr, "... roofline (%s, %d threads) ...\n",
+	       getTypeName ((elemtype_t)type), t);
+      setNumThreads (t);
+      placeThreads (&P, layout);
+      createArrays (&X, (elemtype_t)type, n, &P);
+      for (k = ROOFLINE_MIN_LOG2; k <= ROOFLINE_MAX_LOG2; ++k) {
+	const size_t flops = getRooflineFlopsFor ((elemtype_t)type, k);
+	struct bandwidth_t bw;
+	long double gflops;
+	if (!flops) continue;
+	setRooflineFlops (flops);
+	bw = benchmarkKernel (&roofline_kernel, (elemtype_t)type, n, n_trials,
+			      X.D, X.A, X.C, X.b, timer);
+	gflops = bw.best * getRooflineIntensity ((elemtype_t)type, flops);
+	if (bw.best > peak_gbs) peak_gbs = bw.best;
+	if (gflops > peak_gflops) peak_gflops = gflops;
+	printf ("roofline\t%d\t%s\t%lu\t%lu\t%g\t%Lg\t%Lg\n",
+		t, getTypeName ((elemtype_t)type), (unsigned long)n,
+		(unsigned long)flops, getRooflineIntensity ((elemtype_t)type, flops),
+		bw.best, gflops);
+	fflush (stdout);
+      }
+      releaseArrays (&X);
+      printf ("# ceilings(%d threads, %s): %Lg GFLOP/s, %Lg GB/s; ridge at %Lg flops/byte\n",
+	      t, getTypeName ((elemtype_t)type), peak_gflops, peak_gbs,
+	      peak_gflops / peak_gbs);
+      if (t == max_threads) break;
+    }
+  }
+
+  setNumThreads (max_threads);
+  placeThreads (&P, layout);
+}
+
+#if defined (USE_MPI)
+/**
+ *  Runs the whole kernel suite on every rank at once, with the arrays
+ *  first-touched by each rank's threads, and prints the per-rank,
+ *  per-node, and overall bandwidth of each kernel; see 'cluster.h'.
+ *  Returns the number of (node, kernel) pairs below 'threshold' times
+ *  the median node, on rank 0.
+ */
+static int
+benchmarkCluster (size_t n, size_t n_trials, double threshold,
+		  struct stopwatch_t* timer)
+{
+  const int root = (getClusterRank () == 0);
+  placement_t P;
+  int type, n_slow = 0;
+  size_t j;
+
+  parsePlacement ("ft-par", &P);
+  placeThreads (&P, layout);
+  snprintf (result_placement, sizeof (result_placement), "cluster");
+  sync_ranks = 1;
+  if (root)
+    printf ("#cluster\tlevel\tkernel\ttype\tn\ttrials\tname\tranks\tbest GB/s\n");
+  for (type = 0; type < NUM_TYPES; ++type) {
+    struct arrays_t X;
+
+    createArrays (&X, (elemtype_t)type, n, &P);
+    if (root) {
+      fprintf (stderr, "... timing (%d rank(s) on %d node(s), %s) ...\n",
+	       getClusterSize (), getClusterNodes (), getTypeName ((elemtype_t)type));
+      printPageReport (stdout, "A", X.A);
+    }
+    for (j = 0; j < stream_num_kernels; ++j) {
+      const stream_kernel_t* kernel = &stream_kernels[j];
+      const int n_runs = kernel->prefetch ? n_prefetch_distances : 1;
+      int m;
+      if (!kernel->fn[type]) continue;
+      for (m = 0; m < n_runs; ++m) {
+	char kernel_name[64];
+	struct bandwidth_t bw;
+	if (kernel->prefetch) {
+	  setTriadPrefetchDistance (prefetch_distances[m]);
+	  snprintf (kernel_name, sizeof (kernel_name), "%s@%lu",
+		    kernel->name, (unsigned long)prefetch_distances[m]);
+	} else {
+	  snprintf (kernel_name, sizeof (kernel_name), "%s", kernel->name);
+	}
+	bw = benchmarkKernel (kernel, (elemtype_t)type, n, n_trials,
+			      X.D, X.A, X.C, X.b, timer);
+	n_slow += reportCluster (stdout, kernel_name, getTypeName ((elemtype_t)type),
+				 n, n_trials, bw.best, bw.all, threshold);
+      }
+    }
+    releaseArrays (&X);
+  }
+  sync_ranks = 0;
+
+  if (root)
+    printf ("# cluster: %d (node, kernel) pair(s) below %.0f%% of the median\n",
+	    n_slow, 100 * threshold);
+  return n_slow;
+}
+#endif
+
+#if defined (USE_MPI)
+#  define IS_ROOT (getClusterRank () == 0)
+#  define DEFAULT_POLICY "cluster"
+#  define OPTIONS "a:cd:p:t:"
+#else
+#  define IS_ROOT 1
+#  define DEFAULT_POLICY "ft-par"
+#  define OPTIONS "a:cd:p:"
+#endif
+
+static int
+run (int argc, char* argv[])
+{
+  size_t n;
+  size_t n_trials;
+  const char* policy = DEFAULT_POLICY;
+  const char* layout_name = NULL;
+  const char* pages_name = NULL;
+  page_kind_t pages;
+  size_t j;
+  int opt, status = 0;
+#if defined (USE_MPI)
+  double threshold = CLUSTER_THRESHOLD;
+#endif
 
   struct stopwatch_t* timer;
 
-  if (argc < 3) {
-    fprintf (stderr, "usage: %s <n> <trials>\n", argv[0]);
-    return 1;
+  while ((opt = getopt (argc, argv, OPTIONS)) != -1) {
+    int ok = 0;
+    switch (opt) {
+    case 'a': ok = !parseLayout (optarg, &layout); layout_name = optarg; break;
+    case 'c': ok = 1; stopwatch_enable_counters (1); break;
+    case 'd': ok = !parsePrefetchDistances (optarg); break;
+    case 'p': ok = !parsePageKind (optarg, &pages); pages_name = optarg; break;
+#if defined (USE_MPI)
+    case 't': threshold = atof (optarg); ok = (threshold > 0 && threshold <= 1); break;
+#endif
+    }
+    if (!ok) {
+      argc = 0; /* print usage */
+      break;
+    }
   }
 
-  n = get_size_t (argv[1]);
-  n_trials = get_size_t (argv[2]);
+  if (argc - optind < 2) {
+    if (!IS_ROOT)
+      return 1;
+#if defined (USE_MPI)
+    fprintf (stderr, "usage: mpirun ... %s [-a <layout>] [-c] [-d <bytes>[,<bytes>...]] [-p <pages>] [-t <fraction>] <n> <trials> [<placement>]\n", argv[0]);
+#else
+    fprintf (stderr, "usage: %s [-a <layout>] [-c] [-d <bytes>[,<bytes>...]] [-p <pages>] <n> <trials> [<placement>]\n", argv[0]);
+#endif
+    fprintf (stderr, "where <trials> is the least number of trials per kernel (more run,\n"
+	     "up to $BENCH_MAX_TRIALS, until the median settles; see 'bench.h'),\n");
+    fprintf (stderr, "where -a pins the threads in one of the layouts none, compact, scatter,\n"
+	     "or cores (default: $AFFINITY, else none),\n");
+    fprintf (stderr, "where -c adds hardware counts per trial to the placement rows\n"
+	     "(also on with COUNTERS=1),\n");
+    fprintf (stderr, "where -d sets the software-prefetch distances for the '-pf' kernels\n"
+	     "(default: 256,1024,4096),\n");
+    fprintf (stderr, "where -p backs the arrays with default, 4k, thp, 2m, or 1g pages\n"
+	     "(default: $PAGES, else default), and\n");
+#if defined (USE_MPI)
+    fprintf (stderr, "where -t flags the nodes below this fraction of the median node\n"
+	     "bandwidth in 'cluster' mode (default: %g), which then exits with\n"
+	     "status 2 if any node is flagged, and\n", CLUSTER_THRESHOLD);
+    fprintf (stderr, "where <placement> is 'cluster' (the default): the whole suite on every\n"
+	     "rank at once, each trial starting after a barrier, with the best GB/s\n"
+	     "per rank, per node, and overall; or, with a single rank, one of\n");
+#else
+    fprintf (stderr, "where <placement> is one of\n");
+#endif
+    fprintf (stderr,
+	     "  ft-par      first touch by the parallel initialization%s\n"
+	     "  ft-serial   first touch by the master thread\n"
+	     "  interleave  pages interleaved over all nodes\n"
+	     "  bind:<k>    all pages on node k\n"
+	     "  remote[:k]  threads on node k (default 0), pages on node k+1\n"
+	     "  all         each of the above in turn, binding to every node\n"
+	     "  matrix      triad bandwidth for every (CPU node, memory node) pair\n"
+	     "  threads     triad bandwidth for every thread count, in each layout\n"
+	     "  sweep[:<kernel>]\n"
+	     "              bandwidth of a kernel (default: triad) for working sets\n"
+	     "              from 4 KiB up to <n> elements per array, with cache plateaus\n"
+	     "  roofline    GB/s and GFLOP/s at 1/16 to 64 flops/byte, for 1, 2, 4, ...\n"
+	     "              threads, with the compute and memory ceilings\n",
+	     strcmp (DEFAULT_POLICY, "ft-par") ? "" : " (default)");
+    return 1;
+  }
 
-  A = createArray__aligned (n);
-  C = createArray__aligned (n);
-  D = createArray__aligned (n);
+  n = get_size_t (argv[optind]);
+  n_trials = get_size_t (argv[optind+1]);
+  assert (n_trials > 0);
+  if (argc - optind > 2)
+    policy = argv[optind+2];
 
   stopwatch_init ();
   timer = stopwatch_create (); assert (timer);
+  benchDefaults (&bench_config);
 
-  for (k = 0; k < n_trials; ++k) {
-    long double t;
-
-    fprintf (stderr, "... initializing ...\n");
-    initRandom__aligned (n, A);
-    b = createRandomValue ();
-    initRandom__aligned (n, C);
-    initRandom__aligned (n, D);
-    flushBuffer ();
-
-    fprintf (stderr, "... timing ...\n");
-    stopwatch_start (timer);
-    triad__aligned (n, D, A, b, C);
-    t = stopwatch_stop (timer);
-
-    printf ("%lu %lu %Lg %Lg\n",
-	    (unsigned long)n,
-	    (unsigned long)k,
-	    t, (long double)n * 3e-9 * sizeof (real_t) / t);
+  layout = setupAffinity (layout_name);
+  if (pages_name)
+    setDefaultPageKind (pages);
+  else if (setupPageKind (NULL))
+    return 1;
+#if defined (USE_MPI)
+  if (strcmp (policy, "cluster") && getClusterSize () > 1) {
+    if (IS_ROOT)
+      fprintf (stderr, "*** Only 'cluster' runs on more than one rank. ***\n");
+    return 1;
   }
+#endif
+  if (IS_ROOT) {
+    printBenchConfig (stderr, &bench_config);
+    fprintf (stderr, "Last-level cache: %lu KiB; flush buffer: %lu KiB\n",
+	     (unsigned long)(getLastCacheBytes () >> 10),
+	     (unsigned long)(getFlushBytes () >> 10));
+    fprintf (stderr, "NUMA nodes: %d\n", getNumNodes ());
+    if (getNumNodes () == 1)
+      fprintf (stderr, "(Only one node: 'remote' and 'interleave' are the same as 'bind:0'.)\n");
+    fprintf (stderr, "Vector instruction set: %s (roofline: %s; half: %s)\n",
+	     getTriadSimdName (), getRooflineSimdName (), getHalfSimdName ());
+    fprintf (stderr, "Kernels:\n");
+    for (j = 0; j < stream_num_kernels; ++j)
+      fprintf (stderr, "  %-10s %s\n", stream_kernels[j].name, stream_kernels[j].desc);
 
+    results = openResults ("triad");
+    addResultInt (results, "n", (long long)n);
+    addResultInt (results, "min_trials", (long long)n_trials);
+    addResultString (results, "policy", policy);
+    addResultString (results, "layout", getLayoutName (layout));
+    addResultString (results, "pages", getPageKindName (getDefaultPageKind ()));
+    addResultInt (results, "threads", getMaxThreads ());
+#if defined (USE_MPI)
+    addResultInt (results, "ranks", getClusterSize ());
+    addResultInt (results, "nodes", getClusterNodes ());
+#endif
+  }
+
+#if defined (USE_MPI)
+  if (!strcmp (policy, "cluster")) {
+    if (benchmarkCluster (n, n_trials, threshold, timer) > 0)
+      status = 2;
+  } else
+#endif
+  if (!strcmp (policy, "matrix")) {
+    benchmarkNodeMatrix (n, n_trials, timer);
+  } else if (!strcmp (policy, "roofline")) {
+    benchmarkRoofline (n, n_trials, timer);
+  } else if (!strcmp (policy, "threads")) {
+    benchmarkThreadSweep (n, n_trials, timer);
+  } else if (!strcmp (policy, "sweep") || !strncmp (policy, "sweep:", 6)) {
+    const char* name = policy[5] ? policy + 6 : "triad";
+    const stream_kernel_t* kernel = findKernel (name);
+    if (!kernel) {
+      fprintf (stderr, "*** Invalid kernel, '%s'. ***\n", name);
+      closeResults (results);
+      return 1;
+    }
+    benchmarkWorkingSets (kernel, n, n_trials, timer);
+  } else if (!strcmp (policy, "all")) {
+    static const char* policies[] = { "ft-par", "ft-serial", "interleave", "remote" };
+    int k;
+    placement_t P;
+    printPlacementHeader ();
+    for (k = 0; k < (int)(sizeof (policies) / sizeof (policies[0])); ++k) {
+      parsePlacement (policies[k], &P);
+      benchmarkPlacement (&P, n, n_trials, timer);
+    }
+    P.policy = PLACE_BIND;
+    P.cpu_node = -1;
+    for (k = 0; k < getNumNodes (); ++k) {
+      P.mem_node = k;
+      benchmarkPlacement (&P, n, n_trials, timer);
+    }
+  } else {
+    placement_t P;
+    if (parsePlacement (policy, &P)) {
+      fprintf (stderr, "*** Invalid placement policy, '%s'. ***\n", policy);
+      closeResults (results);
+      return 1;
+    }
+    printPlacementHeader ();
+    benchmarkPlacement (&P, n, n_trials, timer);
+  }
+
+  closeResults (results);
   stopwatch_destroy (timer);
-  return 0;
+  return status;
+}
+
+int
+main (int argc, char* argv[])
+{
+#if defined (USE_MPI)
+  int status;
+  initCluster (&argc, &argv);
+  status = run (argc, argv);
+  finalizeCluster ();
+  return status;
+#else
+  return run (argc, argv);
+#endif
 }
 
 /* eof */
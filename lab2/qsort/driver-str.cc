@@ -0,0 +1,177 @@
+/**
+ *  \file driver-str.cc
+ *  \brief Lab 2: Multithreaded string sorting driver code
+ *
+ *  This program
+ *
+ *  - creates an input array of URL-like string keys to sort, where
+ *    the caller gives the array size as a command-line input;
+ *
+ *  - sorts it sequentially, noting the execution time;
+ *
+ *  - sorts it using the parallel string sort, also noting the
+ *    execution time;
+ *
+ *    (each sort runs on a fresh copy of the input, repeatedly, until
+ *    the median time is known to within a few percent; see 'bench.h')
+ *
+ *  - checks that the two sorts produce the same keys and LCPs;
+ *
+ *  - outputs the execution times and effective sorting rate (i.e.,
+ *    keys per second).
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "timer.c"
+#include "bench.c"
+#include "results.c"
+#include "affinity.h"
+
+#include "strsort.hh"
+
+#if defined (_OPENMP)
+  #include <omp.h>
+#endif
+
+/* ============================================================
+ */
+
+/** With counters enabled, prints the counts per sort as two CSV lines */
+static void
+printCounters (const char* name, const struct stopwatch_t* timer, int N)
+{
+  if (!stopwatch_counters_enabled ()) return;
+  printf ("  counters");
+  stopwatch_print_counters_header (stdout, ',');
+  printf ("\n  %s", name);
+  stopwatch_print_counters (stdout, timer, N, ',');
+  printf ("\n");
+}
+
+/** One sort to benchmark: sorts a fresh copy of A_in into A and LCP */
+struct StringSortTrial
+{
+  int N;
+  const strkey_t* A_in;
+  strkey_t* A;
+  size_t* LCP;
+  void (*sort) (int N, strkey_t* A, size_t* LCP);
+};
+
+static void
+copyStrKeys (void* arg)
+{
+  StringSortTrial* X = (StringSortTrial *)arg;
+  memcpy (X->A, X->A_in, X->N * sizeof (strkey_t));
+}
+
+static void
+runStringSort (void* arg)
+{
+  StringSortTrial* X = (StringSortTrial *)arg;
+  X->sort (X->N, X->A, X->LCP);
+}
+
+/** Sorts a copy of A_in into A and LCP, repeatedly, and prints (and records) the times and counts */
+static void
+benchmarkStringSort (const char* name, const bench_config_t* C,
+		     struct stopwatch_t* timer, results_t* J,
+		     int N, const strkey_t* A_in, strkey_t* A, size_t* LCP,
+		     void (*sort) (int N, strkey_t* A, size_t* LCP))
+{
+  StringSortTrial X = {N, A_in, A, LCP, sort};
+  bench_task_t task = {copyStrKeys, runStringSort, NULL, NULL, &X};
+  bench_result_t R;
+  benchRun (C, &task, timer, &R);
+  printf ("%s: %Lg seconds ==> %Lg million keys per second\n",
+	  name, R.median, 1e-6 * N / R.median);
+  printf ("  (median of %lu trials; min %Lg, MAD %Lg, %Lg%% CI %Lg to %Lg)\n",
+	  (unsigned long)R.n, R.min, R.mad, 100 * C->confidence, R.ci_lo, R.ci_hi);
+  printCounters (name, timer, N);
+  addResult (J, name, NULL, NULL, &R);
+  benchRelease (&R);
+}
+
+int
+main (int argc, char* argv[])
+{
+  int N = -1;
+
+  if (argc == 2 || argc == 3) {
+    N = atoi (argv[1]);
+    assert (N > 0);
+  } else {
+    fprintf (stderr, "usage: %s <n> [<layout>]\n", argv[0]);
+    fprintf (stderr, "where <n> is the number of strings to sort, and\n");
+    fprintf (stderr, "<layout> pins the threads: none, compact, scatter, or cores\n"
+             "(default: $AFFINITY, else none).\n");
+    fprintf (stderr, "With COUNTERS=1, prints hardware counts for each sort.\n");
+    return -1;
+  }
+
+  /* Before the first parallel region, so that the counts include the team */
+  stopwatch_init ();
+  struct stopwatch_t* timer = stopwatch_create (); assert (timer);
+  bench_config_t C;
+  benchDefaults (&C);
+  printBenchConfig (stderr, &C);
+
+  int num_threads = 1;
+#if defined (_OPENMP)
+  #pragma omp parallel
+  #pragma omp single
+  {
+    num_threads = omp_get_num_threads ();
+    fprintf (stderr, "=== OpenMP is enabled, with %d threads. ===\n", num_threads);
+  }
+#endif
+
+  layout_t layout = setupAffinity (argc == 3 ? argv[2] : NULL);
+
+  /* Create an input array of N random URL-like keys */
+  char* pool = NULL;
+  strkey_t* A_in = newUrlKeys (N, &pool);
+  size_t n_chars = 0;
+  for (int i = 0; i < N; ++i)
+    n_chars += A_in[i].len;
+
+  printf ("\nN == %d (%.1f characters per key)\n\n", N, (double)n_chars / N);
+
+  results_t* J = openResults ("strsort-omp");
+  addResultInt (J, "n", N);
+  addResultReal (J, "chars_per_key", (long double)n_chars / N);
+  addResultInt (J, "threads", num_threads);
+  addResultString (J, "layout", getLayoutName (layout));
+
+  /* Sort sequentially */
+  strkey_t* A_seq = newStrCopy (N, A_in);
+  size_t* LCP_seq = newLcps (N);
+  benchmarkStringSort ("Sequential", &C, timer, J, N, A_in, A_seq, LCP_seq,
+		       sequentialStringSort);
+  assertStringsAreSorted (N, A_seq, LCP_seq);
+
+  /* Sort in parallel */
+  strkey_t* A_par = newStrCopy (N, A_in);
+  size_t* LCP_par = newLcps (N);
+  benchmarkStringSort ("Parallel string sort", &C, timer, J, N, A_in, A_par, LCP_par,
+		       parallelStringSort);
+  assertStringsAreSorted (N, A_par, LCP_par);
+  assertStringsAreEqual (N, A_par, A_seq);
+
+  /* Cleanup */
+  printf ("\n");
+  free (LCP_par);
+  free (A_par);
+  free (LCP_seq);
+  free (A_seq);
+  free (A_in);
+  free (pool);
+  closeResults (J);
+  stopwatch_destroy (timer);
+  return 0;
+}
+
+/* eof */
@@ -12,6 +12,9 @@
  *  - sorts it using YOUR parallel implementation, also noting the
  *    execution time;
  *
+ *    (each sort runs on a fresh copy of the input, repeatedly, until
+ *    the median time is known to within a few percent; see 'bench.h')
+ *
  *  - checks that the two sorts produce the same result;
  *
  *  - outputs the execution times and effective sorting rate (i.e.,
@@ -21,7 +24,13 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include "timer.c"
+#include "bench.c"
+#include "results.c"
+#include "affinity.h"
+#include "hugepages.h"
 
 #include "sort.hh"
 
@@ -32,31 +41,117 @@
 /* ============================================================
  */
 
+/** With counters enabled, prints the counts per sort as two CSV lines */
+static void
+printCounters (const char* name, const struct stopwatch_t* timer, int N)
+{
+  if (!stopwatch_counters_enabled ()) return;
+  printf ("  counters");
+  stopwatch_print_counters_header (stdout, ',');
+  printf ("\n  %s", name);
+  stopwatch_print_counters (stdout, timer, N, ',');
+  printf ("\n");
+}
+
+/** One sort to benchmark: sorts a fresh copy of A_in into A */
+struct SortTrial
+{
+  int N;
+  const keytype* A_in;
+  keytype* A;
+  void (*sort) (int N, keytype* A);
+};
+
+static void
+copyKeys (void* arg)
+{
+  SortTrial* X = (SortTrial *)arg;
+  memcpy (X->A, X->A_in, X->N * sizeof (keytype));
+}
+
+static void
+runSort (void* arg)
+{
+  SortTrial* X = (SortTrial *)arg;
+  X->sort (X->N, X->A);
+}
+
+/** Sorts a copy of A_in into A, repeatedly, and prints (and records) the times and counts */
+static void
+benchmarkSort (const char* name, const bench_config_t* C,
+	       struct stopwatch_t* timer, results_t* J,
+	       int N, const keytype* A_in, keytype* A,
+	       void (*sort) (int N, keytype* A))
+{
+  SortTrial X = {N, A_in, A, sort};
+  bench_task_t task = {copyKeys, runSort, NULL, NULL, &X};
+  bench_result_t R;
+  benchRun (C, &task, timer, &R);
+  printf ("%s: %Lg seconds ==> %Lg million keys per second\n",
+	  name, R.median, 1e-6 * N / R.median);
+  printf ("  (median of %lu trials; min %Lg, MAD %Lg, %Lg%% CI %Lg to %Lg)\n",
+	  (unsigned long)R.n, R.min, R.mad, 100 * C->confidence, R.ci_lo, R.ci_hi);
+  printCounters (name, timer, N);
+  addResult (J, name, NULL, NULL, &R);
+  benchRelease (&R);
+}
+
 int
 main (int argc, char* argv[])
 {
   int N = -1;
+  const char* pages_name = NULL;
+  int opt;
 
-  if (argc == 2) {
-    N = atoi (argv[1]);
+  while ((opt = getopt (argc, argv, "cp:")) != -1) {
+    if (opt == 'p')
+      pages_name = optarg;
+    else if (opt == 'c')
+      stopwatch_enable_counters (1);
+    else
+      argc = 0; /* print usage */
+  }
+
+  if (argc - optind == 1 || argc - optind == 2) {
+    N = atoi (argv[optind]);
     assert (N > 0);
   } else {
-    fprintf (stderr, "usage: %s <n>\n", argv[0]);
-    fprintf (stderr, "where <n> is the length of the list to sort.\n");
+    fprintf (stderr, "usage: %s [-c] [-p <pages>] <n> [<layout>]\n", argv[0]);
+    fprintf (stderr, "where <n> is the length of the list to sort,\n");
+    fprintf (stderr, "<layout> pins the threads: none, compact, scatter, or cores\n"
+             "(default: $AFFINITY, else none), and\n");
+    fprintf (stderr, "-p backs the keys with default, 4k, thp, 2m, or 1g pages\n"
+             "(default: $PAGES, else default), and\n");
+    fprintf (stderr, "-c prints hardware counts for each sort (also on with COUNTERS=1).\n");
     return -1;
   }
 
+  /* Before the first parallel region, so that the counts include the team */
+  stopwatch_init ();
+  struct stopwatch_t* timer = stopwatch_create (); assert (timer);
+  bench_config_t C;
+  benchDefaults (&C);
+  printBenchConfig (stderr, &C);
+
+  int num_threads = 1;
 #if defined (_OPENMP)
   #pragma omp parallel
   #pragma omp single
   {
-    int num_threads = omp_get_num_threads ();
+    num_threads = omp_get_num_threads ();
     fprintf (stderr, "=== OpenMP is enabled, with %d threads. ===\n", num_threads);
   }
 #endif
 
-  stopwatch_init ();
-  struct stopwatch_t* timer = stopwatch_create (); assert (timer);
+  layout_t layout = setupAffinity (argc - optind == 2 ? argv[optind+1] : NULL);
+  if (setupPageKind (pages_name))
+    return -1;
+
+  results_t* J = openResults ("qsort-omp");
+  addResultInt (J, "n", N);
+  addResultInt (J, "threads", num_threads);
+  addResultString (J, "layout", getLayoutName (layout));
+  addResultString (J, "pages", getPageKindName (getDefaultPageKind ()));
 
   /* Create an input array of length N, initialized to random values */
   keytype* A_in = newKeys (N);
@@ -66,29 +161,23 @@ main (int argc, char* argv[])
   printf ("\nN == %d\n\n", N);
 
   /* Sort sequentially */
-  keytype* A_seq = newCopy (N, A_in);
-  stopwatch_start (timer);
-  sequentialSort (N, A_seq);
-  long double t_seq = stopwatch_stop (timer);
-  printf ("Sequential: %Lg seconds ==> %Lg million keys per second\n",
-	  t_seq, 1e-6 * N / t_seq);
+  keytype* A_seq = newKeys (N);
+  benchmarkSort ("Sequential", &C, timer, J, N, A_in, A_seq, sequentialSort);
   assertIsSorted (N, A_seq);
 
   /* Sort in parallel, calling YOUR routine. */
-  keytype* A_par = newCopy (N, A_in);
-  stopwatch_start (timer);
-  parallelSort (N, A_par);
-  long double t_qs = stopwatch_stop (timer);
-  printf ("Parallel sort: %Lg seconds ==> %Lg million keys per second\n",
-	  t_qs, 1e-6 * N / t_qs);
+  keytype* A_par = newKeys (N);
+  benchmarkSort ("Parallel sort", &C, timer, J, N, A_in, A_par, parallelSort);
   assertIsSorted (N, A_par);
   assertIsEqual (N, A_par, A_seq);
+  printPageReport (stdout, "keys", A_par);
 
   /* Cleanup */
   printf ("\n");
-  free (A_par);
-  free (A_seq);
-  free (A_in);
+  freeKeys (A_par);
+  freeKeys (A_seq);
+  freeKeys (A_in);
+  closeResults (J);
   stopwatch_destroy (timer);
   return 0;
 }
@@ -0,0 +1,377 @@
+/**
+ *  \file parallel-strsort--omp.cc
+ *
+ *  \brief OpenMP-based parallel string sort: MSD radix sort on large
+ *  subproblems, caching multikey quicksort on small ones.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "strsort.hh"
+#include <algorithm>
+
+/* The following preprocessor directive will abort the compilation if
+ * OpenMP is not available.
+ */
+#if !defined (_OPENMP)
+#  error "*** Must compile this file with OpenMP! ***"
+#endif
+
+#include <omp.h>
+
+/** Number of characters cached in 'strkey_t::cache' */
+#define CACHE_CHARS 7
+
+/** Subproblems at most this long are sorted by insertion sort */
+#define INSERTION_G 16
+
+/** Subproblems at most this long are sorted sequentially */
+#define SEQUENTIAL_G 1024
+
+/** Subproblems longer than this are sorted by a parallel radix pass */
+#define RADIX_G (1 << 16)
+
+/** Number of radix buckets: one for "key ends here", plus one per byte value */
+#define BUCKETS 257
+
+/* ============================================================
+ * Cached characters.
+ *
+ * The cache of a key at depth 'd' packs its characters d..d+6 into
+ * the top 7 bytes (zero-padded past the end of the key), and
+ * min(len-d, 8) into the lowest byte. Comparing two caches as
+ * integers therefore compares the keys' suffixes from 'd' on, up to
+ * the first 7 characters: if the caches are equal and the lowest byte
+ * is at most 7, the keys are equal; if it is 8, both keys continue
+ * past d+7 and the comparison must go deeper.
+ */
+
+static inline unsigned long
+loadCache (const strkey_t* k, size_t depth)
+{
+  const size_t rem = k->len > depth ? k->len - depth : 0;
+  const size_t m = rem < CACHE_CHARS ? rem : CACHE_CHARS;
+  const unsigned char* s = (const unsigned char *)k->str + depth;
+  unsigned long c = 0;
+  for (size_t i = 0; i < CACHE_CHARS; ++i)
+    c = (c << 8) | (i < m ? s[i] : 0);
+  return (c << 8) | (rem <= CACHE_CHARS ? rem : CACHE_CHARS + 1);
+}
+
+/** Remaining length encoded in a cache: 0..7, or 8 meaning "more than 7" */
+static inline unsigned
+cacheRem (unsigned long c)
+{
+  return (unsigned)(c & 0xff);
+}
+
+static void
+fillCaches (int N, strkey_t* A, size_t depth)
+{
+  for (int i = 0; i < N; ++i)
+    A[i].cache = loadCache (&A[i], depth);
+}
+
+/**
+ *  Returns the longest common prefix of a and b, given that they
+ *  agree on their first 'depth' characters.
+ */
+static inline size_t
+lcpFrom (const strkey_t* a, const strkey_t* b, size_t depth)
+{
+  const size_t n = std::min (a->len, b->len);
+  size_t i = depth;
+  while (i < n && a->str[i] == b->str[i])
+    ++i;
+  return i;
+}
+
+/**
+ *  Returns true if a < b, given that they agree on their first
+ *  'depth' characters and both caches are loaded at 'depth'.
+ */
+static inline bool
+lessFrom (const strkey_t* a, const strkey_t* b, size_t depth)
+{
+  if (a->cache != b->cache)
+    return a->cache < b->cache;
+  if (cacheRem (a->cache) <= CACHE_CHARS)
+    return false; /* equal */
+  depth += CACHE_CHARS;
+  const size_t n = std::min (a->len, b->len) - depth;
+  int c = memcmp (a->str + depth, b->str + depth, n);
+  return c < 0 || (c == 0 && a->len < b->len);
+}
+
+/* ============================================================
+ * Caching multikey quicksort.
+ *
+ * Every routine below sorts A[0:N-1], whose keys agree on their
+ * first 'depth' characters, and sets LCP[1:N-1]. LCP[0] belongs to
+ * the caller, who knows the key preceding A[0].
+ */
+
+static void
+insertionSort (int N, strkey_t* A, size_t depth, size_t* LCP)
+{
+  for (int i = 1; i < N; ++i) {
+    strkey_t key = A[i];
+    int j = i;
+    for (; j > 0 && lessFrom (&key, &A[j-1], depth); --j)
+      A[j] = A[j-1];
+    A[j] = key;
+  }
+  for (int i = 1; i < N; ++i)
+    LCP[i] = lcpFrom (&A[i-1], &A[i], depth);
+}
+
+static inline unsigned long
+median3 (unsigned long a, unsigned long b, unsigned long c)
+{
+  if (a < b)
+    return b < c ? b : (a < c ? c : a);
+  else
+    return a < c ? a : (b < c ? c : b);
+}
+
+/** Precondition: the caches of A[0:N-1] are loaded at 'depth'. */
+static void
+multikeyQuickSort (int N, strkey_t* A, size_t depth, size_t* LCP)
+{
+  if (N <= INSERTION_G) {
+    insertionSort (N, A, depth, LCP);
+    return;
+  }
+
+  /* Three-way partition on the cached characters */
+  const unsigned long pivot = median3 (A[0].cache, A[N/2].cache, A[N-1].cache);
+  int lt = 0, i = 0, gt = N;
+  while (i < gt) {
+    const unsigned long c = A[i].cache;
+    if (c < pivot)
+      std::swap (A[lt++], A[i++]);
+    else if (c > pivot)
+      std::swap (A[i], A[--gt]);
+    else
+      ++i;
+  }
+
+  /* Keys in A[lt:gt-1] are equal through depth+6 */
+  const int n_eq = gt - lt;
+  const bool more = cacheRem (pivot) > CACHE_CHARS;
+  if (N > SEQUENTIAL_G) {
+#pragma omp task default(none) firstprivate(A,lt,depth,LCP)
+    multikeyQuickSort (lt, A, depth, LCP);
+#pragma omp task default(none) firstprivate(A,gt,N,depth,LCP)
+    multikeyQuickSort (N-gt, A + gt, depth, LCP + gt);
+    if (more) {
+      fillCaches (n_eq, A + lt, depth + CACHE_CHARS);
+      multikeyQuickSort (n_eq, A + lt, depth + CACHE_CHARS, LCP + lt);
+    }
+#pragma omp taskwait
+  } else {
+    multikeyQuickSort (lt, A, depth, LCP);
+    multikeyQuickSort (N-gt, A + gt, depth, LCP + gt);
+    if (more) {
+      fillCaches (n_eq, A + lt, depth + CACHE_CHARS);
+      multikeyQuickSort (n_eq, A + lt, depth + CACHE_CHARS, LCP + lt);
+    }
+  }
+  if (!more)
+    for (int k = lt + 1; k < gt; ++k)
+      LCP[k] = depth + cacheRem (pivot);
+
+  /* Neighbors across a partition boundary differ within the cached
+   * characters, so these scans are short. */
+  if (lt > 0)
+    LCP[lt] = lcpFrom (&A[lt-1], &A[lt], depth);
+  if (gt < N)
+    LCP[gt] = lcpFrom (&A[gt-1], &A[gt], depth);
+}
+
+/* ============================================================
+ * MSD radix sort.
+ */
+
+/** Per-chunk state of a parallel radix pass */
+struct RadixChunk
+{
+  int begin, end;
+  unsigned long lo, hi; /* range of caches */
+  unsigned rem_min; /* smallest remaining length (clamped to 8) */
+  int count[BUCKETS];
+};
+
+/**
+ *  Returns the radix bucket of a key at position 'p' past 'depth':
+ *  bucket 0 if the key ends there, and 1 + the character otherwise.
+ */
+static inline int
+bucketOf (const strkey_t* k, size_t depth, unsigned p)
+{
+  const unsigned long c = k->cache;
+  if (cacheRem (c) == p)
+    return 0;
+  else if (p < CACHE_CHARS)
+    return 1 + (int)((c >> (8 * (CACHE_CHARS - p))) & 0xff);
+  else
+    return 1 + (unsigned char)k->str[depth + p];
+}
+
+static void stringSort (int N, strkey_t* A, strkey_t* T, size_t depth, size_t* LCP);
+
+/**
+ *  Sorts A[0:N-1] by a counting-sort pass on one character, using
+ *  T[0:N-1] as scratch space, and recurses on the buckets. The pass
+ *  is spread over tasks, one per chunk of A.
+ */
+static void
+radixSort (int N, strkey_t* A, strkey_t* T, size_t depth, size_t* LCP)
+{
+  const int n_chunks = std::max (1, std::min (N / RADIX_G * 4, 4 * omp_get_num_threads ()));
+  RadixChunk* chunks = (RadixChunk *)malloc (n_chunks * sizeof (RadixChunk));
+  assert (chunks);
+  for (int c = 0; c < n_chunks; ++c) {
+    chunks[c].begin = (int)((long)N * c / n_chunks);
+    chunks[c].end = (int)((long)N * (c+1) / n_chunks);
+  }
+
+  /* Load the caches and skip characters common to all keys. The keys
+   * all lie between the smallest and largest cache, so they share the
+   * leading bytes on which those two agree. */
+  unsigned long lo, hi;
+  unsigned rem_min;
+  for (;;) {
+    for (int c = 0; c < n_chunks; ++c) {
+#pragma omp task default(none) firstprivate(c,depth) shared(A,chunks)
+      {
+        RadixChunk* ch = &chunks[c];
+        ch->lo = ~0ul;
+        ch->hi = 0;
+        ch->rem_min = CACHE_CHARS + 1;
+        for (int i = ch->begin; i < ch->end; ++i) {
+          const unsigned long x = loadCache (&A[i], depth);
+          A[i].cache = x;
+          ch->lo = std::min (ch->lo, x);
+          ch->hi = std::max (ch->hi, x);
+          ch->rem_min = std::min (ch->rem_min, cacheRem (x));
+        }
+      }
+    }
+#pragma omp taskwait
+    lo = chunks[0].lo;
+    hi = chunks[0].hi;
+    rem_min = chunks[0].rem_min;
+    for (int c = 1; c < n_chunks; ++c) {
+      lo = std::min (lo, chunks[c].lo);
+      hi = std::max (hi, chunks[c].hi);
+      rem_min = std::min (rem_min, chunks[c].rem_min);
+    }
+    if (lo != hi || cacheRem (lo) <= CACHE_CHARS)
+      break;
+    depth += CACHE_CHARS;
+  }
+
+  if (lo == hi) { /* all keys are equal */
+    for (int i = 1; i < N; ++i)
+      LCP[i] = depth + cacheRem (lo);
+    free (chunks);
+    return;
+  }
+
+  /* Distribute on the first byte at which the keys differ, or on the
+   * first position at which some key ends, whichever comes first. */
+  const unsigned p = std::min ((unsigned)(__builtin_clzl (lo ^ hi) / 8), rem_min);
+
+  for (int c = 0; c < n_chunks; ++c) {
+#pragma omp task default(none) firstprivate(c,depth,p) shared(A,chunks)
+    {
+      RadixChunk* ch = &chunks[c];
+      memset (ch->count, 0, sizeof (ch->count));
+      for (int i = ch->begin; i < ch->end; ++i)
+        ++ch->count[bucketOf (&A[i], depth, p)];
+    }
+  }
+#pragma omp taskwait
+
+  /* Turn counts into scatter offsets, bucket-major, so that the pass
+   * is stable. */
+  int bucketStart[BUCKETS + 1];
+  int offset = 0;
+  for (int b = 0; b < BUCKETS; ++b) {
+    bucketStart[b] = offset;
+    for (int c = 0; c < n_chunks; ++c) {
+      const int n_b = chunks[c].count[b];
+      chunks[c].count[b] = offset;
+      offset += n_b;
+    }
+  }
+  bucketStart[BUCKETS] = offset;
+  assert (offset == N);
+
+  for (int c = 0; c < n_chunks; ++c) {
+#pragma omp task default(none) firstprivate(c,depth,p) shared(A,T,chunks)
+    {
+      RadixChunk* ch = &chunks[c];
+      for (int i = ch->begin; i < ch->end; ++i)
+        T[ch->count[bucketOf (&A[i], depth, p)]++] = A[i];
+    }
+  }
+#pragma omp taskwait
+  for (int c = 0; c < n_chunks; ++c) {
+#pragma omp task default(none) firstprivate(c) shared(A,T,chunks)
+    memcpy (A + chunks[c].begin, T + chunks[c].begin,
+            (chunks[c].end - chunks[c].begin) * sizeof (strkey_t));
+  }
+#pragma omp taskwait
+  free (chunks);
+
+  /* Neighbors in different buckets share exactly depth+p characters;
+   * keys in bucket 0 end at depth+p, so they are all equal. */
+  for (int b = 0; b < BUCKETS; ++b) {
+    const int begin = bucketStart[b];
+    const int end = bucketStart[b+1];
+    if (begin == end)
+      continue;
+    if (begin > 0)
+      LCP[begin] = depth + p;
+    if (b == 0) {
+      for (int i = begin + 1; i < end; ++i)
+        LCP[i] = depth + p;
+    } else if (end - begin > 1) {
+#pragma omp task default(none) firstprivate(begin,end,depth,p) shared(A,T,LCP)
+      stringSort (end - begin, A + begin, T + begin, depth + p + 1, LCP + begin);
+    }
+  }
+#pragma omp taskwait
+}
+
+/** Sorts A[0:N-1], using T[0:N-1] as scratch space. */
+static void
+stringSort (int N, strkey_t* A, strkey_t* T, size_t depth, size_t* LCP)
+{
+  if (N > RADIX_G) {
+    radixSort (N, A, T, depth, LCP);
+  } else {
+    fillCaches (N, A, depth);
+    multikeyQuickSort (N, A, depth, LCP);
+  }
+}
+
+void
+parallelStringSort (int N, strkey_t* A, size_t* LCP)
+{
+  if (N <= 0)
+    return;
+  LCP[0] = 0;
+
+  strkey_t* T = newStrKeys (N);
+#pragma omp parallel default(none) shared(N,A,T,LCP)
+#pragma omp single nowait
+  stringSort (N, A, T, 0, LCP);
+  free (T);
+}
+
+/* eof */
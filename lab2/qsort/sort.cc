@@ -11,6 +11,7 @@
 #include <string.h>
 #include <strings.h>
 
+#include "hugepages.h"
 #include "sort.hh"
 
 /* ============================================================
@@ -41,11 +42,17 @@ void sequentialSort (int N, keytype* A)
 keytype *
 newKeys (int N)
 {
-  keytype* A = (keytype *)malloc (N * sizeof (keytype));
+  keytype* A = (keytype *)allocPages (N * sizeof (keytype), getDefaultPageKind ());
   assert (A);
   return A;
 }
 
+void
+freeKeys (keytype* A)
+{
+  freePages (A);
+}
+
 /** Returns a new copy of A[0:N-1] */
 keytype *
 newCopy (int N, const keytype* A)
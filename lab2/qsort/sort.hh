@@ -23,9 +23,15 @@ void sequentialSort (int N, keytype* A);
  */
 void parallelSort (int N, keytype* A);
 
-/** Returns a new uninitialized array of length N */
+/**
+ *  Returns a new uninitialized array of length N, on pages of the
+ *  default kind; see 'hugepages.h'.
+ */
 keytype* newKeys (int N);
 
+/** Frees an array from newKeys() or newCopy() */
+void freeKeys (keytype* A);
+
 /** Returns a new copy of A[0:N-1] */
 keytype* newCopy (int N, const keytype* A);
 
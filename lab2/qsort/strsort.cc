@@ -0,0 +1,176 @@
+/**
+ *  \file strsort.cc
+ *
+ *  \brief Implements a generic sequential string sort, plus other
+ *  helper routines for managing string keys. See 'strsort.hh'.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "strsort.hh"
+
+/* ============================================================
+ * The following code implements a sequentialStringSort().
+ */
+
+/** Returns the length of the longest common prefix of a and b */
+static size_t lcp (const strkey_t* a, const strkey_t* b)
+{
+  const size_t n = a->len < b->len ? a->len : b->len;
+  size_t i = 0;
+  while (i < n && a->str[i] == b->str[i])
+    ++i;
+  return i;
+}
+
+static int compare (const void* a, const void* b)
+{
+  const strkey_t* ka = (const strkey_t *)a;
+  const strkey_t* kb = (const strkey_t *)b;
+  const size_t n = ka->len < kb->len ? ka->len : kb->len;
+  int c = memcmp (ka->str, kb->str, n);
+  if (c)
+    return c;
+  else if (ka->len < kb->len)
+    return -1;
+  else if (ka->len == kb->len)
+    return 0;
+  else
+    return 1;
+}
+
+void sequentialStringSort (int N, strkey_t* A, size_t* LCP)
+{
+  qsort (A, N, sizeof (strkey_t), compare);
+  if (N > 0)
+    LCP[0] = 0;
+  for (int i = 1; i < N; ++i)
+    LCP[i] = lcp (&A[i-1], &A[i]);
+}
+
+/* ============================================================
+ * Some helper routines for managing an array of string keys.
+ */
+
+strkey_t *
+newStrKeys (int N)
+{
+  strkey_t* A = (strkey_t *)malloc (N * sizeof (strkey_t));
+  assert (A);
+  return A;
+}
+
+strkey_t *
+newStrCopy (int N, const strkey_t* A)
+{
+  strkey_t* A_copy = newStrKeys (N);
+  memcpy (A_copy, A, N * sizeof (strkey_t));
+  return A_copy;
+}
+
+size_t *
+newLcps (int N)
+{
+  size_t* LCP = (size_t *)malloc (N * sizeof (size_t));
+  assert (LCP);
+  return LCP;
+}
+
+/* ============================================================
+ * A generator of URL-like keys. The keys share long prefixes
+ * ("http://www.") and come from a small vocabulary, so that there are
+ * many duplicates and long common prefixes, as in real identifiers.
+ */
+
+#define MAX_URL_LEN 128 /*!< Upper bound on a generated key's length */
+
+static const char* pick (const char* const* words, int n_words)
+{
+  return words[lrand48 () % n_words];
+}
+
+strkey_t *
+newUrlKeys (int N, char** pool)
+{
+  static const char* const schemes[] = { "http://", "https://" };
+  static const char* const subdomains[] = { "www.", "www.", "m.", "api.", "cdn." };
+  static const char* const tlds[] = { "com", "org", "net", "edu", "io" };
+  static const char* const dirs[] = {
+    "static", "img", "js", "css", "user", "users", "product", "products",
+    "search", "video", "news", "2014", "archive", "api", "v1", "v2"
+  };
+  static const char* const exts[] = { "", ".html", ".png", ".jpg", ".js", ".php" };
+  const int n_hosts = 1 + N / 64;
+
+  assert (pool);
+  char* buf = (char *)malloc ((size_t)N * MAX_URL_LEN);
+  assert (buf || !N);
+
+  strkey_t* A = newStrKeys (N);
+  char* p = buf;
+  for (int i = 0; i < N; ++i) {
+    int len = snprintf (p, MAX_URL_LEN, "%s%shost%ld.%s",
+                        pick (schemes, 2), pick (subdomains, 5),
+                        lrand48 () % n_hosts, pick (tlds, 5));
+    const int depth = lrand48 () % 4;
+    for (int d = 0; d < depth && len < MAX_URL_LEN; ++d)
+      len += snprintf (p + len, MAX_URL_LEN - len, "/%s", pick (dirs, 16));
+    if (len < MAX_URL_LEN)
+      len += snprintf (p + len, MAX_URL_LEN - len, "/%ld%s",
+                       lrand48 () % 100000, pick (exts, 6));
+    if (len >= MAX_URL_LEN)
+      len = MAX_URL_LEN - 1;
+    A[i].str = p;
+    A[i].len = len;
+    p += len;
+  }
+  *pool = buf;
+  return A;
+}
+
+/* ============================================================
+ * Code for checking the sorted results
+ */
+
+void assertStringsAreSorted (int N, const strkey_t* A, const size_t* LCP)
+{
+  if (N > 0 && LCP[0] != 0) {
+    fprintf (stderr, "*** ERROR ***\n");
+    fprintf (stderr, "  LCP[0] == %lu != 0\n", (unsigned long)LCP[0]);
+    assert (LCP[0] == 0);
+  }
+  for (int i = 1; i < N; ++i) {
+    if (compare (&A[i-1], &A[i]) > 0) {
+      fprintf (stderr, "*** ERROR ***\n");
+      fprintf (stderr, "  A[i=%d] == '%.*s' > A[%d] == '%.*s'\n",
+               i-1, (int)A[i-1].len, A[i-1].str, i, (int)A[i].len, A[i].str);
+      assert (compare (&A[i-1], &A[i]) <= 0);
+    }
+    if (LCP[i] != lcp (&A[i-1], &A[i])) {
+      fprintf (stderr, "*** ERROR ***\n");
+      fprintf (stderr, "  LCP[i=%d] == %lu, but the common prefix of '%.*s' and '%.*s' is %lu\n",
+               i, (unsigned long)LCP[i], (int)A[i-1].len, A[i-1].str,
+               (int)A[i].len, A[i].str, (unsigned long)lcp (&A[i-1], &A[i]));
+      assert (LCP[i] == lcp (&A[i-1], &A[i]));
+    }
+  } /* i */
+  fprintf (stderr, "\t(Array is sorted.)\n");
+}
+
+void assertStringsAreEqual (int N, const strkey_t* A, const strkey_t* B)
+{
+  for (int i = 0; i < N; ++i) {
+    if (compare (&A[i], &B[i]) != 0) {
+      fprintf (stderr, "*** ERROR ***\n");
+      fprintf (stderr, "  A[i=%d] == '%.*s', but B[%d] == '%.*s'\n",
+               i, (int)A[i].len, A[i].str, i, (int)B[i].len, B[i].str);
+      assert (compare (&A[i], &B[i]) == 0);
+    }
+  } /* i */
+  fprintf (stderr, "\t(Arrays are equal.)\n");
+}
+
+/* eof */
@@ -0,0 +1,73 @@
+/**
+ *  \file strsort.hh
+ *
+ *  \brief Interface to sorting arrays of variable-length string keys
+ *  ('strkey_t' values).
+ */
+
+#if !defined (INC_STRSORT_HH)
+#define INC_STRSORT_HH /*!< strsort.hh already included */
+
+#include <stddef.h>
+
+/**
+ *  'strkey_t' is a variable-length string key: 'len' bytes starting
+ *  at 'str'. The bytes need not be NUL-terminated and may contain
+ *  NUL characters. 'cache' is scratch space for the sorting routines,
+ *  which keep a few leading characters of the key there so that most
+ *  comparisons do not need to dereference 'str'; callers need not
+ *  initialize it.
+ */
+typedef struct
+{
+  const char* str;
+  size_t len;
+  unsigned long cache;
+} strkey_t;
+
+/**
+ *  Sorts an input array containing N string keys, A[0:N-1], in
+ *  lexicographic (memcmp) order. The sorted output overwrites the
+ *  input array. On return, LCP[0] == 0 and LCP[i] is the length of
+ *  the longest common prefix of A[i-1] and A[i], for 0 < i < N.
+ */
+void sequentialStringSort (int N, strkey_t* A, size_t* LCP);
+
+/**
+ *  Same as sequentialStringSort(), but in parallel; see
+ *  'parallel-strsort--omp.cc'.
+ */
+void parallelStringSort (int N, strkey_t* A, size_t* LCP);
+
+/** Returns a new uninitialized array of N string keys */
+strkey_t* newStrKeys (int N);
+
+/** Returns a new copy of A[0:N-1]; the characters are shared, not copied */
+strkey_t* newStrCopy (int N, const strkey_t* A);
+
+/** Returns a new uninitialized array of N LCP values */
+size_t* newLcps (int N);
+
+/**
+ *  Returns N random URL-like keys, e.g.,
+ *  "http://www.host123.com/static/img/4711.png". All characters are
+ *  stored in a single buffer, returned in '*pool', which the caller
+ *  must eventually free.
+ */
+strkey_t* newUrlKeys (int N, char** pool);
+
+/**
+ *  Checks whether A[0:N-1] is in fact sorted and LCP[0:N-1] holds the
+ *  correct longest common prefixes, and if not, aborts the program.
+ */
+void assertStringsAreSorted (int N, const strkey_t* A, const size_t* LCP);
+
+/**
+ *  Checks whether the strings A[0:N-1] and B[0:N-1] have equal
+ *  contents. If not, aborts the program.
+ */
+void assertStringsAreEqual (int N, const strkey_t* A, const strkey_t* B);
+
+#endif
+
+/* eof */
@@ -5,19 +5,28 @@
  */
 
 #include <cassert>
+#include <climits>
 #include <cstdlib>
 #include <strings.h> // for bzero
+#include <unistd.h>
 
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "timer.h"
-#include "quickselect.hh"
+#include "bench.h"
+#include "results.h"
+#include "hugepages.h"
 
 #include "list.hh"
 #include "listrank.hh"
 #include "listrank-par.hh"
+#include "listscan-par.hh"
+#include "forestrank-par.hh"
+#include "tree.hh"
+#include "eulertour.hh"
 
 using namespace std;
 
@@ -36,18 +45,24 @@ assertListRanksMatch (size_t n, const rank_t* R, const rank_t* R_true)
 }
 
 /**
- *  Performs a quick test of the parallel list ranking implementation
- *  against a trusted sequential implementation, for a problem of size
- *  N; aborts the program if the check fails.
+ *  Performs a quick test of the MLP sequential and the parallel list
+ *  ranking implementations against a trusted sequential
+ *  implementation, on the list 'Next' of N nodes; aborts the program
+ *  if either check fails.
  */
 static void
-checkParallelListRanker (size_t N)
+checkListRankers (size_t N, const index_t* Next)
 {
   // Use sequential implementation to compute the 'trusted' ranks
-  index_t* Next = createRandomList (N);
   rank_t* Rank_true = createRanksBuffer (N);
   computeListRanks (0, Next, Rank_true);
 
+  // Run the MLP sequential implementation
+  rank_t* Rank_mlp = createRanksBuffer (N);
+  computeListRanks__mlp (N, 0, Next, Rank_mlp);
+  assertListRanksMatch (N, Rank_mlp, Rank_true);
+  releaseRanksBuffer (Rank_mlp);
+
   // Run the parallel implementation
   ParRankedList_t* rankedList = setupRanks__par (N, Next);
   computeListRanks__par (rankedList);
@@ -56,142 +71,516 @@ checkParallelListRanker (size_t N)
   // Check the answer
   assertListRanksMatch (N, Rank_par, Rank_true);
 
+  // Rank it again in a batch, after a list half as long, to check
+  // that the ranker's buffers survive shrinking and regrowing
+  const size_t N_half = N / 2 + 1;
+  index_t* Next_half = createRandomList (N_half);
+  rank_t* Rank_half = createRanksBuffer (N_half);
+  computeListRanks (0, Next_half, Rank_half);
+  const size_t n_batch[] = {N_half, N};
+  const index_t* Next_batch[] = {Next_half, Next};
+  rank_t* Rank_batch[] = {createRanksBuffer (N_half), createRanksBuffer (N)};
+  computeListRanksBatch__par (rankedList, 2, n_batch, Next_batch, Rank_batch);
+  assertListRanksMatch (N_half, Rank_batch[0], Rank_half);
+  assertListRanksMatch (N, Rank_batch[1], Rank_true);
+  for (size_t j = 0; j < 2; ++j)
+    releaseRanksBuffer (Rank_batch[j]);
+  releaseRanksBuffer (Rank_half);
+  releaseListBuffer (Next_half);
+
   releaseRanks__par (rankedList);
   releaseRanksBuffer (Rank_true);
-  releaseListBuffer (Next);
 }
 
-/* ====================================================================== */
+#if !defined (NDEBUG)
+/** Length of the list for checkListScans(): long enough to cut into sublists */
+#define SCAN_CHECK_N 100003
+
+/** Whether two scan values are equal; Affine_t compares its coefficients */
+template <typename T>
+static bool
+isSameValue (const T& a, const T& b)
+{
+  return a == b;
+}
+
+static bool
+isSameValue (const Affine_t& f, const Affine_t& g)
+{
+  return f.a == g.a && f.b == g.b;
+}
 
 /**
- *  Given a list size 'n' and the execution time 't' in seconds,
- *  returns an estimate of the effective bandwidth (in bytes per
- *  second) of list ranking.
+ *  Checks listScan__par() against listScan() under 'op', on the
+ *  values V of the list 'Next' of N nodes, for each kind and
+ *  direction; aborts the program on a mismatch.
  */
-static long double
-estimateBandwidth (size_t n, long double t)
+template <typename T, class op_t>
+static void
+checkListScan (const char* name, size_t N, const index_t* Next,
+               const vector<T>& V, const op_t& op)
 {
-  return (long double)n * (2*sizeof (index_t) + sizeof (rank_t)) / t;
+  const scan_kind_t kinds[] = {INCLUSIVE_SCAN, EXCLUSIVE_SCAN};
+  const scan_direction_t directions[] = {FORWARD_SCAN, BACKWARD_SCAN};
+  vector<T> S_true (N), S_par (N);
+  for (size_t k = 0; k < 2; ++k)
+    for (size_t d = 0; d < 2; ++d) {
+      listScan (0, Next, &V[0], op, &S_true[0], kinds[k], directions[d]);
+      listScan__par (N, 0, Next, &V[0], op, &S_par[0], kinds[k], directions[d]);
+      for (size_t i = 0; i < N; ++i)
+        if (!isSameValue (S_par[i], S_true[i])) {
+          cerr << "*** ERROR: *** [" << i << " ] " << name << ' '
+               << ((kinds[k] == INCLUSIVE_SCAN) ? "inclusive" : "exclusive") << ' '
+               << ((directions[d] == FORWARD_SCAN) ? "forward" : "backward")
+               << " scan differs" << endl;
+          assert (false);
+        }
+    }
+  cerr << "    (OK!) " << name << endl;
 }
 
 /**
- *  Computes the min, max, mean, and median values of an array
- *  T[0:n-1] of 'n' long doubles.
+ *  Checks the parallel list scans against the sequential ones, for
+ *  '+', max, and affine maps; aborts the program if any differ.
  */
 static void
-getStats (long double* T, size_t n,
-          long double& t_min, long double& t_max,
-          long double& t_mean, long double& t_median)
-{
-  assert (n > 0);
-  t_min = T[0];
-  t_max = T[0];
-  t_mean = T[0];
-  t_median = T[0];
-  for (size_t i = 1; i < n; ++i) {
-    if (T[i] < t_min) t_min = T[i];
-    if (T[i] > t_max) t_max = T[i];
-    t_mean += T[i];
+checkListScans (void)
+{
+  const size_t N = SCAN_CHECK_N;
+  index_t* Next = createRandomList (N);
+  vector<long> V (N);
+  vector<Affine_t> F (N);
+  for (size_t i = 0; i < N; ++i) {
+    V[i] = lrand48 () % 2001 - 1000;
+    // Slopes of +-1 and integer offsets compose exactly, in any grouping
+    F[i].a = (lrand48 () & 1) ? 1 : -1;
+    F[i].b = lrand48 () % 21 - 10;
   }
-  t_mean /= n;
-  t_median = selectMedian (T, n);
+
+  checkListScan ("plus", N, Next, V, ScanPlus_t<long> ());
+  checkListScan ("max", N, Next, V, ScanMax_t<long> (LONG_MIN));
+  checkListScan ("affine", N, Next, F, ScanAffine_t ());
+
+  releaseListBuffer (Next);
 }
+#endif
+
+/* ====================================================================== */
 
 /**
- *  Benchmarks the sequential list ranking implementation on the given
- *  linked list. , and returns its running time, in seconds.
+ *  Given a list size 'n', the bytes a ranker keeps per node, and the
+ *  execution time 't' in seconds, returns an estimate of the
+ *  effective bandwidth (in bytes per second) of list ranking: the
+ *  input list and the ranker's nodes, once each.
  */
+static long double
+estimateBandwidth (size_t n, size_t node_bytes, long double t)
+{
+  return (long double)n * (sizeof (index_t) + node_bytes) / t;
+}
+
+/** Prints the min, median, max, and mean of a set of times, each preceded by a comma */
 static void
-benchmarkSequential (size_t N, size_t num_trials, struct stopwatch_t* timer)
+printTimes (const bench_result_t& R)
 {
-  if (!num_trials) return;
+  cout << ',' << R.min << ',' << R.median << ',' << R.max << ',' << R.mean;
+}
 
-  assert (timer);
+/** Prints the spread of the median: the MAD and the CI, each preceded by a comma */
+static void
+printSpread (const bench_result_t& R)
+{
+  cout << ',' << R.mad << ',' << R.ci_lo << ',' << R.ci_hi;
+}
 
-  cerr << endl << "... benchmarking the sequential algorithm ..." << endl;
+/* ====================================================================== */
 
-  long double* Times = new long double[num_trials]; assert (Times);
+/** One trial of a sequential ranker; every trial ranks the same list */
+struct SeqTrial
+{
+  size_t N;
+  const index_t* Next;
+  rank_t* Rank;
+};
 
-  for (size_t trial = 0; trial < num_trials; ++trial) {
-    index_t* Next = createRandomList (N);
-    rank_t* Rank = createRanksBuffer (N);
-    stopwatch_start (timer);
-    computeListRanks (0, Next, Rank);
-    Times[trial] = stopwatch_stop (timer);
-    releaseListBuffer (Next);
-    releaseRanksBuffer (Rank);
-  }
+static void
+runSeqTrial (void* arg)
+{
+  SeqTrial* X = (SeqTrial *)arg;
+  computeListRanks (0, X->Next, X->Rank);
+}
 
-  long double t_min, t_max, t_median, t_mean;
-  getStats (Times, num_trials, t_min, t_max, t_mean, t_median);
-  cout << "SEQ" << ',' << N << ',' << num_trials
-       << ',' << estimateBandwidth (N, t_median)*1e-9
-       << ',' << t_min << ',' << t_median << ',' << t_max << ',' << t_mean
-       << endl;
+static void
+runMlpTrial (void* arg)
+{
+  SeqTrial* X = (SeqTrial *)arg;
+  computeListRanks__mlp (X->N, 0, X->Next, X->Rank);
+}
+
+
+/**
+ *  Benchmarks a sequential list ranking implementation, whose trial
+ *  is 'run', on the list 'Next' of N nodes, and prints its
+ *  statistics as row 'name'.
+ */
+static void
+benchmarkSequential (const char* name, void (*run) (void*),
+                     size_t N, const index_t* Next, const bench_config_t& C,
+                     struct stopwatch_t* timer, results_t* J)
+{
+  assert (timer);
+
+  cerr << endl << "... benchmarking the sequential algorithm (" << name << ") ..." << endl;
 
-  delete[] Times;
+  SeqTrial X = {N, Next, createRanksBuffer (N)};
+  printPageReport (stderr, "Rank", X.Rank);
+  bench_task_t task = {NULL, run, NULL, NULL, &X};
+  bench_result_t R;
+  benchRun (&C, &task, timer, &R);
+
+  cout << name << ',' << N << ',' << R.n
+       << ',' << estimateBandwidth (N, sizeof (index_t) + sizeof (rank_t), R.median)*1e-9;
+  printTimes (R);
+  printSpread (R);
+  cout << flush;
+  stopwatch_print_counters (stdout, timer, N, ',');
+  cout << endl;
+  beginResult (J, name);
+  addResultInt (J, "n", N);
+  addResultTimes (J, &R);
+  endResult (J);
+
+  benchRelease (&R);
+  releaseRanksBuffer (X.Rank);
 }
 
 /* ====================================================================== */
 
 /**
- *  Benchmarks the sequential list ranking implementation on the given
- *  linked list, and returns its running time, in seconds.
+ *  One trial of the parallel ranker; every trial ranks the same list
+ *  with the same ranker, pointed at the list anew. That setup
+ *  (resetRanks__par) and the copy-out (getRanks__par) are timed apart
+ *  from the ranking itself.
  */
+struct ParTrial
+{
+  size_t N;
+  const index_t* Next;
+  ParRankedList_t* rankedList;
+  size_t node_bytes;
+  struct stopwatch_t* timer;
+  vector<long double> T_pre;
+  vector<long double> T_post;
+};
+
 static void
-benchmarkParallel (size_t N, size_t num_trials, struct stopwatch_t* timer)
+setupParTrial (void* arg)
 {
-  if (!num_trials) return;
+  ParTrial* X = (ParTrial *)arg;
+  stopwatch_start (X->timer);
+  resetRanks__par (X->rankedList, X->N, X->Next, NULL);
+  X->T_pre.push_back (stopwatch_stop (X->timer));
+}
 
+static void
+runParTrial (void* arg)
+{
+  ParTrial* X = (ParTrial *)arg;
+  computeListRanks__par (X->rankedList);
+}
+
+static void
+teardownParTrial (void* arg)
+{
+  ParTrial* X = (ParTrial *)arg;
+  stopwatch_start (X->timer);
+  const rank_t* Rank = getRanks__par (X->rankedList);
+  X->T_post.push_back (stopwatch_stop (X->timer));
+  assert (Rank); (void)Rank;
+}
+
+/**
+ *  Benchmarks the parallel list ranking implementation on the list
+ *  'Next' of N nodes, and prints the statistics of the ranking, its
+ *  setup, and its copy-out.
+ */
+static void
+benchmarkParallel (size_t N, const index_t* Next, const bench_config_t& C,
+                   struct stopwatch_t* timer, results_t* J)
+{
   assert (timer);
 
   cerr << endl << "... benchmarking the parallel algorithm ..." << endl;
 
-  long double* T_pre = new long double[num_trials]; assert (T_pre);
-  long double* T_rank = new long double[num_trials]; assert (T_rank);
-  long double* T_post = new long double[num_trials]; assert (T_post);
+  // Counts just the ranking phase
+  struct stopwatch_t* rank_timer = stopwatch_create (); assert (rank_timer);
 
-  for (size_t trial = 0; trial < num_trials; ++trial) {
-    index_t* Next = createRandomList (N);
+  ParTrial X;
+  X.N = N;
+  X.Next = Next;
+  X.rankedList = setupRanks__par (N, Next);
+  X.node_bytes = getNodeSize__par (X.rankedList);
+  X.timer = timer;
+  bench_task_t task = {setupParTrial, runParTrial, teardownParTrial, NULL, &X};
+  bench_result_t R, R_pre, R_post;
+  benchRun (&C, &task, rank_timer, &R);
 
-    stopwatch_start (timer);
-    ParRankedList_t* rankedList = setupRanks__par (N, Next);
-    T_pre[trial] = stopwatch_stop (timer);
+  // The setup and copy-out of the warm-up runs come first
+  assert (X.T_pre.size () == C.warmup + R.n && X.T_post.size () == C.warmup + R.n);
+  benchStats (&C, &X.T_pre[C.warmup], R.n, &R_pre);
+  benchStats (&C, &X.T_post[C.warmup], R.n, &R_post);
 
-    stopwatch_start (timer);
-    computeListRanks__par (rankedList);
-    T_rank[trial] = stopwatch_stop (timer);
+  const char* name = getImplName__par ();
+  cerr << "Node size: " << X.node_bytes << " bytes" << endl;
+  cout << name << ',' << N << ',' << R.n
+       << ',' << estimateBandwidth (N, X.node_bytes, R.median)*1e-9;
+  printTimes (R);
+  printSpread (R);
+  printTimes (R_pre);
+  printTimes (R_post);
+  cout << flush;
+  stopwatch_print_counters (stdout, rank_timer, N, ',');
+  cout << endl;
+  const char* phases[] = {"rank", "setup", "copy-out"};
+  const bench_result_t* R_phase[] = {&R, &R_pre, &R_post};
+  for (size_t k = 0; k < 3; ++k) {
+    beginResult (J, name);
+    addResultInt (J, "n", N);
+    addResultString (J, "phase", phases[k]);
+    addResultInt (J, "node_bytes", X.node_bytes);
+    addResultTimes (J, R_phase[k]);
+    endResult (J);
+  }
 
-    stopwatch_start (timer);
-    const rank_t* Rank = getRanks__par (rankedList);
-    T_post[trial] = stopwatch_stop (timer);
+  benchRelease (&R_post);
+  benchRelease (&R_pre);
+  benchRelease (&R);
+  releaseRanks__par (X.rankedList);
+  stopwatch_destroy (rank_timer);
+}
 
-    releaseRanks__par (rankedList);
-    releaseListBuffer (Next);
-  }
+/**
+ *  Creates a list of n nodes in runs of 'block' (see
+ *  createClusteredList), checks the rankers on it, and benchmarks
+ *  them all on it.
+ */
+static void
+benchmarkListRankers (size_t n, size_t block, const bench_config_t& C,
+                      struct stopwatch_t* timer, results_t* J)
+{
+  cerr << endl << "... creating the list ..." << endl;
+  stopwatch_start (timer);
+  index_t* Next = createClusteredList (n, block);
+  cerr << "Created in " << stopwatch_stop (timer) << " seconds" << endl;
+  printPageReport (stderr, "Next", Next);
 
-  long double t_min, t_max, t_median, t_mean;
-  getStats (T_rank, num_trials, t_min, t_max, t_mean, t_median);
-  const char* name = getImplName__par ();
-  cout << name << ',' << N << ',' << num_trials
-       << ',' << estimateBandwidth (N, t_median)*1e-9
-       << ',' << t_min << ',' << t_median << ',' << t_max << ',' << t_mean;
-  getStats (T_pre, num_trials, t_min, t_max, t_mean, t_median);
-  cout << ',' << t_min << ',' << t_median << ',' << t_max << ',' << t_mean;
-  getStats (T_post, num_trials, t_min, t_max, t_mean, t_median);
-  cout << ',' << t_min << ',' << t_median << ',' << t_max << ',' << t_mean;
+  checkListRankers (n, Next);
+  benchmarkSequential ("SEQ", runSeqTrial, n, Next, C, timer, J);
+  benchmarkSequential ("SEQ-MLP", runMlpTrial, n, Next, C, timer, J);
+  benchmarkParallel (n, Next, C, timer, J);
+
+  releaseListBuffer (Next);
+}
+
+/* ====================================================================== */
+
+/** Compares two list-id buffers and aborts the program if they are unequal. */
+static void
+assertListIdsMatch (size_t n, const index_t* Id, const index_t* Id_true)
+{
+  for (size_t i = 0; i < n; ++i)
+    if (Id[i] != Id_true[i]) {
+      cerr << "*** ERROR: *** [" << i << " ] List " << Id[i] << " != " << Id_true[i] << endl;
+      assert (false);
+    }
+}
+
+/** One trial of a forest ranker; every trial ranks the same forest */
+struct ForestTrial
+{
+  size_t N;
+  const index_t* Next;
+  index_t* ListId;
+  rank_t* Rank;
+  ParRankedForest_t* rankedForest;
+};
+
+static void
+runForestTrial (void* arg)
+{
+  ForestTrial* X = (ForestTrial *)arg;
+  computeForestRanks (X->N, X->Next, X->ListId, X->Rank);
+}
+
+static void
+runParForestTrial (void* arg)
+{
+  ForestTrial* X = (ForestTrial *)arg;
+  computeForestRanks__par (X->rankedForest);
+}
+
+/** Benchmarks one forest ranker, whose trial is 'run', and prints its statistics as row 'name'. */
+static void
+benchmarkForestRanker (const char* name, void (*run) (void*), ForestTrial* X,
+                       size_t k, list_lengths_t lengths, const bench_config_t& C,
+                       struct stopwatch_t* timer, results_t* J)
+{
+  const size_t N = X->N;
+  cerr << endl << "... benchmarking " << name << " ..." << endl;
+
+  bench_task_t task = {NULL, run, NULL, NULL, X};
+  bench_result_t R;
+  benchRun (&C, &task, timer, &R);
+
+  cout << name << ',' << N << ',' << R.n
+       << ',' << estimateBandwidth (N, sizeof (index_t) + sizeof (rank_t), R.median)*1e-9;
+  printTimes (R);
+  printSpread (R);
+  cout << flush;
+  stopwatch_print_counters (stdout, timer, N, ',');
   cout << endl;
+  beginResult (J, name);
+  addResultInt (J, "n", N);
+  addResultInt (J, "lists", k);
+  addResultString (J, "lengths", getListLengthsName (lengths));
+  addResultTimes (J, &R);
+  endResult (J);
+
+  benchRelease (&R);
+}
 
-  delete[] T_post;
-  delete[] T_rank;
-  delete[] T_pre;
+/**
+ *  Ranks a random forest of n nodes in k lists sequentially and in
+ *  parallel, checks that they agree, and benchmarks both.
+ */
+static void
+benchmarkForests (size_t n, size_t k, list_lengths_t lengths, const bench_config_t& C,
+                  struct stopwatch_t* timer, results_t* J)
+{
+  cerr << endl << "... creating " << k << " lists (" << getListLengthsName (lengths)
+       << " lengths) ..." << endl;
+  index_t* Next = createRandomForest (n, k, lengths);
+  index_t* ListId = createListBuffer (n);
+  rank_t* Rank = createRanksBuffer (n);
+  ParRankedForest_t* rankedForest = setupForestRanks__par (n, Next);
+
+  const size_t k_seq = computeForestRanks (n, Next, ListId, Rank);
+  const size_t k_par = computeForestRanks__par (rankedForest);
+  assert (k_seq == k && k_par == k); (void)k_seq; (void)k_par;
+  assertListIdsMatch (n, getListIds__par (rankedForest), ListId);
+  assertListRanksMatch (n, getForestRanks__par (rankedForest), Rank);
+
+  ForestTrial X = {n, Next, ListId, Rank, rankedForest};
+  benchmarkForestRanker ("FOREST-SEQ", runForestTrial, &X, k, lengths, C, timer, J);
+  benchmarkForestRanker ("FOREST-PAR", runParForestTrial, &X, k, lengths, C, timer, J);
+
+  releaseForestRanks__par (rankedForest);
+  releaseRanksBuffer (Rank);
+  releaseListBuffer (ListId);
+  releaseListBuffer (Next);
 }
 
+/* ====================================================================== */
+
+/** Compares two sets of tree numbers and aborts the program if they are unequal. */
 static void
-benchmarkListRankers (size_t n, size_t num_trials, struct stopwatch_t* timer)
+assertTreeNumbersMatch (const TreeNumbers_t* X, const TreeNumbers_t* X_true)
 {
-  benchmarkSequential (n, num_trials, timer);
-  benchmarkParallel (n, num_trials, timer);
+  const index_t* A[] = {X->Pre, X->Post, X->Depth, X->Size};
+  const index_t* A_true[] = {X_true->Pre, X_true->Post, X_true->Depth, X_true->Size};
+  const char* names[] = {"Pre", "Post", "Depth", "Size"};
+  for (size_t k = 0; k < 4; ++k)
+    for (size_t i = 0; i < X->n; ++i)
+      if (A[k][i] != A_true[k][i]) {
+        cerr << "*** ERROR: *** [" << i << " ] " << names[k] << ' ' << A[k][i]
+             << " != " << A_true[k][i] << endl;
+        assert (false);
+      }
+  cerr << "    (OK!)" << endl;
+}
+
+/**
+ *  One trial of a tree numbering; every trial numbers the same tree,
+ *  and the Euler tour ones rank it in the same ranker
+ */
+struct TreeTrial
+{
+  const Tree_t* T;
+  TreeNumbers_t* X;
+  ParRankedList_t* rankedList;
+};
+
+static void
+runDfsTrial (void* arg)
+{
+  TreeTrial* X = (TreeTrial *)arg;
+  computeTreeNumbers (X->T, X->X);
+}
+
+static void
+runEulerTrial (void* arg)
+{
+  TreeTrial* X = (TreeTrial *)arg;
+  computeTreeNumbers__par (X->T, X->X, X->rankedList);
+}
+
+/** Benchmarks one tree numbering, whose trial is 'run', and prints its statistics as row 'name'. */
+static void
+benchmarkTreeNumbering (const char* name, void (*run) (void*), TreeTrial* X,
+                        tree_shape_t shape, const bench_config_t& C,
+                        struct stopwatch_t* timer, results_t* J)
+{
+  const size_t N = X->T->n;
+  cerr << endl << "... benchmarking " << name << " ..." << endl;
+
+  bench_task_t task = {NULL, run, NULL, NULL, X};
+  bench_result_t R;
+  benchRun (&C, &task, timer, &R);
+
+  cout << name << ',' << N << ',' << R.n << ',' << N / R.median * 1e-6;
+  printTimes (R);
+  printSpread (R);
+  cout << flush;
+  stopwatch_print_counters (stdout, timer, N, ',');
+  cout << endl;
+  beginResult (J, name);
+  addResultInt (J, "n", N);
+  addResultString (J, "tree", getTreeShapeName (shape));
+  addResultTimes (J, &R);
+  endResult (J);
+
+  benchRelease (&R);
+}
+
+/**
+ *  Numbers a random tree of n nodes sequentially (DFS) and by Euler
+ *  tour with the parallel list ranker, checks that they agree, and
+ *  benchmarks both.
+ */
+static void
+benchmarkTrees (size_t n, tree_shape_t shape, const bench_config_t& C,
+                struct stopwatch_t* timer, results_t* J)
+{
+  cerr << endl << "... creating a " << getTreeShapeName (shape) << " tree ..." << endl;
+  Tree_t* T = createRandomTree (n, shape);
+  TreeNumbers_t* X_true = createTreeNumbers (n);
+  TreeNumbers_t* X_par = createTreeNumbers (n);
+  ParRankedList_t* rankedList = setupRanks__par (0, NULL);
+
+  computeTreeNumbers (T, X_true);
+  computeTreeNumbers__par (T, X_par, rankedList);
+  assertTreeNumbersMatch (X_par, X_true);
+
+  TreeTrial X = {T, X_true, rankedList};
+  benchmarkTreeNumbering ("DFS", runDfsTrial, &X, shape, C, timer, J);
+  const string name = string ("EULER-") + getImplName__par ();
+  X.X = X_par;
+  benchmarkTreeNumbering (name.c_str (), runEulerTrial, &X, shape, C, timer, J);
+
+  releaseRanks__par (rankedList);
+  releaseTreeNumbers (X_par);
+  releaseTreeNumbers (X_true);
+  releaseTree (T);
 }
 
 /* ====================================================================== */
@@ -199,27 +588,142 @@ benchmarkListRankers (size_t n, size_t num_trials, struct stopwatch_t* timer)
 int
 main (int argc, char* argv[])
 {
-  if (argc != 3) {
-    cerr << endl << "usage: " << argv[0] << " <n> <trials>\n" << endl;
+  const char* pages_name = NULL;
+  int shape = -1; // lists, not trees
+  long n_lists = 0; // one list, not a forest
+  int lengths = LENGTHS_RANDOM;
+  long block = 1; // fully random
+  int opt;
+  while ((opt = getopt (argc, argv, "b:cf:l:p:t:")) != -1) {
+    if (opt == 'p')
+      pages_name = optarg;
+    else if (opt == 'b') {
+      block = atol (optarg);
+      if (block < 1) argc = 0;
+    }
+    else if (opt == 'f') {
+      n_lists = atol (optarg);
+      if (n_lists < 1) argc = 0;
+    } else if (opt == 'l') {
+      lengths = getListLengths (optarg);
+      if (lengths < 0) argc = 0;
+    }
+    else if (opt == 't') {
+      shape = getTreeShape (optarg);
+      if (shape < 0) argc = 0;
+    }
+    else if (opt == 'c')
+      stopwatch_enable_counters (1);
+    else
+      argc = 0; // print usage
+  }
+
+  if (shape >= 0 && n_lists)
+    argc = 0; // one or the other
+  if (block > 1 && (shape >= 0 || n_lists))
+    argc = 0; // for single lists only
+  if (argc - optind != 2 && argc - optind != 3) {
+    cerr << endl << "usage: " << argv[0] << " [-c] [-p <pages>] [-b <block> | -t <tree> | -f <lists> [-l <lengths>]]" << endl
+         << "       <n> <trials> [<n_max>]" << endl
+         << "where <trials> is the least number of trials (more run, up to" << endl
+         << "$BENCH_MAX_TRIALS, until the median settles; see 'bench.h')," << endl
+         << "-p backs the list and ranks with default, 4k, thp, 2m, or 1g pages" << endl
+         << "(default: $PAGES, else default), and" << endl
+         << "-c appends to each row the hardware counts per ranking (also on with" << endl
+         << "COUNTERS=1): cycles, instructions, IPC, and LLC, dTLB, and branch misses" << endl
+         << "per node. Given <n_max>, the list size doubles from <n> up to" << endl
+         << "<n_max>, for a row per ranker and size. Each size builds one list, which" << endl
+         << "every trial ranks; -b <block> lays it out in runs of <block> consecutive" << endl
+         << "nodes in random order, from 1 (fully random, the default) up to <n> or" << endl
+         << "more (sequential)." << endl
+         << "With -t random or -t path, numbers trees of <n> nodes instead (pre- and" << endl
+         << "postorder, depth, subtree size), by a sequential DFS and by Euler tour" << endl
+         << "with the parallel ranker, and reports nodes per second. A random tree" << endl
+         << "has depth ~ ln n; a path, n-1." << endl
+         << "With -f, ranks forests of <lists> lists in one pool of <n> nodes instead," << endl
+         << "sequentially and in parallel, each node getting its rank and its list's" << endl
+         << "head; -l sets the distribution of the list lengths: equal, random (the" << endl
+         << "default), or zipf (a few long lists, many short ones)." << endl
+         << endl;
     return -1;
   }
 
-  int N = atoi (argv[1]); assert (N > 0);
-  int NTRIALS = atoi (argv[2]); assert (NTRIALS > 0);
+  long N = atol (argv[optind]); assert (N > 0);
+  int NTRIALS = atoi (argv[optind+1]); assert (NTRIALS > 0);
+  long N_MAX = (argc - optind == 3) ? atol (argv[optind+2]) : N;
+  assert (N_MAX >= N);
+  if (setupPageKind (pages_name))
+    return -1;
+
+  bench_config_t C;
+  benchDefaults (&C);
+  C.min_trials = NTRIALS;
+  if (C.max_trials < C.min_trials) C.max_trials = C.min_trials;
 
   cerr << endl
-       << "N: " << N << endl
-       << "Node size: " << sizeof (index_t) << " + " << sizeof (rank_t) << " bytes" << endl
-       << "Trials: " << NTRIALS << endl
+       << "N: " << N;
+  if (N_MAX > N)
+    cerr << " to " << N_MAX << ", doubling";
+  cerr << endl
+       << "Node size (sequential): " << sizeof (index_t) << " + " << sizeof (rank_t) << " bytes" << endl;
+  printBenchConfig (stderr, &C);
+  if (shape < 0 && !n_lists) {
+    cerr << "List: ";
+    if (block == 1)
+      cerr << "random" << endl;
+    else
+      cerr << "runs of " << block << " nodes" << endl;
+  }
+  if (n_lists)
+    cerr << "Forest: " << n_lists << " lists, "
+         << getListLengthsName ((list_lengths_t)lengths) << " lengths" << endl;
+  if (shape >= 0)
+    cerr << "Tree: " << getTreeShapeName ((tree_shape_t)shape) << endl
+         << "Columns: impl,n,trials,Mnodes/s,min,median,max,mean,MAD,CI low,CI high" << flush;
+  else
+    cerr << "Columns: impl,n,trials,GB/s,min,median,max,mean,MAD,CI low,CI high"
+         << "[,setup min,median,max,mean,copy-out min,median,max,mean]" << flush;
+  stopwatch_print_counters_header (stderr, ',');
+  cerr << endl
        << endl;
 
   stopwatch_init ();
   struct stopwatch_t* timer = stopwatch_create ();
   assert (timer);
 
-  checkParallelListRanker (N);
-  benchmarkListRankers (N, NTRIALS, timer);
+  results_t* J = openResults ("listrank");
+  addResultInt (J, "n", N);
+  if (N_MAX > N)
+    addResultInt (J, "n_max", N_MAX);
+  addResultInt (J, "min_trials", NTRIALS);
+  addResultString (J, "impl", getImplName__par ());
+  addResultInt (J, "node_bytes", sizeof (index_t) + sizeof (rank_t));
+  addResultString (J, "pages", getPageKindName (getDefaultPageKind ()));
+  if (shape < 0 && !n_lists)
+    addResultInt (J, "block", block);
+  if (shape >= 0)
+    addResultString (J, "tree", getTreeShapeName ((tree_shape_t)shape));
+  if (n_lists) {
+    addResultInt (J, "lists", n_lists);
+    addResultString (J, "lengths", getListLengthsName ((list_lengths_t)lengths));
+  }
+
+#if !defined (NDEBUG)
+  // Like the rankers' checks, these abort through assert
+  if (shape < 0 && !n_lists)
+    checkListScans ();
+#endif
+  for (long n = N; n <= N_MAX; n *= 2) {
+    if (shape >= 0)
+      benchmarkTrees (n, (tree_shape_t)shape, C, timer, J);
+    else if (n_lists)
+      benchmarkForests (n, min (n_lists, n), (list_lengths_t)lengths, C, timer, J);
+    else {
+      benchmarkListRankers (n, block, C, timer, J);
+    }
+  }
 
+  closeResults (J);
   stopwatch_destroy (timer);
   return 0;
 }
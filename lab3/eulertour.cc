@@ -0,0 +1,139 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file eulertour.cc
+ *  \brief Implements the eulertour.hh interface using Cilk Plus.
+ */
+
+#include <cassert>
+#include <cstdlib>
+
+#include <algorithm>
+
+#include <cilk/cilk_api.h>
+
+#include "hugepages.h"
+#include "listrank-par.hh"
+#include "eulertour.hh"
+
+using namespace std;
+
+/** Blocks per Cilk worker in the counting passes */
+#define BLOCKS_PER_WORKER 8
+
+/* ====================================================================== */
+
+static inline index_t enterArc (index_t v) { return 2*v; }
+static inline index_t leaveArc (index_t v) { return 2*v + 1; }
+
+index_t *
+createEulerTour (const Tree_t* T)
+{
+  assert (T);
+  const size_t n = T->n;
+  if (!n) return NULL;
+  index_t* Tour = (index_t *)allocPages (2 * n * sizeof (index_t), getDefaultPageKind ());
+  assert (Tour);
+
+  _Cilk_for (size_t k = 0; k < n; ++k) {
+    const index_t v = k;
+    // After entering v: its first child, else back out of v
+    const index_t child = T->FirstChild[v];
+    Tour[enterArc (v)] = (child != NIL) ? enterArc (child) : leaveArc (v);
+
+    // After leaving v: its next sibling, else back out of its parent
+    const index_t sibling = T->NextSibling[v];
+    const index_t parent = T->Parent[v];
+    if (sibling != NIL)
+      Tour[leaveArc (v)] = enterArc (sibling);
+    else if (parent != NIL)
+      Tour[leaveArc (v)] = leaveArc (parent);
+    else
+      Tour[leaveArc (v)] = NIL; // the root: the end of the tour
+  }
+  return Tour;
+}
+
+/* ====================================================================== */
+
+void
+computeTreeNumbers__par (const Tree_t* T, TreeNumbers_t* X, ParRankedList_t* L)
+{
+  assert (T && X && X->n == T->n);
+  const size_t n = T->n;
+  if (T->root == NIL) return; // empty tree
+  const size_t m = 2 * n; // arcs
+
+  // Rank the tour, which starts at arc 2*root; the rankers find the
+  // head themselves.
+  index_t* Next = createEulerTour (T);
+  ParRankedList_t* L_own = NULL;
+  if (L)
+    resetRanks__par (L, m, Next, NULL);
+  else
+    L = L_own = setupRanks__par (m, Next);
+  computeListRanks__par (L);
+  const rank_t* Rank = getRanks__par (L);
+
+  // Lay the arcs out in tour order; Rank counts arcs to the tail.
+  // 'Next' is done with, so it holds the order.
+  index_t* Order = Next;
+  _Cilk_for (size_t a = 0; a < m; ++a) {
+    Order[m - 1 - Rank[a]] = a;
+  }
+  releaseRanks__par (L_own);
+
+  // Count the entering arcs per block of the tour...
+  const size_t n_blocks = (size_t)__cilkrts_get_nworkers () * BLOCKS_PER_WORKER;
+  const size_t block = (m + n_blocks - 1) / n_blocks;
+  index_t* Count = new index_t[n_blocks]; assert (Count);
+  _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+    const size_t p_max = min (m, (b + 1) * block);
+    index_t count = 0;
+    for (size_t p = b * block; p < p_max; ++p)
+      count += !(Order[p] & 1);
+    Count[b] = count;
+  }
+  index_t before = 0;
+  for (size_t b = 0; b < n_blocks; ++b) {
+    const index_t count = Count[b];
+    Count[b] = before;
+    before += count;
+  }
+  assert (before == (index_t)n);
+
+  // ... then walk the tour again: at node v's entering arc, at
+  // position p, with c entering arcs before it, Pre[v] = c and
+  // Depth[v] = c - (p - c), the arcs in less those out. Post holds
+  // the position of v's leaving arc until the last pass.
+  _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+    const size_t p_max = min (m, (b + 1) * block);
+    index_t c = Count[b];
+    for (index_t p = b * block; p < (index_t)p_max; ++p) {
+      const index_t a = Order[p];
+      const index_t v = a / 2;
+      if (a & 1)
+        X->Post[v] = p;
+      else {
+        X->Pre[v] = c;
+        X->Depth[v] = 2*c - p;
+        ++c;
+      }
+    }
+  }
+  delete[] Count;
+
+  // The subtree of v lies between its two arcs, and postorder counts
+  // the leaving arcs before v's, i.e., all arcs before it but the
+  // entering arcs of the nodes up to v's subtree.
+  _Cilk_for (size_t k = 0; k < n; ++k) {
+    const index_t v = k;
+    const index_t p_in = 2*X->Pre[v] - X->Depth[v];
+    const index_t p_out = X->Post[v];
+    X->Size[v] = (p_out - p_in + 1) / 2;
+    X->Post[v] = p_out - X->Pre[v] - X->Size[v];
+  }
+
+  releaseListBuffer (Next);
+}
+
+// eof
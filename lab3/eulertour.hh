@@ -0,0 +1,37 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file eulertour.hh
+ *  \brief Tree numbering in parallel, by ranking the tree's Euler
+ *  tour with the parallel list ranker ('listrank-par.hh').
+ */
+
+#if !defined (INC_EULERTOUR_HH)
+#define INC_EULERTOUR_HH //!< eulertour.hh included
+
+#include "tree.hh"
+#include "listrank-par.hh"
+
+/**
+ *  Returns a new array pool of the 2n arcs of T's Euler tour: arc 2v
+ *  enters node v from its parent and arc 2v+1 leaves it, so the tour
+ *  is one list from arc 2*root to arc 2*root+1 that visits every
+ *  arc. Children are visited in the order of the child lists.
+ */
+index_t* createEulerTour (const Tree_t* T);
+
+/**
+ *  Computes the same numbers as computeTreeNumbers(), in parallel:
+ *  it builds the Euler tour, ranks it with computeListRanks__par(),
+ *  lays the arcs out in tour order, and counts the arcs that enter a
+ *  node before each arc. Then a node's preorder number is the count
+ *  at its entering arc, and the positions of its two arcs give its
+ *  depth, subtree size, and postorder number. The tour is ranked in
+ *  L, reset for it (see resetRanks__par()), so that numbering many
+ *  trees reuses its buffers; if L is NULL, in a ranker of its own.
+ */
+void computeTreeNumbers__par (const Tree_t* T, TreeNumbers_t* X,
+                              ParRankedList_t* L = NULL);
+
+#endif // !defined (INC_EULERTOUR_HH)
+
+// eof
@@ -0,0 +1,256 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file forestrank-cilk.cc
+ *
+ *  \brief Implement the 'forestrank-par.hh' interface with a sparse
+ *  ruling set, using Cilk Plus.
+ *
+ *  As in 'listscan-par.hh', rulers cut the lists into sublists, which
+ *  are walked in parallel, ranked as short lists of sublists, and
+ *  walked again to write the ranks. Here every head is a ruler, so
+ *  each short list is a sublist of its own, and (workers *
+ *  RULERS_PER_WORKER) random nodes are rulers too, which cut the long
+ *  lists into pieces of about n / that many nodes. So however skewed
+ *  the lengths, no sublist is much longer than that, and the parallel
+ *  loops over sublists balance the work.
+ *
+ *  Until the last walk, Rank[r] holds the index of the sublist that
+ *  ruler r starts, so that a walk that runs into the next ruler finds
+ *  its sublist directly.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include <cilk/cilk_api.h>
+
+#include "hugepages.h"
+#include "forestrank-par.hh"
+
+using namespace std;
+
+/** Random rulers per Cilk worker, beyond the heads */
+#if !defined (RULERS_PER_WORKER)
+#  define RULERS_PER_WORKER 64
+#endif
+
+/** Nodes per random ruler, at least */
+#define MIN_SUBLIST_LENGTH 64
+
+/** Blocks per Cilk worker in the passes over the nodes */
+#define BLOCKS_PER_WORKER 8
+
+typedef unsigned long word_t; //!< Bitmap word
+#define WORD_BITS (8 * sizeof (word_t))
+
+#define NONE ((size_t)-1)
+
+// ============================================================
+
+/** One sublist, from its ruler up to (not including) the next ruler */
+struct Sublist_t
+{
+  index_t ruler;
+  size_t length;
+  size_t next;  //!< Successor sublist, or 'NONE' at the tail
+  rank_t rank;  //!< Rank of the ruler
+  index_t head; //!< Of its list
+};
+
+struct ParRankedForest_t__
+{
+  size_t n;
+  const index_t* Next;
+  index_t* ListId;
+  rank_t* Rank;
+  word_t* IsRuler;     //!< Bitmap, cleared by each call
+  size_t n_blocks;
+  size_t* Count;       //!< Heads per block
+  vector<Sublist_t> Sub;
+};
+
+// ============================================================
+
+ParRankedForest_t *
+setupForestRanks__par (size_t n, const index_t* Next)
+{
+  ParRankedForest_t* F = new ParRankedForest_t;
+  assert (F);
+
+  F->n = n;
+  F->Next = Next;
+  F->ListId = n ? (index_t *)allocPages (n * sizeof (index_t), getDefaultPageKind ()) : NULL;
+  assert (F->ListId || !n);
+  F->Rank = createRanksBuffer (n);
+  F->IsRuler = new word_t[(n + WORD_BITS - 1) / WORD_BITS]; assert (F->IsRuler);
+  F->n_blocks = (size_t)__cilkrts_get_nworkers () * BLOCKS_PER_WORKER;
+  F->Count = new size_t[F->n_blocks]; assert (F->Count);
+
+  return F;
+}
+
+void
+releaseForestRanks__par (ParRankedForest_t* F)
+{
+  if (F) {
+    freePages (F->ListId);
+    releaseRanksBuffer (F->Rank);
+    delete[] F->IsRuler;
+    delete[] F->Count;
+    delete F;
+  }
+}
+
+const rank_t *
+getForestRanks__par (const ParRankedForest_t* F)
+{
+  return F->Rank;
+}
+
+const index_t *
+getListIds__par (const ParRankedForest_t* F)
+{
+  return F->ListId;
+}
+
+// ============================================================
+
+static inline bool
+isRuler (const word_t* IsRuler, index_t i)
+{
+  return (IsRuler[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+/** xorshift64*, so as not to disturb the driver's lrand48() stream */
+static unsigned long long
+nextRandom (unsigned long long* state)
+{
+  unsigned long long x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * 0x2545F4914F6CDD1Dull;
+}
+
+size_t
+computeForestRanks__par (ParRankedForest_t* F)
+{
+  assert (F != NULL);
+  const size_t n = F->n;
+  if (n == 0) return 0; // empty pool
+  const index_t* Next = F->Next;
+  index_t* ListId = F->ListId;
+  rank_t* Rank = F->Rank;
+  word_t* IsRuler = F->IsRuler;
+  size_t* Count = F->Count;
+  const size_t n_blocks = F->n_blocks;
+  const size_t block = (n + n_blocks - 1) / n_blocks;
+  assert (Next);
+
+  // Find the heads: ListId[i] == i, until i is found to be a next.
+  // Each node is the next of at most one other, so no two stores
+  // race.
+  _Cilk_for (size_t i = 0; i < n; ++i) {
+    ListId[i] = i;
+    if (i % WORD_BITS == 0)
+      IsRuler[i / WORD_BITS] = 0;
+  }
+  _Cilk_for (size_t i = 0; i < n; ++i) {
+    if (Next[i] != NIL)
+      ListId[Next[i]] = NIL;
+  }
+
+  // Make each head the ruler of a sublist, in index order
+  _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+    const size_t i_max = min (n, (b + 1) * block);
+    size_t count = 0;
+    for (size_t i = b * block; i < i_max; ++i)
+      count += (ListId[i] == (index_t)i);
+    Count[b] = count;
+  }
+  size_t n_heads = 0;
+  for (size_t b = 0; b < n_blocks; ++b) {
+    const size_t count = Count[b];
+    Count[b] = n_heads;
+    n_heads += count;
+  }
+  assert (n_heads > 0); // else, a cycle
+
+  const size_t n_random = min ((size_t)__cilkrts_get_nworkers () * RULERS_PER_WORKER,
+                               n / MIN_SUBLIST_LENGTH);
+  vector<Sublist_t>& Sublists = F->Sub;
+  if (Sublists.size () < n_heads + n_random)
+    Sublists.resize (n_heads + n_random);
+  Sublist_t* Sub = &Sublists[0];
+
+  _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+    const size_t i_max = min (n, (b + 1) * block);
+    size_t j = Count[b];
+    for (size_t i = b * block; i < i_max; ++i)
+      if (ListId[i] == (index_t)i) {
+        Sub[j].ruler = i;
+        Rank[i] = j;
+        __sync_fetch_and_or (&IsRuler[i / WORD_BITS], (word_t)1 << (i % WORD_BITS));
+        ++j;
+      }
+  }
+
+  // Then some random nodes, which split the long lists
+  size_t s = n_heads;
+  unsigned long long state = 0x9E3779B97F4A7C15ull ^ n;
+  for (size_t t = 0; t < n_random; ++t) {
+    const index_t i = (index_t)(nextRandom (&state) % n);
+    if (isRuler (IsRuler, i)) continue;
+    IsRuler[i / WORD_BITS] |= (word_t)1 << (i % WORD_BITS);
+    Sub[s].ruler = i;
+    Rank[i] = s;
+    ++s;
+  }
+
+  // 1. Walk each sublist up to the next ruler, for its length
+  _Cilk_for (size_t j = 0; j < s; ++j) {
+    index_t cur = Sub[j].ruler;
+    size_t length = 0;
+    do {
+      ++length;
+      cur = Next[cur];
+    } while (cur != NIL && !isRuler (IsRuler, cur));
+    Sub[j].length = length;
+    Sub[j].next = (cur == NIL) ? NONE : (size_t)Rank[cur];
+  }
+
+  // 2. Rank the rulers, list by list: the sublists of a list follow
+  // on from its head's. Only the long lists have more than one.
+  _Cilk_for (size_t h = 0; h < n_heads; ++h) {
+    rank_t total = 0;
+    for (size_t j = h; j != NONE; j = Sub[j].next)
+      total += Sub[j].length;
+    const index_t head = Sub[h].ruler;
+    for (size_t j = h; j != NONE; j = Sub[j].next) {
+      Sub[j].rank = total - 1;
+      Sub[j].head = head;
+      total -= Sub[j].length;
+    }
+  }
+
+  // 3. Walk each sublist again, writing the ranks and list ids
+  _Cilk_for (size_t j = 0; j < s; ++j) {
+    index_t cur = Sub[j].ruler;
+    rank_t r = Sub[j].rank;
+    const index_t head = Sub[j].head;
+    for (size_t length = Sub[j].length; length; --length) {
+      Rank[cur] = r--;
+      ListId[cur] = head;
+      cur = Next[cur];
+    }
+  }
+
+  return n_heads;
+}
+
+// eof
@@ -0,0 +1,47 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file forestrank-par.hh
+ *  \brief Interface for a parallel forest ranker: a parallel
+ *  computeForestRanks(), for pools of many lists.
+ */
+
+#if !defined (INC_FORESTRANK_PAR_HH)
+#define INC_FORESTRANK_PAR_HH //!< forestrank-par.hh included
+
+#include "listrank.hh"
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+  /**
+   *  Opaque, implementation-dependent data type for storing a parallel
+   *  forest ranking data structure.
+   */
+  typedef struct ParRankedForest_t__ ParRankedForest_t;
+
+  /** Returns a new data structure for ranking the forest in Next[0:n-1]. */
+  ParRankedForest_t* setupForestRanks__par (size_t n, const index_t* Next);
+
+  /**
+   *  A parallel implementation of computeForestRanks(); see
+   *  'listrank.hh'. Returns the number of lists.
+   */
+  size_t computeForestRanks__par (ParRankedForest_t* F);
+
+  /** After running computeForestRanks__par(), these are the ranks and list ids. */
+  const rank_t* getForestRanks__par (const ParRankedForest_t* F);
+  const index_t* getListIds__par (const ParRankedForest_t* F);
+
+  /**
+   *  Frees parallel forest rank data structure, F, and with it the
+   *  arrays of getForestRanks__par(F) and getListIds__par(F).
+   */
+  void releaseForestRanks__par (ParRankedForest_t* F);
+
+#if defined (__cplusplus)
+} // extern "C"
+#endif
+#endif // !defined (INC_FORESTRANK_PAR_HH)
+
+// eof
@@ -0,0 +1,67 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file forestrank-seq.cc
+ *
+ *  \brief Implement the 'forestrank-par.hh' interface with the
+ *  sequential computeForestRanks(), for backends built without Cilk
+ *  Plus (the CUDA one), so that their drivers still rank forests.
+ */
+
+#include <cassert>
+
+#include "hugepages.h"
+#include "forestrank-par.hh"
+
+struct ParRankedForest_t__
+{
+  size_t n;
+  const index_t* Next;
+  index_t* ListId;
+  rank_t* Rank;
+};
+
+ParRankedForest_t *
+setupForestRanks__par (size_t n, const index_t* Next)
+{
+  ParRankedForest_t* F = new ParRankedForest_t;
+  assert (F);
+
+  F->n = n;
+  F->Next = Next;
+  F->ListId = n ? (index_t *)allocPages (n * sizeof (index_t), getDefaultPageKind ()) : NULL;
+  assert (F->ListId || !n);
+  F->Rank = createRanksBuffer (n);
+
+  return F;
+}
+
+void
+releaseForestRanks__par (ParRankedForest_t* F)
+{
+  if (F) {
+    freePages (F->ListId);
+    releaseRanksBuffer (F->Rank);
+    delete F;
+  }
+}
+
+const rank_t *
+getForestRanks__par (const ParRankedForest_t* F)
+{
+  return F->Rank;
+}
+
+const index_t *
+getListIds__par (const ParRankedForest_t* F)
+{
+  return F->ListId;
+}
+
+size_t
+computeForestRanks__par (ParRankedForest_t* F)
+{
+  assert (F);
+  return computeForestRanks (F->n, F->Next, F->ListId, F->Rank);
+}
+
+// eof
@@ -0,0 +1,277 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file latency.cc
+ *  \brief Pointer-chasing memory latency benchmark.
+ *
+ *  This program turns a random list (see 'list.hh') into a cycle,
+ *  lays its nodes out one per 'stride' bytes, and follows it for
+ *  working sets from a few KiB up to a given size, reporting the time
+ *  per dependent load. It then repeats each size with the same nodes
+ *  cut into k disjoint cycles, chased by k interleaved cursors, which
+ *  lets up to k misses overlap (memory-level parallelism), and with
+ *  the buffer on 4 KiB versus huge pages (transparent by default; see
+ *  'hugepages.h'), which isolates the cost of TLB misses.
+ */
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+
+#include <unistd.h>
+
+#include "timer.h"
+#include "bench.h"
+#include "results.h"
+#include "hugepages.h"
+#include "list.hh"
+
+using namespace std;
+
+#define MIN_BYTES (4 << 10) //!< Smallest working set
+#define STEPS_PER_OCTAVE 2 //!< Working-set sizes per doubling
+#define MIN_LOADS (1 << 22) //!< Fewest timed loads per cursor count
+#define MAX_CHAINS 16 //!< Largest number of interleaved cursors
+
+/* ====================================================================== */
+
+#define NUM_PAGE_MODES 2 //!< Base pages, then huge pages
+
+/**
+ *  Returns a new 'bytes'-byte buffer on pages of the given kind,
+ *  touched so that the kernel has already chosen its pages.
+ */
+static char *
+createChaseBuffer (size_t bytes, page_kind_t kind)
+{
+  char* buf = (char *)allocPages (bytes, kind); assert (buf);
+  memset (buf, 0, bytes);
+  return buf;
+}
+
+/**
+ *  Returns the nodes 0..n-1 in the order of a random list through
+ *  them (see 'createRandomList'), starting at node 0.
+ */
+static index_t *
+createRandomOrder (size_t n)
+{
+  index_t* Next = createRandomList (n);
+  index_t* Order = new index_t[n]; assert (Order);
+  index_t cur = 0;
+  for (size_t i = 0; i < n; ++i, cur = Next[cur])
+    Order[i] = cur;
+  assert (cur == NIL);
+  releaseListBuffer (Next);
+  return Order;
+}
+
+/**
+ *  Links the n nodes of Buf (one per 'stride' bytes) into k disjoint
+ *  cycles, by cutting the random order into k equal pieces; each node
+ *  holds the address of its successor. Writes the first node of each
+ *  cycle to Heads[0:k-1].
+ */
+static void
+linkRandomCycles (size_t n, const index_t* Order, int k, size_t stride,
+                  char* Buf, char** Heads)
+{
+  for (int c = 0; c < k; ++c) {
+    const size_t lo = n * c / k, hi = n * (c+1) / k;
+    for (size_t i = lo; i < hi; ++i) {
+      const index_t j = Order[(i+1 < hi) ? (i+1) : lo];
+      *(char **)(Buf + Order[i]*stride) = Buf + j*stride;
+    }
+    Heads[c] = Buf + Order[lo]*stride;
+  }
+}
+
+/* ====================================================================== */
+
+/**
+ *  Advances K cursors 'steps' nodes each; the K chains of loads are
+ *  independent of one another, so their misses may overlap.
+ */
+template <int K>
+static void
+chase (char** Cur, size_t steps)
+{
+  char* p[K];
+  for (int k = 0; k < K; ++k) p[k] = Cur[k];
+  for (size_t s = 0; s < steps; ++s)
+    for (int k = 0; k < K; ++k)
+      p[k] = *(char **)p[k];
+  for (int k = 0; k < K; ++k) Cur[k] = p[k];
+}
+
+static void
+chase (int k, char** Cur, size_t steps)
+{
+  switch (k) {
+  case 1: chase<1> (Cur, steps); break;
+  case 2: chase<2> (Cur, steps); break;
+  case 4: chase<4> (Cur, steps); break;
+  case 8: chase<8> (Cur, steps); break;
+  case 16: chase<16> (Cur, steps); break;
+  default: assert (false);
+  }
+}
+
+/** Where the cursors end up, to keep the chase from being optimized away */
+char* volatile chase_sink;
+
+/** One trial of the chase: 'steps' rounds of k cursors */
+struct ChaseTrial
+{
+  int k;
+  char** Cur;
+  size_t steps;
+};
+
+static void
+runChase (void* arg)
+{
+  ChaseTrial* X = (ChaseTrial *)arg;
+  chase (X->k, X->Cur, X->steps);
+}
+
+/**
+ *  Times k cursors, one per cycle (see 'linkRandomCycles'), and
+ *  returns the best time per round (one load from each cursor), in
+ *  seconds, over the trials C runs. Each trial visits every node at
+ *  least once; 'loads' is set to the loads per trial. Adds the times
+ *  to the current benchmark of J.
+ */
+static long double
+timeChains (size_t n, char** Heads, int k, const bench_config_t& C,
+            struct stopwatch_t* timer, results_t* J, size_t& loads)
+{
+  char* Cur[MAX_CHAINS];
+  for (int c = 0; c < k; ++c)
+    Cur[c] = Heads[c];
+
+  const size_t steps = (n > MIN_LOADS) ? (n / k) : (MIN_LOADS / k);
+  ChaseTrial X = {k, Cur, steps};
+  bench_task_t task = {NULL, runChase, NULL, NULL, &X};
+  bench_result_t R;
+  benchRun (&C, &task, timer, &R);
+  const long double t_min = R.min;
+  addResultTimes (J, &R);
+  benchRelease (&R);
+
+  for (int c = 0; c < k; ++c) chase_sink = Cur[c];
+
+  loads = steps * k;
+  return t_min / steps;
+}
+
+/* ====================================================================== */
+
+int
+main (int argc, char* argv[])
+{
+  size_t stride = 64;
+  int max_chains = MAX_CHAINS;
+  page_kind_t huge_kind = PAGES_THP;
+  int opt;
+  while ((opt = getopt (argc, argv, "ck:p:s:")) != -1) {
+    switch (opt) {
+    case 'c': stopwatch_enable_counters (1); break;
+    case 'k': max_chains = atoi (optarg); break;
+    case 'p':
+      if (parsePageKind (optarg, &huge_kind) || huge_kind < PAGES_THP)
+        argc = 0;
+      break;
+    case 's': stride = atol (optarg); break;
+    default: argc = 0; break;
+    }
+  }
+
+  if (argc - optind < 1 || max_chains < 1 || max_chains > MAX_CHAINS
+      || stride < sizeof (char *) || stride % sizeof (char *)) {
+    cerr << endl
+         << "usage: " << argv[0] << " [-c] [-k <chains>] [-p <pages>] [-s <stride>] <max-bytes> [<trials>]" << endl
+         << "where -c appends hardware counts per trial, and misses per load" << endl
+         << "         (also on with COUNTERS=1)," << endl
+         << "      -k is the largest number of interleaved chains (1-" << MAX_CHAINS
+         << ", default " << MAX_CHAINS << ")," << endl
+         << "      -p is the huge-page kind to compare with 4k pages: thp, 2m, or 1g" << endl
+         << "         (default thp)," << endl
+         << "      -s is the bytes per node (a multiple of " << sizeof (char *)
+         << ", default 64)," << endl
+         << "      <max-bytes> is the largest working set, and" << endl
+         << "      <trials> is the least number of trials per point (default 3; more" << endl
+         << "         run until the median settles, see 'bench.h')." << endl
+         << endl;
+    return -1;
+  }
+
+  const size_t max_bytes = atol (argv[optind]);
+  const size_t num_trials = (argc - optind > 1) ? atoi (argv[optind+1]) : 3;
+  assert (max_bytes >= MIN_BYTES && num_trials > 0);
+
+  bench_config_t C;
+  benchDefaults (&C);
+  C.min_trials = num_trials;
+  if (C.max_trials < C.min_trials) C.max_trials = C.min_trials;
+
+  cerr << endl
+       << "Node stride: " << stride << " bytes" << endl;
+  printBenchConfig (stderr, &C);
+  cerr << "Columns: pages,bytes,nodes,chains,ns per load,ns per round,huge-page %" << flush;
+  stopwatch_print_counters_header (stderr, ',');
+  cerr << endl
+       << endl;
+
+  stopwatch_init ();
+  struct stopwatch_t* timer = stopwatch_create ();
+  assert (timer);
+
+  results_t* J = openResults ("latency");
+  addResultInt (J, "stride", stride);
+  addResultInt (J, "max_bytes", max_bytes);
+  addResultInt (J, "min_trials", num_trials);
+
+  for (int step = 0; ; ++step) {
+    const size_t bytes = (size_t)(MIN_BYTES * exp2 ((double)step / STEPS_PER_OCTAVE))
+      / stride * stride;
+    if (bytes > max_bytes) break;
+    const size_t n = bytes / stride;
+    index_t* Order = createRandomOrder (n);
+
+    for (int mode = 0; mode < NUM_PAGE_MODES; ++mode) {
+      char* Buf = createChaseBuffer (bytes, mode ? huge_kind : PAGES_4K);
+      const size_t huge_bytes = getHugePageBytes (Buf);
+      const double huge = 100.0 * (huge_bytes < bytes ? huge_bytes : bytes) / bytes;
+      const char* pages = getPageKindName (getPageKind (Buf));
+
+      for (int k = 1; k <= max_chains && (size_t)k <= n; k *= 2) {
+        char* Heads[MAX_CHAINS];
+        linkRandomCycles (n, Order, k, stride, Buf, Heads);
+        size_t loads = 0;
+        beginResult (J, "chase");
+        addResultString (J, "pages", pages);
+        addResultInt (J, "bytes", bytes);
+        addResultInt (J, "chains", k);
+        const long double t = timeChains (n, Heads, k, C, timer, J, loads);
+        addResultReal (J, "huge_pct", huge);
+        endResult (J);
+        cout << pages << ',' << bytes << ',' << n << ',' << k
+             << ',' << t * 1e9 / k << ',' << t * 1e9 << ',' << huge << flush;
+        stopwatch_print_counters (stdout, timer, loads, ',');
+        cout << endl;
+      }
+      freePages (Buf);
+    }
+    delete[] Order;
+  }
+
+  closeResults (J);
+  stopwatch_destroy (timer);
+  return 0;
+}
+
+// eof
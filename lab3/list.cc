@@ -10,7 +10,9 @@
 
 #include <algorithm>
 #include <iostream>
+#include <vector>
 
+#include "hugepages.h"
 #include "list.hh"
 
 using namespace std;
@@ -20,15 +22,27 @@ using namespace std;
 index_t *
 duplicate (size_t n, const index_t* A)
 {
-  index_t* B = new index_t[n]; assert (B);
+  index_t* B = (index_t *)allocPages (n * sizeof (index_t), getDefaultPageKind ());
+  assert (B);
   memcpy (B, A, n * sizeof (index_t));
   return B;
 }
 
+index_t *
+createListBuffer (size_t n)
+{
+  index_t* A = NULL;
+  if (n) {
+    A = (index_t *)allocPages (n * sizeof (index_t), getDefaultPageKind ());
+    assert (A);
+  }
+  return A;
+}
+
 void
 releaseListBuffer (index_t* Next)
 {
-  if (Next) delete[] Next;
+  freePages (Next);
 }
 
 /** Generates a uniform random permutation of an array */
@@ -43,28 +57,226 @@ shuffle (size_t n, index_t* A)
 
 /* ====================================================================== */
 
+/** The splitmix64 finalizer: a counter-based random number per 'x' */
+static unsigned long long
+mix64 (unsigned long long x)
+{
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+#define FEISTEL_ROUNDS 4
+
+/**
+ *  A pseudo-random permutation of [0, m): a Feistel network on the
+ *  smallest even number of bits that holds m-1, with mix64() as the
+ *  round function. Values that land at or above m are sent through
+ *  again ("cycle walking"), which takes fewer than 4 rounds on
+ *  average since the domain is less than 4m.
+ */
+struct Feistel_t
+{
+  size_t m;
+  unsigned bits;            //!< Half the width
+  unsigned long long mask;  //!< Of one half
+  unsigned long long key[FEISTEL_ROUNDS];
+};
+
+static void
+setupFeistel (Feistel_t* F, size_t m, unsigned long long seed)
+{
+  F->m = m;
+  F->bits = 1;
+  while (2 * F->bits < 64 && (1ull << (2 * F->bits)) < m)
+    ++F->bits;
+  F->mask = (1ull << F->bits) - 1;
+  for (size_t r = 0; r < FEISTEL_ROUNDS; ++r)
+    F->key[r] = mix64 (seed + r);
+}
+
+static size_t
+permute (const Feistel_t* F, size_t x)
+{
+  do {
+    unsigned long long L = x >> F->bits, R = x & F->mask;
+    for (size_t r = 0; r < FEISTEL_ROUNDS; ++r) {
+      const unsigned long long T = L ^ (mix64 (R ^ F->key[r]) & F->mask);
+      L = R;
+      R = T;
+    }
+    x = (L << F->bits) | R;
+  } while (x >= F->m);
+  return x;
+}
+
+/** The inverse of permute() */
+static size_t
+unpermute (const Feistel_t* F, size_t x)
+{
+  do {
+    unsigned long long L = x >> F->bits, R = x & F->mask;
+    for (size_t r = FEISTEL_ROUNDS; r > 0; --r) {
+      const unsigned long long T = R ^ (mix64 (L ^ F->key[r-1]) & F->mask);
+      R = L;
+      L = T;
+    }
+    x = (L << F->bits) | R;
+  } while (x >= F->m);
+  return x;
+}
+
+/**
+ *  Where createClusteredList() puts each position of the list: the
+ *  full blocks of positions go to the full blocks of nodes in the
+ *  order of 'Blocks', and a short last block stays at the end. The
+ *  nodes at 0 and at the head's place then trade places, to put the
+ *  head at 0.
+ */
+struct ListLayout_t
+{
+  size_t block;
+  Feistel_t Blocks;  //!< Order of the full blocks
+  index_t head;      //!< Node of position 0, before the trade
+};
+
+/** Returns the node at position k, before the trade */
+static index_t
+layoutNode (const ListLayout_t* L, size_t k)
+{
+  const size_t b = k / L->block;
+  if (b >= L->Blocks.m) return k; // the short block
+  return permute (&L->Blocks, b) * L->block + k % L->block;
+}
+
+/** Returns the position of node i, before the trade */
+static size_t
+layoutPosition (const ListLayout_t* L, index_t i)
+{
+  const size_t b = i / L->block;
+  if (b >= L->Blocks.m) return i;
+  return unpermute (&L->Blocks, b) * L->block + i % L->block;
+}
+
+static index_t
+getListNode (const ListLayout_t* L, size_t k)
+{
+  if (!k) return 0;
+  const index_t i = layoutNode (L, k);
+  return i ? i : L->head;
+}
+
+static size_t
+getListPosition (const ListLayout_t* L, index_t i)
+{
+  if (!i) return 0;
+  return (i == L->head) ? layoutPosition (L, 0) : layoutPosition (L, i);
+}
+
+index_t *
+createClusteredList (size_t n, size_t block)
+{
+  index_t* Next = createListBuffer (n);
+  if (!n) return Next;
+  block = min (max (block, (size_t)1), n);
+
+  // Seed from lrand48(), so srand48() still picks the list
+  const unsigned long long seed = ((unsigned long long)lrand48 () << 31) ^ lrand48 ();
+  ListLayout_t L;
+  L.block = block;
+  setupFeistel (&L.Blocks, n / block, seed);
+  L.head = layoutNode (&L, 0);
+
+  // Each node finds its own position, so the pool fills in order
+  _Cilk_for (size_t i = 0; i < n; ++i) {
+    const size_t k = getListPosition (&L, i);
+    Next[i] = (k + 1 < n) ? getListNode (&L, k + 1) : NIL;
+  }
+  return Next;
+}
+
 index_t *
 createRandomList (size_t n)
 {
-  // Create an initial linked list where each node i points to i+1.
-  index_t* Init = new index_t[n]; assert (Init);
-  for (size_t i = 0; i < n; ++i)
-    Init[i] = i + 1;
-  Init[n-1] = NIL; // "NULL" pointer
+  return createClusteredList (n, 1);
+}
 
-  // Remap node i > 0 to position AddrMap[i].
+/* ====================================================================== */
+
+int
+getListLengths (const char* name)
+{
+  if (!strcmp (name, "equal")) return LENGTHS_EQUAL;
+  if (!strcmp (name, "random")) return LENGTHS_RANDOM;
+  if (!strcmp (name, "zipf")) return LENGTHS_ZIPF;
+  return -1;
+}
+
+const char *
+getListLengthsName (list_lengths_t lengths)
+{
+  switch (lengths) {
+  case LENGTHS_EQUAL: return "equal";
+  case LENGTHS_RANDOM: return "random";
+  default: return "zipf";
+  }
+}
+
+/** Returns k list lengths, each at least 1, that sum to n */
+static vector<size_t>
+drawListLengths (size_t n, size_t k, list_lengths_t lengths)
+{
+  vector<size_t> Len (k, 1);
+  const size_t extra = n - k; // nodes beyond one per list
+  if (lengths == LENGTHS_EQUAL) {
+    for (size_t j = 0; j < k; ++j)
+      Len[j] += extra / k + (j < extra % k);
+  } else if (lengths == LENGTHS_RANDOM) {
+    vector<size_t> Cut (k + 1);
+    Cut[0] = 0;
+    Cut[k] = extra;
+    for (size_t j = 1; j < k; ++j)
+      Cut[j] = (size_t)(drand48 () * (extra + 1));
+    sort (Cut.begin (), Cut.end ());
+    for (size_t j = 0; j < k; ++j)
+      Len[j] += Cut[j+1] - Cut[j];
+  } else {
+    double total = 0;
+    for (size_t j = 0; j < k; ++j)
+      total += 1.0 / (j + 1);
+    size_t used = 0;
+    for (size_t j = 0; j < k; ++j) {
+      const size_t more = (size_t)(extra / total / (j + 1));
+      Len[j] += more;
+      used += more;
+    }
+    Len[0] += extra - used; // the rounding
+  }
+  return Len;
+}
+
+index_t *
+createRandomForest (size_t n, size_t k, list_lengths_t lengths)
+{
+  assert (k >= 1 && k <= n);
+  const vector<size_t> Len = drawListLengths (n, k, lengths);
+
+  // Lay the lists end to end in a random order of the nodes
   index_t* AddrMap = new index_t[n]; assert (AddrMap);
   for (size_t i = 0; i < n; ++i)
     AddrMap[i] = i;
-  shuffle (n-1, AddrMap+1);
+  shuffle (n, AddrMap);
 
-  // Create final list
-  index_t* Next = new index_t[n]; assert (Next);
-  for (size_t i = 0; i < n; ++i)
-    Next[AddrMap[i]] = Init[i] > 0 ? AddrMap[Init[i]] : NIL;
+  index_t* Next = (index_t *)allocPages (n * sizeof (index_t), getDefaultPageKind ());
+  assert (Next);
+  size_t i = 0;
+  for (size_t j = 0; j < k; ++j)
+    for (size_t r = 0; r < Len[j]; ++r, ++i)
+      Next[AddrMap[i]] = (r + 1 < Len[j]) ? AddrMap[i+1] : NIL;
+  assert (i == n);
 
   delete[] AddrMap;
-  delete[] Init;
   return Next;
 }
 
@@ -14,17 +14,59 @@ typedef long index_t; //!< Node 'address': -1 (NIL), 0, 1, 2, 3, ...
 
 #define NIL -1 //!< Index equivalent of a NULL pointer
 
-/** Returns a newly allocated copy of an array */
+/**
+ *  Returns a newly allocated copy of an array. This and
+ *  createRandomList() allocate on pages of the default kind; see
+ *  'hugepages.h'.
+ */
 index_t* duplicate (size_t n, const index_t* A);
 
 /**
  *  Allocates a pool of 'next' pointers, and initializes into a single
  *  random linked list. The head is the first element ('next[0]') and
  *  the tail is the element whose next pointer is -1 (i.e., the
- *  element 'k' such that 'next[k] == NIL').
+ *  element 'k' such that 'next[k] == NIL'). Same as
+ *  createClusteredList (n, 1).
  */
 index_t* createRandomList (size_t n);
 
+/**
+ *  Like createRandomList(), but with the locality of the layout set
+ *  by 'block': the list runs through 'block' consecutive nodes at a
+ *  time, and the runs come in random order. A block of 1 gives a
+ *  fully random list, and one of n (or more), the sequential list
+ *  0, 1, ..., n-1; in between, each step of the list stays within a
+ *  run but for one jump in every 'block'. The node order is a
+ *  pseudo-random permutation computed independently for each node,
+ *  so the list is built in parallel, in one pass over the pool.
+ */
+index_t* createClusteredList (size_t n, size_t block);
+
+/** Distributions of list lengths for createRandomForest() */
+enum list_lengths_t
+{
+  LENGTHS_EQUAL,   //!< All n/k nodes long
+  LENGTHS_RANDOM,  //!< Cut at k-1 uniformly random places
+  LENGTHS_ZIPF     //!< List j has ~1/(j+1) of the nodes: a few long, many short
+};
+
+/** Returns the distribution named "equal", "random", or "zipf", or -1. */
+int getListLengths (const char* name);
+
+/** Returns the name of a distribution */
+const char* getListLengthsName (list_lengths_t lengths);
+
+/**
+ *  Allocates a pool of n 'next' pointers, and initializes it into a
+ *  forest of k random linked lists (1 <= k <= n) whose lengths follow
+ *  'lengths'. The heads are wherever they land: the nodes that are
+ *  no other node's next.
+ */
+index_t* createRandomForest (size_t n, size_t k, list_lengths_t lengths);
+
+/** Returns new space for 'n' indices, e.g., a list pool to fill in. */
+index_t* createListBuffer (size_t n);
+
 /** Frees list array pool. */
 void releaseListBuffer (index_t* Next);
 
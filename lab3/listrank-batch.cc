@@ -0,0 +1,26 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file listrank-batch.cc
+ *  \brief Implements computeListRanksBatch__par() of 'listrank-par.hh'
+ *  with the rest of that interface, for any backend.
+ */
+
+#include <cassert>
+
+#include "listrank-par.hh"
+
+void
+computeListRanksBatch__par (ParRankedList_t* L, size_t k, const size_t* n,
+                            const index_t* const* Next, rank_t* const* Rank)
+{
+  assert (L || !k);
+  for (size_t j = 0; j < k; ++j) {
+    resetRanks__par (L, n[j], Next[j], Rank[j]);
+    computeListRanks__par (L);
+    // Backends that rank elsewhere (e.g., in {next, rank} nodes)
+    // copy the ranks to Rank[j] here
+    getRanks__par (L);
+  }
+}
+
+// eof
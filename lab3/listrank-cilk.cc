@@ -3,15 +3,34 @@
  *  \file listrank-cilk.cc
  *
  *  \brief Implement the 'listrank-par.hh' interface using Cilk Plus.
+ *
+ *  The pointer-jumping passes read a node's successor's next pointer
+ *  and rank at random. With the default "packed" layout, a node is a
+ *  {next, rank} pair, so one cache line brings both; the "split"
+ *  layout keeps them in separate arrays, as two random accesses. Both
+ *  hold 32-bit indices and ranks when n < 2^32 (else 64-bit), which
+ *  halves the footprint. Select them with the environment variables
+ *
+ *    LISTRANK_NODES=packed|split
+ *    LISTRANK_INDEX=32|64
+ *
+ *  The ranks are copied out to a 'rank_t' array by getRanks__par().
+ *  The buffers persist across resetRanks__par(), and the first
+ *  pointer-jumping pass reads 'Next' itself, so nothing is
+ *  initialized beforehand.
  */
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 
+#include <stdint.h>
+
 #include <algorithm>
 #include <iostream>
 
+#include "hugepages.h"
 #include "listrank-par.hh"
 
 using namespace std;
@@ -25,115 +44,234 @@ getImplName__par (void)
 
 // ============================================================
 
+/** {next, rank} pairs, in one array */
+template <typename word_t>
+struct PackedNodes_t
+{
+  typedef word_t value_t;
+  struct Node_t { word_t next; word_t rank; };
+  Node_t* A;
+
+  PackedNodes_t (void* buf, size_t n) : A ((Node_t *)buf) { (void)n; }
+  word_t next (size_t i) const { return A[i].next; }
+  word_t rank (size_t i) const { return A[i].rank; }
+  void set (size_t i, word_t next, word_t rank) { A[i].next = next; A[i].rank = rank; }
+};
+
+/** Next pointers, then ranks, in two halves of one buffer */
+template <typename word_t>
+struct SplitNodes_t
+{
+  typedef word_t value_t;
+  word_t* N;
+  word_t* R;
+
+  SplitNodes_t (void* buf, size_t n) : N ((word_t *)buf), R ((word_t *)buf + n) {}
+  word_t next (size_t i) const { return N[i]; }
+  word_t rank (size_t i) const { return R[i]; }
+  void set (size_t i, word_t next, word_t rank) { N[i] = next; R[i] = rank; }
+};
+
+enum node_layout_t { NODES_PACKED, NODES_SPLIT };
+
 struct ParRankedList_t__
 {
   size_t n;
   const index_t* Next;
-  index_t* N[2]; 
-  const rank_t* Rank;
-  rank_t* R[2];
+  node_layout_t layout;
+  size_t word_size;  //!< Of an index or a rank: 4 or 8 bytes
+  void* Nodes[2];    //!< Current and next nodes of pointer jumping
+  int cur;           //!< Which of Nodes[] holds the ranks
+  rank_t* Rank;      //!< The ranks, copied out of the nodes
+  rank_t* Rank_own;  //!< L's own 'Rank', when the caller gives none
 };
 
 // ============================================================
 
+/** Returns the layout that LISTRANK_NODES selects */
+static node_layout_t
+getNodeLayout (void)
+{
+  const char* s = getenv ("LISTRANK_NODES");
+  if (!s || !*s || !strcmp (s, "packed"))
+    return NODES_PACKED;
+  if (!strcmp (s, "split"))
+    return NODES_SPLIT;
+  cerr << "*** Unknown LISTRANK_NODES='" << s << "'; use packed or split. ***" << endl;
+  assert (false);
+  return NODES_PACKED;
+}
+
+/** Returns the index width for n nodes: 4 bytes if they fit, unless LISTRANK_INDEX=64 */
+static size_t
+getWordSize (size_t n)
+{
+  const char* s = getenv ("LISTRANK_INDEX");
+  const bool fits = n < (size_t)UINT32_MAX; // UINT32_MAX is NIL
+  if (s && *s) {
+    const int bits = atoi (s);
+    assert (bits == 32 || bits == 64);
+    if (bits == 64 || !fits) {
+      if (bits == 32)
+        cerr << "(LISTRANK_INDEX=32: n is too large; using 64-bit indices)" << endl;
+      return sizeof (uint64_t);
+    }
+  }
+  return fits ? sizeof (uint32_t) : sizeof (uint64_t);
+}
+
 ParRankedList_t *
 setupRanks__par (size_t n, const index_t* Next)
 {
   ParRankedList_t* L = new ParRankedList_t;
   assert (L);
 
-  L->n = n;
+  L->layout = getNodeLayout ();
+  L->Nodes[0] = L->Nodes[1] = NULL;
+  L->Rank_own = NULL;
+  resetRanks__par (L, n, Next, NULL);
 
+  return L;
+}
+
+void
+resetRanks__par (ParRankedList_t* L, size_t n, const index_t* Next, rank_t* Rank)
+{
+  assert (L);
+  L->n = n;
   L->Next = Next;
-  L->N[0] = duplicate (n, Next);
-  L->N[1] = new index_t[n]; assert (L->N[1]);
+  L->word_size = getWordSize (n);
 
+  const page_kind_t kind = getDefaultPageKind ();
   for (size_t i = 0; i < 2; ++i) {
-    L->R[i] = createRanksBuffer (n);
+    L->Nodes[i] = growPages (L->Nodes[i], n * 2 * L->word_size, kind);
+    assert (L->Nodes[i]);
+  }
+  L->cur = 0;
+  if (Rank)
+    L->Rank = Rank;
+  else {
+    L->Rank_own = (rank_t *)growPages (L->Rank_own, n * sizeof (rank_t), kind);
+    assert (L->Rank_own);
+    L->Rank = L->Rank_own;
   }
-
-  L->Rank = L->R[0];
-
-  return L;
 }
 
 void releaseRanks__par (ParRankedList_t* L)
 {
   if (L) {
-    for (size_t i = 0; i < 2; ++i) { 
-      releaseRanksBuffer (L->R[i]);
-      releaseListBuffer (L->N[i]);
-    }
+    for (size_t i = 0; i < 2; ++i)
+      freePages (L->Nodes[i]);
+    releaseRanksBuffer (L->Rank_own);
 
-    L->Rank = NULL;
+    L->Rank = L->Rank_own = NULL;
     L->Next = NULL;
+    delete L;
   }
 }
 
+size_t
+getNodeSize__par (const ParRankedList_t* L)
+{
+  return 2 * L->word_size;
+}
+
 // ============================================================
 
+template <class nodes_t>
+static void
+copyRanks (size_t n, void* buf, rank_t* Rank)
+{
+  nodes_t nodes (buf, n);
+  _Cilk_for (size_t i = 0; i < n; ++i) {
+    Rank[i] = nodes.rank (i);
+  }
+}
+
 const rank_t *
 getRanks__par (const ParRankedList_t* L)
 {
+  const size_t n = L->n;
+  void* buf = L->Nodes[L->cur];
+  if (n) {
+    if (L->word_size == sizeof (uint32_t)) {
+      if (L->layout == NODES_PACKED) copyRanks<PackedNodes_t<uint32_t> > (n, buf, L->Rank);
+      else                           copyRanks<SplitNodes_t<uint32_t> > (n, buf, L->Rank);
+    } else {
+      if (L->layout == NODES_PACKED) copyRanks<PackedNodes_t<uint64_t> > (n, buf, L->Rank);
+      else                           copyRanks<SplitNodes_t<uint64_t> > (n, buf, L->Rank);
+    }
+  }
   return L->Rank;
 }
 
-template <class pointer_t>
-static void
-swapPointers (pointer_t* &ptr1, pointer_t* &ptr2)
-{
-  pointer_t* ptrTemp = ptr1;
-  ptr1 = ptr2;
-  ptr2 = ptrTemp;
-}
 // ============================================================
 
-static void
-computeListRanks__cilk__ (ParRankedList_t* L)
+/**
+ *  Wyllie's pointer jumping over nodes of type 'nodes_t'; returns
+ *  which buffer holds the ranks.
+ */
+template <class nodes_t>
+static int
+computeListRanks__cilk__ (size_t n, const index_t* Next, void* buf[2])
 {
-  size_t n = L->n;
-  if (n == 0) return; // empty pool
-  assert (L->Next);
-  assert (L->Rank);
+  typedef typename nodes_t::value_t word_t;
+  const word_t nil = (word_t)NIL; // all ones
 
-  index_t* N_cur = L->N[0];
-  index_t* N_next = L->N[1];
+  nodes_t cur (buf[0], n);
+  nodes_t next (buf[1], n);
 
-  rank_t* R_cur = L->R[0];
-  rank_t* R_next = L->R[1];
-
-  // Initial values on which we will perform the list-based 'scan' /
-  // 'prefix sum'
+  // The first jump, from the initial values on which we will perform
+  // the list-based 'scan' / 'prefix sum' (a rank of 1, or 0 at the
+  // tail), read straight from 'Next'. It is also the first touch of
+  // the nodes.
   _Cilk_for (size_t i = 0; i < n; ++i) {
-    R_cur[i] = (N_cur[i] == NIL) ? 0 : 1;
+    const index_t succ = Next[i];
+    if (succ != NIL) {
+      const index_t succ2 = Next[succ];
+      cur.set (i, (word_t)succ2, (succ2 == NIL) ? 1 : 2);
+    } else
+      cur.set (i, nil, 0);
   }
 
-  size_t maxIterations = static_cast<size_t>(ceil(log2(static_cast<double>(n)))); 
+  // Jumping past the tail changes nothing, so n = 1 may jump once too
+  size_t maxIterations = static_cast<size_t>(ceil(log2(static_cast<double>(n))));
+  maxIterations = max (maxIterations, (size_t)1);
 
-  for (size_t j = 0; j < maxIterations; ++j) {
+  for (size_t j = 1; j < maxIterations; ++j) {
     _Cilk_for (size_t i = 0; i < n; ++i) {
-      if (N_cur[i] != NIL) {
-        R_next[i] = R_cur[i] + R_cur[N_cur[i]]; 
-        N_next[i] = N_cur[N_cur[i]];
-      }
-      else {
-        R_next[i] = R_cur[i];
-        N_next[i] = NIL;
-      }
+      const word_t succ = cur.next (i);
+      if (succ != nil)
+        next.set (i, cur.next (succ), cur.rank (i) + cur.rank (succ));
+      else
+        next.set (i, nil, cur.rank (i));
     }
 
-    swapPointers<index_t> (N_cur, N_next);
-    swapPointers<rank_t> (R_cur, R_next);
+    swap (cur, next);
   }
 
-  L->Rank = R_cur;
+  return (maxIterations - 1) % 2;
 }
 
 void
 computeListRanks__par (ParRankedList_t* L)
 {
   assert (L != NULL);
-  computeListRanks__cilk__ (L);
+  const size_t n = L->n;
+  if (n == 0) return; // empty pool
+  assert (L->Next);
+
+  if (L->word_size == sizeof (uint32_t)) {
+    if (L->layout == NODES_PACKED)
+      L->cur = computeListRanks__cilk__<PackedNodes_t<uint32_t> > (n, L->Next, L->Nodes);
+    else
+      L->cur = computeListRanks__cilk__<SplitNodes_t<uint32_t> > (n, L->Next, L->Nodes);
+  } else {
+    if (L->layout == NODES_PACKED)
+      L->cur = computeListRanks__cilk__<PackedNodes_t<uint64_t> > (n, L->Next, L->Nodes);
+    else
+      L->cur = computeListRanks__cilk__<SplitNodes_t<uint64_t> > (n, L->Next, L->Nodes);
+  }
 }
 
 // eof
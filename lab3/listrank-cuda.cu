@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <iostream>
 
+#include "hugepages.h"
 #include "listrank-par.hh"
 
 #include "cuda_utils.h"
@@ -32,10 +33,12 @@ getImplName__par (void)
 struct ParRankedList_t__
 {
   size_t n;
+  size_t capacity;  //!< Nodes the device buffers hold
 
   // Buffers on the host (i.e., CPU)
   const index_t* Next_host;
   rank_t* Rank_host;
+  rank_t* Rank_host_own;  //!< L's own 'Rank_host', when the caller gives none
 
   // Buffers on the device (i.e., GPU)
   index_t* Next_device[2];
@@ -50,28 +53,52 @@ setupRanks__par (size_t n, const index_t* Next)
   ParRankedList_t* L = new ParRankedList_t;
   assert (L);
 
+  L->capacity = 0;
+  L->Rank_host = L->Rank_host_own = NULL;
+  for (size_t i = 0; i < 2; ++i) {
+    L->Next_device[i] = NULL;
+    L->Rank_device[i] = NULL;
+  }
+  resetRanks__par (L, n, Next, NULL);
+  return L;
+}
+
+void
+resetRanks__par (ParRankedList_t* L, size_t n, const index_t* Next, rank_t* Rank)
+{
+  assert (L);
   L->n = n;
   L->Next_host = Next;
-  L->Rank_host = createRanksBuffer (n);
-
-  // Create buffers on the GPU:
-  for (size_t i = 0; i < 2; ++i) {
-    CUDA_CHECK_ERROR (cudaMalloc (&(L->Next_device[i]), n * sizeof (index_t)));
-    CUDA_CHECK_ERROR (cudaMalloc (&(L->Rank_device[i]), n * sizeof (rank_t)));
+  if (Rank)
+    L->Rank_host = Rank;
+  else {
+    L->Rank_host_own = (rank_t *)growPages (L->Rank_host_own, n * sizeof (rank_t),
+                                            getDefaultPageKind ());
+    assert (L->Rank_host_own);
+    L->Rank_host = L->Rank_host_own;
   }
 
+  // (Re)create buffers on the GPU, at least doubling, as growPages() does:
+  if (n > L->capacity) {
+    L->capacity = max (n, 2 * L->capacity);
+    for (size_t i = 0; i < 2; ++i) {
+      CUDA_CHECK_ERROR (cudaFree (L->Next_device[i]));
+      CUDA_CHECK_ERROR (cudaFree (L->Rank_device[i]));
+      CUDA_CHECK_ERROR (cudaMalloc (&(L->Next_device[i]), L->capacity * sizeof (index_t)));
+      CUDA_CHECK_ERROR (cudaMalloc (&(L->Rank_device[i]), L->capacity * sizeof (rank_t)));
+    }
+  }
 
   // Copy CPU buffer contents to the GPU:
   CUDA_CHECK_ERROR (cudaMemcpy (L->Next_device[0], L->Next_host,
                                 n * sizeof (index_t),
                                 cudaMemcpyHostToDevice));
-  return L;
 }
 
 void releaseRanks__par (ParRankedList_t* L)
 {
   if (L) {
-    releaseRanksBuffer (L->Rank_host);
+    releaseRanksBuffer (L->Rank_host_own);
 
     // Free GPU buffers:
     for (size_t i = 0; i < 2; ++i) {
@@ -79,10 +106,17 @@ void releaseRanks__par (ParRankedList_t* L)
       CUDA_CHECK_ERROR (cudaFree (L->Rank_device[i]));
     }
     L->Next_host = NULL;
-    L->Rank_host = NULL;
+    L->Rank_host = L->Rank_host_own = NULL;
   }
 }
 
+size_t
+getNodeSize__par (const ParRankedList_t* L)
+{
+  (void)L;
+  return sizeof (index_t) + sizeof (rank_t);
+}
+
 // ============================================================
 
 const rank_t *
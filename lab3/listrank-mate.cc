@@ -0,0 +1,315 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file listrank-mate.cc
+ *
+ *  \brief Implement the 'listrank-par.hh' interface by random-mate
+ *  contraction, using Cilk Plus.
+ *
+ *  Each node i carries a weight, W[i], the number of links from i to
+ *  its current successor (1, or 0 at the tail), so that its rank is
+ *  the sum of the weights from i to the tail. Each round,
+ *
+ *    - every live node flips a coin, and a node that flips heads while
+ *      its predecessor flips tails is removed: no two removed nodes
+ *      are adjacent, and about a quarter of the nodes go;
+ *    - each removed node i is spliced out, its weight added to its
+ *      predecessor's; and
+ *    - the live nodes are compacted, so the next round costs less.
+ *
+ *  Once few enough nodes are left, they are ranked sequentially.
+ *  Then the rounds are undone in reverse: a node removed with
+ *  successor s gets rank W[i] + Rank[s], s having been ranked
+ *  already. The work is O(n) in expectation, in O(log n) rounds.
+ *
+ *  The weights live in the rank buffer, which each node overwrites
+ *  with its rank when it is re-inserted.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <cilk/cilk_api.h>
+
+#include "hugepages.h"
+#include "listrank-par.hh"
+
+using namespace std;
+
+/** Rank sequentially once this few nodes are left */
+#if !defined (MATE_CUTOFF)
+#  define MATE_CUTOFF 8192
+#endif
+
+/** Blocks per Cilk worker in the compaction passes */
+#define BLOCKS_PER_WORKER 8
+
+// ============================================================
+const char *
+getImplName__par (void)
+{
+  return "MATE";
+}
+
+// ============================================================
+
+struct ParRankedList_t__
+{
+  size_t n;
+  const index_t* Next;
+  index_t* N;       //!< Successors, as the list contracts
+  index_t* P;       //!< Predecessors, NIL at the head
+  index_t* Live[2]; //!< Nodes still in the list, before and after a round
+  index_t* Removed; //!< Nodes removed, round by round
+  rank_t* Rank;     //!< Weights, then ranks
+  rank_t* Rank_own; //!< L's own 'Rank', when the caller gives none
+  size_t n_blocks;
+  size_t* Count;    //!< Per block: nodes kept, nodes removed
+};
+
+// ============================================================
+
+/** Returns A, or a larger buffer in its place, for n indices; see growPages() */
+static index_t *
+growIndexBuffer (index_t* A, size_t n)
+{
+  A = (index_t *)growPages (A, n * sizeof (index_t), getDefaultPageKind ());
+  assert (A);
+  return A;
+}
+
+ParRankedList_t *
+setupRanks__par (size_t n, const index_t* Next)
+{
+  ParRankedList_t* L = new ParRankedList_t;
+  assert (L);
+
+  L->N = L->P = L->Removed = NULL;
+  L->Live[0] = L->Live[1] = NULL;
+  L->Rank_own = NULL;
+  L->n_blocks = (size_t)__cilkrts_get_nworkers () * BLOCKS_PER_WORKER;
+  L->Count = new size_t[2 * L->n_blocks]; assert (L->Count);
+  resetRanks__par (L, n, Next, NULL);
+
+  return L;
+}
+
+void
+resetRanks__par (ParRankedList_t* L, size_t n, const index_t* Next, rank_t* Rank)
+{
+  assert (L);
+  L->n = n;
+  L->Next = Next;
+  L->N = growIndexBuffer (L->N, n);
+  L->P = growIndexBuffer (L->P, n);
+  for (size_t k = 0; k < 2; ++k)
+    L->Live[k] = growIndexBuffer (L->Live[k], n);
+  L->Removed = growIndexBuffer (L->Removed, n);
+  if (Rank)
+    L->Rank = Rank;
+  else {
+    L->Rank_own = (rank_t *)growPages (L->Rank_own, n * sizeof (rank_t), getDefaultPageKind ());
+    assert (L->Rank_own);
+    L->Rank = L->Rank_own;
+  }
+}
+
+void releaseRanks__par (ParRankedList_t* L)
+{
+  if (L) {
+    freePages (L->N);
+    freePages (L->P);
+    for (size_t k = 0; k < 2; ++k)
+      freePages (L->Live[k]);
+    freePages (L->Removed);
+    releaseRanksBuffer (L->Rank_own);
+    delete[] L->Count;
+    L->Rank = L->Rank_own = NULL;
+    L->Next = NULL;
+    delete L;
+  }
+}
+
+size_t
+getNodeSize__par (const ParRankedList_t* L)
+{
+  (void)L;
+  return sizeof (index_t) + sizeof (rank_t);
+}
+
+// ============================================================
+
+const rank_t *
+getRanks__par (const ParRankedList_t* L)
+{
+  return L->Rank;
+}
+
+// ============================================================
+
+/** Returns node i's coin in round 'round': a hash (splitmix64) bit */
+static inline bool
+flipCoin (index_t i, size_t round)
+{
+  unsigned long long x = (unsigned long long)i + 0x9E3779B97F4A7C15ull * (round + 1);
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  x ^= x >> 31;
+  return x & 1;
+}
+
+/** Whether live node i leaves the list in round 'round' */
+static inline bool
+isRemoved (const index_t* P, index_t i, size_t round)
+{
+  return P[i] != NIL && flipCoin (i, round) && !flipCoin (P[i], round);
+}
+
+/**
+ *  Ranks the m live nodes sequentially, given their weights in Rank,
+ *  by two walks from the head.
+ */
+static void
+rankLive (size_t m, const index_t* Live, const index_t* N, const index_t* P,
+          rank_t* Rank)
+{
+  index_t head = NIL;
+  for (size_t k = 0; k < m && head == NIL; ++k)
+    if (P[Live[k]] == NIL)
+      head = Live[k];
+  assert (head != NIL);
+
+  rank_t total = 0;
+  for (index_t cur = head; cur != NIL; cur = N[cur])
+    total += Rank[cur];
+  for (index_t cur = head; cur != NIL; cur = N[cur]) {
+    const rank_t w = Rank[cur];
+    Rank[cur] = total;
+    total -= w;
+  }
+}
+
+static void
+computeListRanks__mate__ (ParRankedList_t* L)
+{
+  const size_t n = L->n;
+  if (n == 0) return; // empty pool
+  const index_t* Next = L->Next;
+  assert (Next && L->Rank);
+
+  index_t* N = L->N;
+  index_t* P = L->P;
+  index_t* Live = L->Live[0];
+  index_t* Kept = L->Live[1];
+  index_t* Removed = L->Removed;
+  rank_t* Rank = L->Rank;
+  size_t* Count = L->Count;
+  const size_t n_blocks = L->n_blocks;
+
+  // Every node but the head is the successor of just one node, so
+  // this sets all of P but P[head]. The head is the one node that is
+  // no node's next: the sum of the nodes less the sum of the nexts,
+  // which each block adds up in Count (modulo 2^64, which is exact).
+  const size_t init_block = (n + n_blocks - 1) / n_blocks;
+  _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+    const size_t i_max = min (n, (b + 1) * init_block);
+    size_t sum = 0;
+    for (size_t i = b * init_block; i < i_max; ++i) {
+      const index_t next = Next[i];
+      N[i] = next;
+      Rank[i] = (next == NIL) ? 0 : 1;
+      Live[i] = i;
+      sum += i;
+      if (next != NIL) {
+        P[next] = i;
+        sum -= next;
+      }
+    }
+    Count[b] = sum;
+  }
+  size_t head = 0;
+  for (size_t b = 0; b < n_blocks; ++b)
+    head += Count[b];
+  assert (head < n);
+  P[head] = NIL;
+
+  // Contract: Removed[Start[r]:Start[r+1]-1] are the nodes of round r
+  vector<size_t> Start (1, 0);
+  size_t m = n;
+  for (size_t round = 0; m > MATE_CUTOFF; ++round) {
+    const size_t block = (m + n_blocks - 1) / n_blocks;
+
+    // Count the nodes that stay and go, per block...
+    _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+      const size_t k_max = min (m, (b + 1) * block);
+      size_t n_removed = 0;
+      for (size_t k = b * block; k < k_max; ++k)
+        n_removed += isRemoved (P, Live[k], round);
+      Count[2*b] = (k_max > b * block) ? (k_max - b * block - n_removed) : 0;
+      Count[2*b+1] = n_removed;
+    }
+
+    // ... turn the counts into offsets...
+    size_t n_kept = 0, n_removed = Start.back ();
+    for (size_t b = 0; b < n_blocks; ++b) {
+      const size_t kept_b = Count[2*b], removed_b = Count[2*b+1];
+      Count[2*b] = n_kept;
+      Count[2*b+1] = n_removed;
+      n_kept += kept_b;
+      n_removed += removed_b;
+    }
+
+    // ... and split them
+    _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+      const size_t k_max = min (m, (b + 1) * block);
+      size_t kept = Count[2*b], removed = Count[2*b+1];
+      for (size_t k = b * block; k < k_max; ++k) {
+        const index_t i = Live[k];
+        if (isRemoved (P, i, round))
+          Removed[removed++] = i;
+        else
+          Kept[kept++] = i;
+      }
+    }
+
+    // Splice out the removed nodes. Neither neighbor of a removed
+    // node is removed, so no two splices touch the same node.
+    _Cilk_for (size_t k = Start.back (); k < n_removed; ++k) {
+      const index_t i = Removed[k];
+      const index_t p = P[i], s = N[i];
+      N[p] = s;
+      Rank[p] += Rank[i];
+      if (s != NIL)
+        P[s] = p;
+    }
+
+    Start.push_back (n_removed);
+    swap (Live, Kept);
+    m = n_kept;
+  }
+
+  rankLive (m, Live, N, P, Rank);
+
+  // Re-insert, last round first. N[i] is still i's successor when it
+  // was removed, which was ranked in a later round.
+  for (size_t r = Start.size () - 1; r > 0; --r) {
+    _Cilk_for (size_t k = Start[r-1]; k < Start[r]; ++k) {
+      const index_t i = Removed[k];
+      if (N[i] != NIL)
+        Rank[i] += Rank[N[i]];
+    }
+  }
+}
+
+void
+computeListRanks__par (ParRankedList_t* L)
+{
+  assert (L != NULL);
+  computeListRanks__mate__ (L);
+}
+
+// eof
@@ -25,6 +25,29 @@ extern "C" {
   /** Returns a new data structure for testing computeListRanks__par(). */
   ParRankedList_t* setupRanks__par (size_t n, const index_t* Next);
 
+  /**
+   *  Points L at another list, of n nodes, whose ranks are to go to
+   *  'Rank' (space for n), or to a buffer of L's own if it is NULL;
+   *  getRanks__par(L) returns them either way. Reuses L's buffers:
+   *  they are reallocated only when too small, and then at least
+   *  double (see growPages() in 'hugepages.h'), so a run of lists of
+   *  similar sizes allocates once or twice. The Cilk backends
+   *  initialize nothing here: the first pass of
+   *  computeListRanks__par() does, in parallel, which also places new
+   *  pages near the threads that use them.
+   *
+   *  \note Ranks that getRanks__par(L) returned in L's own buffer are
+   *  lost.
+   */
+  void resetRanks__par (ParRankedList_t* L, size_t n, const index_t* Next,
+                        rank_t* Rank);
+
+  /**
+   *  Returns the bytes the ranker keeps per node, e.g., an index and
+   *  a rank, for estimating its bandwidth.
+   */
+  size_t getNodeSize__par (const ParRankedList_t* L);
+
   /** A parallel implementation of computeListRanks(); see 'listrank.hh' */
   void computeListRanks__par (ParRankedList_t* L);
 
@@ -39,6 +62,15 @@ extern "C" {
    */
   void releaseRanks__par (ParRankedList_t* L);
 
+  /**
+   *  Ranks k lists back to back in L, reusing its buffers (see
+   *  resetRanks__par()): list j is the pool 'Next[j]' of 'n[j]' nodes,
+   *  and its ranks go straight to 'Rank[j]'. L is left on the last
+   *  list.
+   */
+  void computeListRanksBatch__par (ParRankedList_t* L, size_t k, const size_t* n,
+                                   const index_t* const* Next, rank_t* const* Rank);
+
 #if defined (__cplusplus)
 } // extern "C"
 #endif
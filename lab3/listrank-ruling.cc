@@ -0,0 +1,157 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file listrank-ruling.cc
+ *
+ *  \brief Implement the 'listrank-par.hh' interface with a sparse
+ *  ruling set (Helman and JaJa), using Cilk Plus.
+ *
+ *  Ranking is the backward exclusive scan of ones under '+', so this
+ *  is listScan__par(); see 'listscan-par.hh' for the algorithm. It
+ *  does O(n) work, versus O(n log n) for pointer jumping.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <iostream>
+
+#include <cilk/cilk_api.h>
+
+#include "hugepages.h"
+#include "listrank-par.hh"
+#include "listscan-par.hh"
+
+using namespace std;
+
+// ============================================================
+const char *
+getImplName__par (void)
+{
+  return "RULING";
+}
+
+// ============================================================
+
+struct ParRankedList_t__
+{
+  size_t n;
+  const index_t* Next;
+  rank_t* Rank;
+  rank_t* Rank_own; //!< L's own 'Rank', when the caller gives none
+  listscan_par::word_t* IsRuler; //!< Bitmap for listScan__par(); all clear
+};
+
+// ============================================================
+
+ParRankedList_t *
+setupRanks__par (size_t n, const index_t* Next)
+{
+  ParRankedList_t* L = new ParRankedList_t;
+  assert (L);
+
+  L->Rank_own = NULL;
+  L->IsRuler = NULL;
+  resetRanks__par (L, n, Next, NULL);
+
+  return L;
+}
+
+void
+resetRanks__par (ParRankedList_t* L, size_t n, const index_t* Next, rank_t* Rank)
+{
+  assert (L);
+  L->n = n;
+  L->Next = Next;
+
+  const page_kind_t kind = getDefaultPageKind ();
+  if (Rank)
+    L->Rank = Rank;
+  else {
+    L->Rank_own = (rank_t *)growPages (L->Rank_own, n * sizeof (rank_t), kind);
+    assert (L->Rank_own);
+    L->Rank = L->Rank_own;
+  }
+
+  // New pages come zeroed, and listScan__par() leaves the bitmap
+  // clear, so it needs no clearing here
+  const size_t n_words = (n + listscan_par::WORD_BITS - 1) / listscan_par::WORD_BITS;
+  L->IsRuler = (listscan_par::word_t *)growPages (L->IsRuler,
+                                                  n_words * sizeof (listscan_par::word_t),
+                                                  kind);
+  assert (L->IsRuler);
+}
+
+void releaseRanks__par (ParRankedList_t* L)
+{
+  if (L) {
+    releaseRanksBuffer (L->Rank_own);
+    freePages (L->IsRuler);
+    L->Rank = L->Rank_own = NULL;
+    L->Next = NULL;
+    delete L;
+  }
+}
+
+size_t
+getNodeSize__par (const ParRankedList_t* L)
+{
+  (void)L;
+  return sizeof (index_t) + sizeof (rank_t);
+}
+
+// ============================================================
+
+const rank_t *
+getRanks__par (const ParRankedList_t* L)
+{
+  return L->Rank;
+}
+
+// ============================================================
+
+/**
+ *  Returns the head of a list that uses every node of the pool: every
+ *  node but the head is the successor of exactly one node, so the
+ *  head is the sum of all indices less the sum of the successors
+ *  (exact, in modular arithmetic). Unlike marking the predecessors,
+ *  this reads 'Next' once, in order, and writes nothing.
+ */
+static index_t
+findHead (size_t n, const index_t* Next)
+{
+  const size_t n_blocks = (size_t)__cilkrts_get_nworkers () * 4;
+  const size_t block = (n + n_blocks - 1) / n_blocks;
+  size_t* Sum = new size_t[n_blocks]; assert (Sum);
+
+  _Cilk_for (size_t b = 0; b < n_blocks; ++b) {
+    const size_t i_max = min (n, (b + 1) * block);
+    size_t sum = 0;
+    for (size_t i = b * block; i < i_max; ++i)
+      sum += i - (Next[i] == NIL ? 0 : (size_t)Next[i]);
+    Sum[b] = sum;
+  }
+
+  size_t head = 0;
+  for (size_t b = 0; b < n_blocks; ++b)
+    head += Sum[b];
+  delete[] Sum;
+  assert (head < n);
+  return (index_t)head;
+}
+
+void
+computeListRanks__par (ParRankedList_t* L)
+{
+  assert (L != NULL);
+  const size_t n = L->n;
+  if (n == 0) return; // empty pool
+  assert (L->Next && L->Rank);
+
+  listScan__par (n, findHead (n, L->Next), L->Next,
+                 ScanOnes_t<rank_t> (), ScanPlus_t<rank_t> (), L->Rank,
+                 EXCLUSIVE_SCAN, BACKWARD_SCAN, L->IsRuler);
+}
+
+// eof
@@ -6,9 +6,13 @@
 
 #include <cassert>
 #include <strings.h> // for 'bzero'
+#include <xmmintrin.h> // for '_mm_prefetch'
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
+#include "hugepages.h"
 #include "listrank.hh"
 
 using namespace std;
@@ -20,7 +24,7 @@ createRanksBuffer (size_t n)
 {
   rank_t* Rank = NULL;
   if (n) {
-    Rank = new rank_t[n];
+    Rank = (rank_t *)allocPages (n * sizeof (rank_t), getDefaultPageKind ());
     assert (Rank);
     bzero (Rank, n * sizeof (rank_t));
   }
@@ -30,7 +34,7 @@ createRanksBuffer (size_t n)
 void
 releaseRanksBuffer (rank_t* Rank)
 {
-  if (Rank) delete[] Rank;
+  freePages (Rank);
 }
 
 /* ====================================================================== */
@@ -58,6 +62,205 @@ computeListRanks (index_t head, const index_t* Next, rank_t* Rank)
 
 /* ====================================================================== */
 
+size_t
+computeForestRanks (size_t n, const index_t* Next, index_t* ListId, rank_t* Rank)
+{
+  // Mark the heads: ListId[i] == i, until i is found to be a next
+  for (size_t i = 0; i < n; ++i)
+    ListId[i] = i;
+  for (size_t i = 0; i < n; ++i)
+    if (Next[i] != NIL)
+      ListId[Next[i]] = NIL;
+
+  // Rank each list as computeListRanks() does, labeling it too
+  size_t k = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const index_t head = i;
+    if (ListId[head] != head) continue;
+    ++k;
+    rank_t count = 0;
+    for (index_t cur = head; cur != NIL; cur = Next[cur])
+      ++count;
+    for (index_t cur = head; cur != NIL; cur = Next[cur]) {
+      Rank[cur] = --count;
+      ListId[cur] = head;
+    }
+  }
+  return k;
+}
+
+/* ====================================================================== */
+
+/** Pieces walked at once by computeListRanks__mlp() */
+#if !defined (MLP_CURSORS)
+#  define MLP_CURSORS 16
+#endif
+
+/** Mean length of a piece; see computeListRanks__mlp() */
+#define MLP_PIECE_LENGTH 1024
+
+#define NONE ((size_t)-1)
+
+/** One piece of the list, from its head up to the next piece's */
+struct Piece_t
+{
+  index_t head;
+  size_t length;
+  size_t next;  // successor piece, or NONE at the tail
+  rank_t rank;  // of the head
+};
+
+static bool
+lessHead (const Piece_t& a, const Piece_t& b)
+{
+  return a.head < b.head;
+}
+
+/** Returns the piece whose head is 'i' */
+static size_t
+findPiece (const vector<Piece_t>& Pieces, index_t i)
+{
+  Piece_t key;
+  key.head = i;
+  vector<Piece_t>::const_iterator p =
+    lower_bound (Pieces.begin (), Pieces.end (), key, lessHead);
+  assert (p != Pieces.end () && p->head == i);
+  return p - Pieces.begin ();
+}
+
+static inline void
+prefetch (const void* p)
+{
+  _mm_prefetch ((const char *)p, _MM_HINT_T0);
+}
+
+/** A walk along one piece */
+struct Cursor_t
+{
+  index_t node;
+  size_t piece;  // NONE once there are no pieces left to walk
+  size_t count;
+};
+
+void
+computeListRanks__mlp (size_t n, index_t head, const index_t* Next, rank_t* Rank)
+{
+  if (head == NIL) return; // empty list
+
+  const size_t s = n / MLP_PIECE_LENGTH;
+  if (s < MLP_CURSORS) {
+    computeListRanks (head, Next, Rank);
+    return;
+  }
+
+  // Cut the list at the head and s-1 other distinct random nodes,
+  // marked in a bitmap (n bits, so it mostly stays in cache).
+  typedef unsigned long word_t;
+  const size_t word_bits = 8 * sizeof (word_t);
+  vector<word_t> IsHead ((n + word_bits - 1) / word_bits, 0);
+  vector<Piece_t> Pieces (s);
+  unsigned long long state = 0x9E3779B97F4A7C15ull ^ n;
+  for (size_t j = 0; j < s; ++j) {
+    index_t i = head;
+    while (j && (IsHead[i / word_bits] >> (i % word_bits)) & 1) {
+      // xorshift64*, so as not to disturb the caller's lrand48() stream
+      state ^= state >> 12; state ^= state << 25; state ^= state >> 27;
+      i = (index_t)((state * 0x2545F4914F6CDD1Dull) % n);
+    }
+    Pieces[j].head = i;
+    IsHead[i / word_bits] |= (word_t)1 << (i % word_bits);
+  }
+  sort (Pieces.begin (), Pieces.end (), lessHead);
+
+  // Walk the pieces, MLP_CURSORS at a time, for their lengths. Each
+  // step of a cursor prefetches its next node, whose line then has
+  // the other cursors' steps to arrive.
+  Cursor_t C[MLP_CURSORS];
+  size_t j_next = 0;
+  for (size_t k = 0; k < MLP_CURSORS; ++k) {
+    C[k].piece = j_next++;
+    C[k].node = Pieces[C[k].piece].head;
+    C[k].count = 0;
+    prefetch (&Next[C[k].node]);
+  }
+  for (size_t active = MLP_CURSORS; active; ) {
+    for (size_t k = 0; k < MLP_CURSORS; ++k) {
+      Cursor_t& c = C[k];
+      if (c.piece == NONE) continue;
+      const index_t i = c.node;
+      if (c.count && (IsHead[i / word_bits] >> (i % word_bits)) & 1) {
+        // Reached the next piece
+        Pieces[c.piece].length = c.count;
+        Pieces[c.piece].next = findPiece (Pieces, i);
+      } else {
+        ++c.count;
+        const index_t next = Next[i];
+        if (next != NIL) {
+          c.node = next;
+          prefetch (&Next[next]);
+          prefetch (&IsHead[next / word_bits]);
+          continue;
+        }
+        Pieces[c.piece].length = c.count;
+        Pieces[c.piece].next = NONE;
+      }
+      // Start the next piece
+      if (j_next < s) {
+        c.piece = j_next++;
+        c.node = Pieces[c.piece].head;
+        c.count = 0;
+        prefetch (&Next[c.node]);
+      } else {
+        c.piece = NONE;
+        --active;
+      }
+    }
+  }
+
+  // Rank the heads of the pieces
+  const size_t j_head = findPiece (Pieces, head);
+  size_t total = 0;
+  for (size_t j = j_head; j != NONE; j = Pieces[j].next) {
+    total += Pieces[j].length;
+    Pieces[j].rank = total;
+  }
+  for (size_t j = j_head; j != NONE; j = Pieces[j].next)
+    Pieces[j].rank = total - Pieces[j].rank + Pieces[j].length - 1;
+
+  // Walk the pieces again, writing the ranks; now the lengths say
+  // where each piece ends.
+  j_next = 0;
+  for (size_t k = 0; k < MLP_CURSORS; ++k) {
+    C[k].piece = j_next++;
+    C[k].node = Pieces[C[k].piece].head;
+    C[k].count = Pieces[C[k].piece].length;
+    prefetch (&Next[C[k].node]);
+  }
+  for (size_t active = MLP_CURSORS; active; ) {
+    for (size_t k = 0; k < MLP_CURSORS; ++k) {
+      Cursor_t& c = C[k];
+      if (c.piece == NONE) continue;
+      const index_t i = c.node;
+      Rank[i] = Pieces[c.piece].rank - (Pieces[c.piece].length - c.count);
+      if (--c.count) {
+        c.node = Next[i];
+        prefetch (&Next[c.node]);
+        prefetch (&Rank[c.node]);
+      } else if (j_next < s) {
+        c.piece = j_next++;
+        c.node = Pieces[c.piece].head;
+        c.count = Pieces[c.piece].length;
+        prefetch (&Next[c.node]);
+      } else {
+        c.piece = NONE;
+        --active;
+      }
+    }
+  }
+}
+
+/* ====================================================================== */
+
 void printListRanks (const string& tag,
                      index_t head, const index_t* Next,
                      const rank_t* Rank,
@@ -11,7 +11,10 @@
 
 typedef unsigned long rank_t; //!< Rank value: 0, 1, 2, 3, ...
 
-/** Returns new space for storing ranks. */
+/**
+ *  Returns new space for storing ranks, on pages of the default kind;
+ *  see 'hugepages.h'.
+ */
 rank_t* createRanksBuffer (size_t n);
 
 /** Frees rank buffer space. */
@@ -26,6 +29,25 @@ void releaseRanksBuffer (rank_t* Rank);
  */
 void computeListRanks (index_t head, const index_t* Next, rank_t* Rank);
 
+/**
+ *  A faster sequential computeListRanks(), for a pool of 'n' nodes
+ *  holding the one list: it cuts the list at sampled nodes, and walks
+ *  MLP_CURSORS of the pieces at once, round-robin, prefetching each
+ *  cursor's next node, so that many cache misses are in flight
+ *  rather than one. The pieces' offsets are fixed up afterward.
+ */
+void computeListRanks__mlp (size_t n, index_t head, const index_t* Next,
+                            rank_t* Rank);
+
+/**
+ *  Ranks a forest: a pool of 'n' nodes holding any number of lists.
+ *  The heads are the nodes that are no other node's next. Computes
+ *  'Rank[i]', the distance from node i to the tail of its list, and
+ *  'ListId[i]', the head of its list; returns the number of lists.
+ */
+size_t computeForestRanks (size_t n, const index_t* Next,
+                           index_t* ListId, rank_t* Rank);
+
 /**
  *  (Debugging) Prints the contents of a ranked list, truncating the
  *  output after 'truncate' elements.
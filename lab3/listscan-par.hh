@@ -0,0 +1,269 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file listscan-par.hh
+ *  \brief Parallel list scans, by sparse ruling set (Helman and
+ *  JaJa), using Cilk Plus; see 'listscan.hh' for what a scan is.
+ *
+ *  listScan__par() picks s = (workers * RULERS_PER_WORKER) random
+ *  nodes, the "rulers", which cut the list into s sublists. It then
+ *
+ *    1. walks every sublist in parallel, from its ruler up to the
+ *       next ruler (or the tail), to find the sublist's length,
+ *       successor, and the combination of its values;
+ *    2. scans the list of s sublists sequentially, which gives the
+ *       value that each sublist's scan starts from; and
+ *    3. walks every sublist again, writing the scan of its nodes.
+ *
+ *  That is O(n) work in all -- two reads of 'Next' and one write of
+ *  the output -- versus O(n log n) for pointer jumping. Rulers are
+ *  marked in a bitmap (n bits), not in the output, so the walks of
+ *  step 1 only read. A backward scan under an operator with an exact
+ *  inverse (see ScanInverse_t) walks forward in step 3 too, taking
+ *  what is left of the sublist from its sum; any other backward scan
+ *  records each sublist's nodes, to write them tail-first.
+ */
+
+#if !defined (INC_LISTSCAN_PAR_HH)
+#define INC_LISTSCAN_PAR_HH //!< listscan-par.hh included
+
+#include <cassert>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include <cilk/cilk_api.h>
+
+#include "listscan.hh"
+
+/** Sublists per Cilk worker; more balance the walks better */
+#if !defined (RULERS_PER_WORKER)
+#  define RULERS_PER_WORKER 64
+#endif
+
+/** Below this many nodes per sublist, the sequential scan wins */
+#define MIN_SUBLIST_LENGTH 64
+
+namespace listscan_par {
+
+  typedef unsigned long word_t; //!< Bitmap word
+  const size_t WORD_BITS = 8 * sizeof (word_t);
+  const size_t NONE = (size_t)-1;
+
+  /** One sublist, from its ruler up to (not including) the next ruler */
+  template <typename T>
+  struct Sublist_t
+  {
+    index_t ruler;
+    size_t length;
+    size_t next;  //!< Successor sublist, or 'NONE' at the tail
+    T sum;        //!< Its values, combined in list order
+    T carry;      //!< The scan up to the sublist, from the head or the tail
+  };
+
+  template <typename T>
+  bool
+  lessRuler (const Sublist_t<T>& a, const Sublist_t<T>& b)
+  {
+    return a.ruler < b.ruler;
+  }
+
+  /** Returns the sublist whose ruler is 'i'; 'i' must be a ruler */
+  template <typename T>
+  size_t
+  findSublist (const Sublist_t<T>* Sub, size_t s, index_t i)
+  {
+    Sublist_t<T> key;
+    key.ruler = i;
+    const Sublist_t<T>* p = std::lower_bound (Sub, Sub + s, key, lessRuler<T>);
+    assert (p < Sub + s && p->ruler == i);
+    return p - Sub;
+  }
+
+  inline bool
+  isRuler (const word_t* IsRuler, index_t i)
+  {
+    return (IsRuler[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+  }
+
+  inline void
+  setRuler (word_t* IsRuler, index_t i, bool value)
+  {
+    const word_t bit = (word_t)1 << (i % WORD_BITS);
+    if (value)
+      IsRuler[i / WORD_BITS] |= bit;
+    else
+      IsRuler[i / WORD_BITS] &= ~bit;
+  }
+
+  template <bool b> struct Bool_t {};
+
+  /**
+   *  Step 3 of a backward scan, for one sublist, under an operator
+   *  with an exact inverse: walking forward, the values from a node
+   *  to the end of the sublist are the inverse of those before it,
+   *  then the sum.
+   */
+  template <typename T, class values_t, class op_t>
+  void
+  scanSublistBackward (const Sublist_t<T>& S, const index_t* Next,
+                       const values_t& values, const op_t& op, T* Out,
+                       scan_kind_t kind, Bool_t<true>)
+  {
+    const T rest = op (S.sum, S.carry); // from the ruler to the tail
+    index_t cur = S.ruler;
+    T prefix = op.identity ();
+    for (size_t length = S.length; length; --length) {
+      if (kind == INCLUSIVE_SCAN) Out[cur] = op (op.inverse (prefix), rest);
+      prefix = op (prefix, values[cur]);
+      if (kind == EXCLUSIVE_SCAN) Out[cur] = op (op.inverse (prefix), rest);
+      cur = Next[cur];
+    }
+  }
+
+  /** The same, for any operator: records the nodes, then goes back */
+  template <typename T, class values_t, class op_t>
+  void
+  scanSublistBackward (const Sublist_t<T>& S, const index_t* Next,
+                       const values_t& values, const op_t& op, T* Out,
+                       scan_kind_t kind, Bool_t<false>)
+  {
+    std::vector<index_t> Nodes (S.length);
+    index_t cur = S.ruler;
+    for (size_t k = 0; k < Nodes.size (); ++k) {
+      Nodes[k] = cur;
+      cur = Next[cur];
+    }
+    T acc = S.carry;
+    for (size_t k = Nodes.size (); k > 0; --k) {
+      const index_t i = Nodes[k-1];
+      const T v = values[i];
+      if (kind == EXCLUSIVE_SCAN) Out[i] = acc;
+      acc = op (v, acc);
+      if (kind == INCLUSIVE_SCAN) Out[i] = acc;
+    }
+  }
+
+  /** xorshift64*, so as not to disturb the caller's lrand48() stream */
+  inline unsigned long long
+  nextRandom (unsigned long long* state)
+  {
+    unsigned long long x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+  }
+
+} // namespace listscan_par
+
+/**
+ *  A parallel listScan(), for a pool of 'n' nodes holding the one
+ *  list. 'IsRuler' is an optional bitmap of n bits, all clear, which
+ *  is left clear; pass it to save allocating one per call.
+ */
+template <typename T, class values_t, class op_t>
+void
+listScan__par (size_t n, index_t head, const index_t* Next,
+               const values_t& values, const op_t& op, T* Out,
+               scan_kind_t kind = INCLUSIVE_SCAN,
+               scan_direction_t direction = FORWARD_SCAN,
+               listscan_par::word_t* IsRuler = NULL)
+{
+  using namespace listscan_par;
+
+  if (head == NIL) return; // empty list
+  assert (Next && Out);
+
+  // Too short to split: scan sequentially
+  const size_t s = std::min ((size_t)__cilkrts_get_nworkers () * RULERS_PER_WORKER,
+                             n / MIN_SUBLIST_LENGTH);
+  if (s < 2) {
+    listScan (head, Next, values, op, Out, kind, direction);
+    return;
+  }
+
+  std::vector<word_t> Bitmap;
+  if (!IsRuler) {
+    Bitmap.resize ((n + WORD_BITS - 1) / WORD_BITS, 0);
+    IsRuler = &Bitmap[0];
+  }
+
+  // Pick the rulers: the head, and s-1 other distinct nodes
+  std::vector<Sublist_t<T> > Sublists (s);
+  Sublist_t<T>* Sub = &Sublists[0];
+  unsigned long long state = 0x9E3779B97F4A7C15ull ^ n;
+  Sub[0].ruler = head;
+  setRuler (IsRuler, head, true);
+  for (size_t j = 1; j < s; ++j) {
+    index_t i;
+    do {
+      i = (index_t)(nextRandom (&state) % n);
+    } while (isRuler (IsRuler, i));
+    Sub[j].ruler = i;
+    setRuler (IsRuler, i, true);
+  }
+  std::sort (Sub, Sub + s, lessRuler<T>);
+
+  // 1. Walk each sublist up to the next ruler, for its length and sum
+  _Cilk_for (size_t j = 0; j < s; ++j) {
+    index_t cur = Sub[j].ruler;
+    size_t length = 0;
+    T sum = op.identity ();
+    do {
+      sum = op (sum, values[cur]);
+      ++length;
+      cur = Next[cur];
+    } while (cur != NIL && !isRuler (IsRuler, cur));
+    Sub[j].length = length;
+    Sub[j].sum = sum;
+    Sub[j].next = (cur == NIL) ? NONE : findSublist (Sub, s, cur);
+  }
+
+  // 2. Scan the sums of the sublists, sequentially, in list order
+  std::vector<size_t> Order;
+  Order.reserve (s);
+  for (size_t j = findSublist (Sub, s, head); j != NONE; j = Sub[j].next)
+    Order.push_back (j);
+  assert (Order.size () == s);
+  T total = op.identity ();
+  if (direction == FORWARD_SCAN)
+    for (size_t k = 0; k < s; ++k) {
+      Sub[Order[k]].carry = total;
+      total = op (total, Sub[Order[k]].sum);
+    }
+  else
+    for (size_t k = s; k > 0; --k) {
+      Sub[Order[k-1]].carry = total;
+      total = op (Sub[Order[k-1]].sum, total);
+    }
+
+  // 3. Walk each sublist again, writing the scan
+  if (direction == FORWARD_SCAN) {
+    _Cilk_for (size_t j = 0; j < s; ++j) {
+      index_t cur = Sub[j].ruler;
+      T acc = Sub[j].carry;
+      for (size_t length = Sub[j].length; length; --length) {
+        const T v = values[cur];
+        if (kind == EXCLUSIVE_SCAN) Out[cur] = acc;
+        acc = op (acc, v);
+        if (kind == INCLUSIVE_SCAN) Out[cur] = acc;
+        cur = Next[cur];
+      }
+    }
+  } else {
+    _Cilk_for (size_t j = 0; j < s; ++j) {
+      scanSublistBackward (Sub[j], Next, values, op, Out, kind,
+                           Bool_t<ScanInverse_t<op_t>::exact> ());
+    }
+  }
+
+  // Leave the bitmap clear for the next call
+  for (size_t j = 0; j < s; ++j)
+    setRuler (IsRuler, Sub[j].ruler, false);
+}
+
+#endif // !defined (INC_LISTSCAN_PAR_HH)
+
+// eof
@@ -0,0 +1,134 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file listscan.hh
+ *  \brief Scans ("prefix sums") of per-node values along a linked
+ *  list, under any associative operator; sequential version. See
+ *  'listscan-par.hh' for the parallel one.
+ *
+ *  A forward scan combines values from the head: an inclusive scan
+ *  gives node i
+ *
+ *    op (v[head], op (..., v[i]))
+ *
+ *  and an exclusive one stops just before v[i]. A backward scan
+ *  combines from i to the tail instead. The operands stay in list
+ *  order either way, so the operator need not commute. List ranking
+ *  is the backward exclusive scan of ones under '+'.
+ *
+ *  'values' is anything that 'values[i]' gives the value of node i
+ *  for: an array, or a functor such as ScanOnes_t.
+ */
+
+#if !defined (INC_LISTSCAN_HH)
+#define INC_LISTSCAN_HH //!< listscan.hh included
+
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "list.hh"
+
+enum scan_kind_t { INCLUSIVE_SCAN, EXCLUSIVE_SCAN };
+enum scan_direction_t { FORWARD_SCAN, BACKWARD_SCAN };
+
+/** Scan operators: 'op (a, b)', associative, and 'op.identity ()' */
+template <typename T>
+struct ScanPlus_t
+{
+  T operator() (const T& a, const T& b) const { return a + b; }
+  T identity (void) const { return T (0); }
+  T inverse (const T& a) const { return -a; }
+};
+
+template <typename T>
+struct ScanMax_t
+{
+  T lowest;  //!< The identity: a value no greater than any other
+  ScanMax_t (const T& lowest_) : lowest (lowest_) {}
+  T operator() (const T& a, const T& b) const { return std::max (a, b); }
+  T identity (void) const { return lowest; }
+};
+
+/** An affine map, x -> a*x + b */
+struct Affine_t
+{
+  double a, b;
+};
+
+/** Composition of affine maps: 'op (f, g)' applies f, then g */
+struct ScanAffine_t
+{
+  Affine_t operator() (const Affine_t& f, const Affine_t& g) const
+  {
+    Affine_t h = {g.a * f.a, g.a * f.b + g.b};
+    return h;
+  }
+  Affine_t identity (void) const
+  {
+    Affine_t h = {1, 0};
+    return h;
+  }
+};
+
+/**
+ *  Whether 'op.inverse (a)' undoes a exactly, so that a backward scan
+ *  may be had from the head: for integer '+' (modulo 2^bits for
+ *  unsigned types), but not floating-point '+', which rounds.
+ */
+template <class op_t>
+struct ScanInverse_t
+{
+  static const bool exact = false;
+};
+
+template <typename T>
+struct ScanInverse_t<ScanPlus_t<T> >
+{
+  static const bool exact = std::numeric_limits<T>::is_integer;
+};
+
+/** Values of one for every node, without an array of them */
+template <typename T>
+struct ScanOnes_t
+{
+  T operator[] (index_t i) const { (void)i; return T (1); }
+};
+
+/** Scans the list that starts at 'head' into Out; see above. */
+template <typename T, class values_t, class op_t>
+void
+listScan (index_t head, const index_t* Next, const values_t& values, const op_t& op,
+          T* Out, scan_kind_t kind = INCLUSIVE_SCAN,
+          scan_direction_t direction = FORWARD_SCAN)
+{
+  if (head == NIL) return; // empty list
+  assert (Next && Out);
+
+  T acc = op.identity ();
+  if (direction == FORWARD_SCAN) {
+    for (index_t cur = head; cur != NIL; cur = Next[cur]) {
+      const T v = values[cur];
+      if (kind == EXCLUSIVE_SCAN) Out[cur] = acc;
+      acc = op (acc, v);
+      if (kind == INCLUSIVE_SCAN) Out[cur] = acc;
+    }
+  } else {
+    // Without an inverse, a backward scan must visit the nodes
+    // tail-first: record them in list order, then go back.
+    std::vector<index_t> Order;
+    for (index_t cur = head; cur != NIL; cur = Next[cur])
+      Order.push_back (cur);
+    for (size_t k = Order.size (); k > 0; --k) {
+      const index_t cur = Order[k-1];
+      const T v = values[cur];
+      if (kind == EXCLUSIVE_SCAN) Out[cur] = acc;
+      acc = op (v, acc);
+      if (kind == INCLUSIVE_SCAN) Out[cur] = acc;
+    }
+  }
+}
+
+#endif // !defined (INC_LISTSCAN_HH)
+
+// eof
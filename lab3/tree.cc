@@ -0,0 +1,192 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file tree.cc
+ *  \brief Implements the tree.hh interface.
+ */
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "hugepages.h"
+#include "tree.hh"
+
+using namespace std;
+
+/* ====================================================================== */
+
+static index_t *
+createIndexBuffer (size_t n)
+{
+  index_t* A = NULL;
+  if (n) {
+    A = (index_t *)allocPages (n * sizeof (index_t), getDefaultPageKind ());
+    assert (A);
+  }
+  return A;
+}
+
+int
+getTreeShape (const char* name)
+{
+  if (!strcmp (name, "random")) return TREE_RANDOM;
+  if (!strcmp (name, "path")) return TREE_PATH;
+  return -1;
+}
+
+const char *
+getTreeShapeName (tree_shape_t shape)
+{
+  return (shape == TREE_PATH) ? "path" : "random";
+}
+
+/** Fills in the child lists of T from its parent pointers */
+static void
+linkChildren (Tree_t* T)
+{
+  const size_t n = T->n;
+  for (size_t v = 0; v < n; ++v)
+    T->FirstChild[v] = T->NextSibling[v] = NIL;
+
+  // Push each node onto its parent's list, last node first, so the
+  // lists come out in increasing order.
+  T->root = NIL;
+  for (size_t k = n; k > 0; --k) {
+    const index_t v = k - 1;
+    const index_t p = T->Parent[v];
+    if (p == NIL) {
+      assert (T->root == NIL); // just one root
+      T->root = v;
+    } else {
+      T->NextSibling[v] = T->FirstChild[p];
+      T->FirstChild[p] = v;
+    }
+  }
+  assert (T->root != NIL || !n);
+}
+
+static Tree_t *
+allocTree (size_t n)
+{
+  Tree_t* T = new Tree_t;
+  assert (T);
+  T->n = n;
+  T->root = NIL;
+  T->Parent = createIndexBuffer (n);
+  T->FirstChild = createIndexBuffer (n);
+  T->NextSibling = createIndexBuffer (n);
+  return T;
+}
+
+Tree_t *
+createTreeFromParents (size_t n, const index_t* Parent)
+{
+  Tree_t* T = allocTree (n);
+  if (n) memcpy (T->Parent, Parent, n * sizeof (index_t));
+  linkChildren (T);
+  return T;
+}
+
+Tree_t *
+createRandomTree (size_t n, tree_shape_t shape)
+{
+  Tree_t* T = allocTree (n);
+  if (!n) return T;
+
+  // Node k of the order of creation becomes node Label[k]
+  vector<index_t> Label (n);
+  for (size_t k = 0; k < n; ++k)
+    Label[k] = k;
+  for (size_t k = 0; k + 1 < n; ++k) // Fisher-Yates, as in 'list.cc'
+    swap (Label[k], Label[k + 1 + (lrand48 () % (n-k-1))]);
+
+  T->Parent[Label[0]] = NIL;
+  for (size_t k = 1; k < n; ++k) {
+    const size_t parent = (shape == TREE_PATH) ? (k - 1) : (size_t)(lrand48 () % k);
+    T->Parent[Label[k]] = Label[parent];
+  }
+  linkChildren (T);
+  return T;
+}
+
+void
+releaseTree (Tree_t* T)
+{
+  if (T) {
+    freePages (T->Parent);
+    freePages (T->FirstChild);
+    freePages (T->NextSibling);
+    delete T;
+  }
+}
+
+/* ====================================================================== */
+
+TreeNumbers_t *
+createTreeNumbers (size_t n)
+{
+  TreeNumbers_t* X = new TreeNumbers_t;
+  assert (X);
+  X->n = n;
+  X->Pre = createIndexBuffer (n);
+  X->Post = createIndexBuffer (n);
+  X->Depth = createIndexBuffer (n);
+  X->Size = createIndexBuffer (n);
+  return X;
+}
+
+void
+releaseTreeNumbers (TreeNumbers_t* X)
+{
+  if (X) {
+    freePages (X->Pre);
+    freePages (X->Post);
+    freePages (X->Depth);
+    freePages (X->Size);
+    delete X;
+  }
+}
+
+void
+computeTreeNumbers (const Tree_t* T, TreeNumbers_t* X)
+{
+  assert (T && X && X->n == T->n);
+  const index_t root = T->root;
+  if (root == NIL) return; // empty tree
+
+  // Paths can be n long, so this walks the tree with the parent
+  // pointers rather than recursing.
+  index_t pre = 0, post = 0;
+  index_t v = root;
+  X->Pre[v] = pre++;
+  X->Depth[v] = 0;
+  for (;;) {
+    // Go down to the first child, if any...
+    if (T->FirstChild[v] != NIL) {
+      v = T->FirstChild[v];
+      X->Pre[v] = pre++;
+      X->Depth[v] = X->Depth[T->Parent[v]] + 1;
+      continue;
+    }
+    // ... else finish v and its ancestors up to one with a next
+    // sibling, and go there.
+    for (;;) {
+      X->Size[v] = pre - X->Pre[v];
+      X->Post[v] = post++;
+      if (v == root)
+        return;
+      if (T->NextSibling[v] != NIL) {
+        v = T->NextSibling[v];
+        X->Pre[v] = pre++;
+        X->Depth[v] = X->Depth[T->Parent[v]] + 1;
+        break;
+      }
+      v = T->Parent[v];
+    }
+  }
+}
+
+// eof
@@ -0,0 +1,77 @@
+// -*- mode:c++; tab-width:2; indent-tabs-mode:nil;  -*-
+/**
+ *  \file tree.hh
+ *  \brief Defines an "array pool" representation of a rooted tree,
+ *  random trees for testing, and a sequential traversal; see
+ *  'eulertour.hh' for the parallel one.
+ */
+
+#if !defined (INC_TREE_HH)
+#define INC_TREE_HH //!< tree.hh included
+
+#include "list.hh"
+
+/**
+ *  A rooted tree of nodes 0, 1, ..., n-1, as parent pointers and as
+ *  child lists; each array holds NIL where there is no such node.
+ */
+struct Tree_t
+{
+  size_t n;
+  index_t root;
+  index_t* Parent;
+  index_t* FirstChild;
+  index_t* NextSibling;
+};
+
+/** Shapes of createRandomTree() */
+enum tree_shape_t
+{
+  TREE_RANDOM, //!< Each node's parent is a uniformly random earlier node: depth ~ ln n
+  TREE_PATH    //!< Each node's parent is the one before it: depth n-1
+};
+
+/** Returns the shape named "random" or "path", or -1. */
+int getTreeShape (const char* name);
+
+/** Returns the name of a shape */
+const char* getTreeShapeName (tree_shape_t shape);
+
+/**
+ *  Returns a new tree of n nodes of the given shape, whose node
+ *  numbers are a random permutation of the order of creation, so that
+ *  neighbors are scattered in memory as in createRandomList().
+ */
+Tree_t* createRandomTree (size_t n, tree_shape_t shape);
+
+/**
+ *  Returns a new tree given its parent pointers (NIL at the root),
+ *  which it copies; the child lists come in increasing node order.
+ */
+Tree_t* createTreeFromParents (size_t n, const index_t* Parent);
+
+void releaseTree (Tree_t* T);
+
+/** Per-node numbers of a tree, from a depth-first traversal */
+struct TreeNumbers_t
+{
+  size_t n;
+  index_t* Pre;   //!< Preorder number: 0 at the root
+  index_t* Post;  //!< Postorder number: n-1 at the root
+  index_t* Depth; //!< Edges from the root
+  index_t* Size;  //!< Nodes in the subtree
+};
+
+TreeNumbers_t* createTreeNumbers (size_t n);
+void releaseTreeNumbers (TreeNumbers_t* X);
+
+/**
+ *  Computes the numbers of every node of T by a sequential,
+ *  iterative depth-first search that visits children in the order
+ *  of the child lists.
+ */
+void computeTreeNumbers (const Tree_t* T, TreeNumbers_t* X);
+
+#endif // !defined (INC_TREE_HH)
+
+// eof
@@ -14,6 +14,9 @@
 #include <strings.h>
 #include <mpi.h>
 #include "mpi_fprintf.h"
+#include "timer.h"
+#include "bench.h"
+#include "results.h"
 
 extern const char* bcast_algorithm (void);
 extern void bcast (int* data, const int len);
@@ -27,6 +30,12 @@ extern void bcast (int* data, const int len);
 /** Minimum time (seconds) for a set of trials */
 #define MIN_TIME 0.2
 
+/**
+ *  Minimum time (seconds) for one trial; a trial repeats the
+ *  broadcast enough times to take at least this long.
+ */
+#define MIN_TRIAL_TIME (MIN_TIME / 10)
+
 /* ============================================================ */
 
 /**
@@ -63,6 +72,44 @@ test_message (const int rank, const int* msgbuf, const int len)
 
 /* ============================================================ */
 
+/** One trial for the benchmark harness: 'reps' broadcasts in a row */
+typedef struct
+{
+  int* msgbuf;
+  int msglen;
+  size_t reps;
+} bcast_trial_t;
+
+/** Starts every trial on all processes together */
+static
+void
+sync_trial (void* arg)
+{
+  MPI_Barrier (MPI_COMM_WORLD);
+}
+
+static
+void
+run_bcasts (void* arg)
+{
+  const bcast_trial_t* X = (const bcast_trial_t *)arg;
+  size_t k;
+  for (k = 0; k < X->reps; ++k)
+    bcast (X->msgbuf, X->msglen);
+}
+
+/** A trial takes as long as its slowest process */
+static
+long double
+max_over_ranks (long double t, void* arg)
+{
+  double t_local = (double)t, t_max = 0;
+  MPI_Allreduce (&t_local, &t_max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  return t_max;
+}
+
+/* ============================================================ */
+
 /** Program start */
 int
 main (int argc, char *argv[])
@@ -80,6 +127,11 @@ main (int argc, char *argv[])
   int msglen = 0;
   int min_msglen = MIN_MSGLEN;
 
+  /* Trials */
+  struct stopwatch_t* timer = NULL;
+  bench_config_t config;
+  results_t* results = NULL; /* only on rank 0 */
+
   /* Start MPI */
   MPI_Init (&argc, &argv);
   MPI_Comm_rank (MPI_COMM_WORLD, &rank);	/* Get process id */
@@ -88,6 +140,13 @@ main (int argc, char *argv[])
 
   if (min_msglen < P) min_msglen = P;
 
+  /* Prints the timer only once */
+  if (rank == 0)
+    stopwatch_init ();
+  timer = stopwatch_create (); assert (timer);
+  benchDefaults (&config);
+  config.min_time = MIN_TIME;
+
   /* Setup output filename */
   sprintf (outfile, "%s-%d.dat", bcast_algorithm (), P);
 
@@ -100,7 +159,11 @@ main (int argc, char *argv[])
     MPI_fprintf (stderr, "  Largest message size tested: %d words (%.1f MiB)\n",
 		 MAX_MSGLEN, (double)MAX_MSGLEN * sizeof (int) / 1024 / 1024);
     MPI_fprintf (stderr, "  Output file: %s\n", outfile);
+    printBenchConfig (stderr, &config);
     MPI_fprintf (stderr, "\n");
+
+    results = openResults (bcast_algorithm ());
+    addResultInt (results, "ranks", P);
   }
 
   /* Open a file for writing results */
@@ -108,7 +171,7 @@ main (int argc, char *argv[])
   if (rank == 0) {
     fp = fopen (outfile, "w");
     assert (fp != NULL);
-    fprintf (fp, "#P\tBytes\tSeconds\tTrials\n");
+    fprintf (fp, "#P\tBytes\tSeconds\tTrials\tMin\tCI-low\tCI-high\n");
   }
 
   /* Create a message buffer */
@@ -117,8 +180,9 @@ main (int argc, char *argv[])
 
   /* Runs the asynchronous test-delay protocol */
   for (msglen = min_msglen; msglen <= MAX_MSGLEN; msglen <<= 1) {
-    size_t trials = 3;
-    double t_max = 0, t_elapsed;
+    bcast_trial_t X;
+    bench_task_t task = { sync_trial, run_bcasts, NULL, max_over_ranks, &X };
+    bench_result_t R;
     int i;
 
     /* Verify that the bcast protocol */
@@ -132,38 +196,65 @@ main (int argc, char *argv[])
     }
     MPI_fprintf (stderr, "==> Passed! (message = %d words)\n");
 
-    MPI_fprintf (stderr, "Timing (%d words)...\n", msglen);
-    do {
-      double t_start;
-      double t_elapsed;
-      int k;
-      MPI_Barrier (MPI_COMM_WORLD);
-      t_start = MPI_Wtime ();
-      for (k = 0; k < trials; ++k)
-        bcast (msgbuf, msglen);
-      t_elapsed = MPI_Wtime () - t_start;
-      MPI_Barrier (MPI_COMM_WORLD);
-      MPI_Allreduce (&t_elapsed, &t_max, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
-      if (t_max < MIN_TIME) trials <<= 1;
-    } while (t_max < MIN_TIME);
+    /* Repeat the broadcast until a trial is long enough to time */
+    X.msgbuf = msgbuf;
+    X.msglen = msglen;
+    X.reps = 1;
+    for (;;) {
+      long double t;
+      sync_trial (&X);
+      stopwatch_start (timer);
+      run_bcasts (&X);
+      t = max_over_ranks (stopwatch_stop (timer), &X);
+      if (t >= MIN_TRIAL_TIME) break;
+      X.reps <<= 1;
+    }
+
+    MPI_fprintf (stderr, "Timing (%d words, %lu per trial)...\n",
+		 msglen, (unsigned long)X.reps);
+    benchRun (&config, &task, timer, &R);
     MPI_fprintf (stderr, "==> Done! (%d words, %g secs/trial)\n",
-		 msglen, t_elapsed/trials);
+		 msglen, (double)(R.median / X.reps));
 
-    /* Write out the timing result */
+    /* Write out the timing result: the median time per broadcast */
     if (rank == 0) {
       const int bytes = msglen * sizeof (int);
-      const double t_bcast = t_max / trials;
+      const double t_bcast = R.median / X.reps;
+      const int trials = (int)(R.n * X.reps);
       MPI_fprintf (stdout, "%d\t%d\t%g\t%d\n", P, bytes, t_bcast, trials);
-      fprintf (fp, "%d\t%d\t%g\t%d\n", P, bytes, t_bcast, trials);
+      fprintf (fp, "%d\t%d\t%g\t%d\t%g\t%g\t%g\n", P, bytes, t_bcast, trials,
+	       (double)(R.min / X.reps), (double)(R.ci_lo / X.reps),
+	       (double)(R.ci_hi / X.reps));
       fflush (fp);
     }
+    if (results) {
+      /* Per broadcast, so that runs with different batches compare */
+      bench_result_t R_bcast;
+      long double* times = (long double *)malloc (R.n * sizeof (long double));
+      size_t k;
+      assert (times);
+      for (k = 0; k < R.n; ++k)
+	times[k] = R.times[k] / X.reps;
+      benchStats (&config, times, R.n, &R_bcast);
+      beginResult (results, "bcast");
+      addResultInt (results, "bytes", msglen * sizeof (int));
+      addResultTimes (results, &R_bcast);
+      addResultInt (results, "reps", X.reps);
+      endResult (results);
+      benchRelease (&R_bcast);
+      free (times);
+    }
+    benchRelease (&R);
   }
 
   MPI_fprintf (stderr, "Done! Cleaning up...\n");
   free (msgbuf);
+  stopwatch_destroy (timer);
 
-  if (rank == 0)
+  if (rank == 0) {
     fclose (fp); /* Close output file */
+    closeResults (results);
+  }
   MPI_fprintf (stderr, "Shutting down MPI...\n");
   MPI_Finalize ();
   fprintf (stderr, "[rank %d of %d] End.\n", rank, P);
@@ -511,6 +511,10 @@ cudaReduction (dtype *A, unsigned int N, unsigned int OPT, dtype *ret)
 	fprintf (stderr, "Execution time: %f ms\n", elapsedTime);
 	fprintf (stderr, "Equivalent performance: %f GB/s\n", 
 						(N * sizeof (dtype) / elapsedTime) * 1e-6);
+	/* Roofline point: N-1 adds over N loads; see lab2/numa/roofline.gpi */
+	printf ("point\treduce-%u\t%g\t%g\n", OPT,
+					(double) (N - 1) / (N * sizeof (dtype)),
+					(N - 1) / elapsedTime * 1e-6);
 
 	CUDA_CHECK_ERROR (cudaEventDestroy (start));
 	CUDA_CHECK_ERROR (cudaEventDestroy (stop));
@@ -6,6 +6,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "hugepages.h"
+
 extern void sgemm_ (const char* opA, const char* opB,
 		    const int* M, const int* N, const int* K,
 		    const float* alpha, const float* A, const int* lda,
@@ -28,7 +30,7 @@ mm_local (const int m, const int n, const int k,
 float *
 mm_create (int m, int n)
 {
-  float* A = (float *)malloc (m * n * sizeof (float));
+  float* A = (float *)allocPages ((size_t)m * n * sizeof (float), getDefaultPageKind ());
   assert (A);
   return A;
 }
@@ -36,7 +38,7 @@ mm_create (int m, int n)
 void
 mm_free (float* A)
 {
-  if (A) free (A);
+  freePages (A);
 }
 
 /* eof */
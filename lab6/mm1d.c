@@ -7,10 +7,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <mpi.h>
 #include "mpi_fprintf.h"
 #include "mpi_assert.h"
+#include "hugepages.h"
+#include "timer.h"
+#include "bench.h"
+#include "results.h"
 
 #define MINTRIALS 3 /* Minimum number of timing trials */
 #define MINTIME 1.0 /* Minimum time (in seconds) */
@@ -19,7 +24,11 @@
  * "Sequential" (single-node, non-MPI) matrix operations.
  */
 
-/** Creates a newly-allocated matrix of size m x n. */
+/**
+ *  Creates a newly-allocated matrix of size m x n. The BLAS version
+ *  allocates on pages of the default kind (see 'hugepages.h'); the
+ *  CUDA version uses pinned host memory instead.
+ */
 extern float* mm_create (int m, int n);
 
 /** Frees a matrix. */
@@ -47,7 +56,9 @@ extern void mm_local (const int m, const int n, const int k,
  *  processes in the communicator 'comm' owns 'n / P' consecutive rows
  *  of each operand. The locally owned portions of the matrix are
  *  'A_local', 'B_local', and 'C_local', stored in column-major
- *  order. The algorithm circularly shifts 'B_local'.
+ *  order. The algorithm circularly shifts 'B_local', receiving each
+ *  shift into 'B_recv', a caller's buffer of the same size, so that
+ *  no trial allocates.
  *
  *  See also slide 28 of the October 23, 2012 CSE 6230 lecture:
  *  http://vuduc.org/teaching/cse6230-hpcta-fa12/slides/cse6230-fa12--distmem.pdf
@@ -58,7 +69,7 @@ extern void mm_local (const int m, const int n, const int k,
 double
 mm1d (int n,
       const float* A_local, float* B_local, float* C_local,
-      MPI_Comm comm)
+      float* B_recv, MPI_Comm comm)
 {
   double t_comp = 0;
 
@@ -75,7 +86,7 @@ mm1d (int n,
 #define RECV 1
   float* B_buffered[2];
   B_buffered[SEND] = B_local;
-  B_buffered[RECV] = mm_create (n_by_P, n);
+  B_buffered[RECV] = B_recv;
   MPI_Assert (comm, B_buffered[RECV] != NULL);
 
   const int r_next = (r + 1) % P;
@@ -122,6 +133,51 @@ init_mat_random (int m, int n, float* A)
   }
 }
 
+/* ==================================================
+ * Benchmark harness hooks (see 'bench.h')
+ */
+
+/** One trial: one distributed multiply */
+typedef struct
+{
+  int n;
+  const float* A_local;
+  float* B_local;
+  float* C_local;
+  float* B_recv;
+  MPI_Comm comm;
+  size_t warmup; /* Warm-up runs, whose computation time is not counted */
+  size_t runs;
+  double t_comp; /* Total computation time of the timed trials */
+} mm1d_trial_t;
+
+/** Starts every trial on all processes together */
+static void
+sync_trial (void* arg)
+{
+  MPI_Barrier (((mm1d_trial_t *)arg)->comm);
+}
+
+static void
+run_mm1d (void* arg)
+{
+  mm1d_trial_t* X = (mm1d_trial_t *)arg;
+  const double t_comp = mm1d (X->n, X->A_local, X->B_local, X->C_local,
+			      X->B_recv, X->comm);
+  if (X->runs++ >= X->warmup)
+    X->t_comp += t_comp;
+}
+
+/** A trial takes as long as its slowest process */
+static long double
+max_over_ranks (long double t, void* arg)
+{
+  double t_local = (double)t, t_max = 0;
+  MPI_Allreduce (&t_local, &t_max, 1, MPI_DOUBLE, MPI_MAX,
+		 ((mm1d_trial_t *)arg)->comm);
+  return t_max;
+}
+
 int
 main (int argc, char* argv[])
 {
@@ -132,6 +188,25 @@ main (int argc, char* argv[])
   MPI_Comm_size (comm, &P);
   MPI_Comm_rank (comm, &r);
 
+  page_kind_t pages = PAGES_DEFAULT;
+  const char* pages_name = getenv ("PAGES");
+  int opt;
+  while ((opt = getopt (argc, argv, "p:")) != -1) {
+    if (opt == 'p')
+      pages_name = optarg;
+    else
+      pages_name = "?";
+  }
+  if (pages_name && parsePageKind (pages_name, &pages)) {
+    if (r == 0)
+      fprintf (stderr, "usage: %s [-p <pages>]\n"
+	       "where -p backs the matrices with default, 4k, thp, 2m, or 1g pages\n"
+	       "(default: $PAGES, else default).\n", argv[0]);
+    MPI_Finalize ();
+    return -1;
+  }
+  setDefaultPageKind (pages);
+
   const int n_desired = 4096; /* Target problem size */
   const int n_local = (n_desired + P - 1) / P; /* ceil (n_desired / P) */
   const int n = n_local * P; /* Actual global problem size */
@@ -140,40 +215,72 @@ main (int argc, char* argv[])
   float* A_local = mm_create (n_local, n);
   float* B_local = mm_create (n_local, n);
   float* C_local = mm_create (n_local, n);
+  float* B_recv = mm_create (n_local, n); /* mm1d()'s receive buffer */
   init_mat_random (n_local, n, A_local);
   init_mat_random (n_local, n, B_local);
   init_mat_random (n_local, n, C_local);
 
-  MPI_fprintf (comm, stderr, "Performing one warm-up multiply...\n");
-  MPI_Barrier (comm);
-  mm1d (n, A_local, B_local, C_local, comm);
-  MPI_Barrier (comm);
+  /* Prints the timer only once */
+  if (r == 0)
+    stopwatch_init ();
+  struct stopwatch_t* timer = stopwatch_create ();
+  MPI_Assert (comm, timer != NULL);
+  bench_config_t config;
+  benchDefaults (&config);
+  if (config.min_trials < MINTRIALS) config.min_trials = MINTRIALS;
+  if (config.max_trials < config.min_trials) config.max_trials = config.min_trials;
+  config.min_time = MINTIME;
 
   MPI_fprintf (comm, stderr, "Timing trials...\n");
-  int trials = 0;
-  double t_elapsed = 0, t_comp = 0, t_start = MPI_Wtime ();
-  do {
-    t_comp += mm1d (n, A_local, B_local, C_local, comm);
-    ++trials;
-    t_elapsed = MPI_Wtime () - t_start;
-  } while (trials < MINTRIALS || t_elapsed < MINTIME);
-
-  double t_max = -1, t_comp_max = -1;
-  MPI_Reduce (&t_elapsed, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
-  t_max /= trials;
-  MPI_Reduce (&t_comp, &t_comp_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  mm1d_trial_t X = { n, A_local, B_local, C_local, B_recv, comm,
+		     config.warmup, 0, 0 };
+  bench_task_t task = { sync_trial, run_mm1d, NULL, max_over_ranks, &X };
+  bench_result_t R;
+  benchRun (&config, &task, timer, &R);
+
+  const int trials = (int)R.n;
+  const double t_max = R.median;
+  double t_comp_max = -1;
+  MPI_Reduce (&X.t_comp, &t_comp_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
   t_comp_max /= trials;
   if (r == 0) {
     printf ("========================================\n");
     printf ("Problem dimension: n = %d\n", n);
     printf ("Number of MPI ranks: %d\n", P);
+    printBenchConfig (stdout, &config);
     printf ("Number of trials: %d\n", trials);
-    printf ("Time per trial (max over all processes): %g seconds\n", t_max);
+    printf ("Time per trial (max over all processes, median): %g seconds\n", t_max);
+    printf ("  (min %Lg, MAD %Lg, %Lg%% CI %Lg to %Lg)\n",
+	    R.min, R.mad, 100 * config.confidence, R.ci_lo, R.ci_hi);
     printf ("Computation time per trial (max over all processes): %g seconds\n", t_comp_max);
     printf ("Effective performance: %.1f GFLOP/s\n", 2e-9 * n * n * n / t_max);
+    printf ("Pages: %s\n", getPageKindName (pages));
+    /* Roofline point of the local multiplies: each touches its three
+       operands at least once; see lab2/numa/roofline.gpi */
+    printf ("point\tmm_local\t%g\t%g\n",
+	    2.0 * n_local * n * n_local
+	    / (sizeof (float) * ((double)n_local * n_local + 2.0 * n * n_local)),
+	    2e-9 * n_local * n * n / t_comp_max);
+    printPageReport (stdout, "A_local (rank 0)", A_local);
     printf ("========================================\n");
+
+    results_t* J = openResults ("mm1d");
+    addResultInt (J, "n", n);
+    addResultInt (J, "ranks", P);
+    addResultString (J, "pages", getPageKindName (pages));
+    beginResult (J, "mm1d");
+    addResultTimes (J, &R);
+    addResultReal (J, "comp_time", t_comp_max);
+    endResult (J);
+    closeResults (J);
   }
 
+  benchRelease (&R);
+  stopwatch_destroy (timer);
+  mm_free (B_recv);
+  mm_free (C_local);
+  mm_free (B_local);
+  mm_free (A_local);
   MPI_Finalize ();
   return 0;
 }
@@ -0,0 +1,424 @@
+/**
+ *  \file benchcmp.c
+ *  \brief Compares two results files (see 'common/results.h') and
+ *  flags the benchmarks that got slower.
+ *
+ *  For every benchmark in both files (matched by name and parameters),
+ *  it compares the medians of the trial times, and tests whether the
+ *  two sets of times differ with a two-sided Mann-Whitney U test
+ *  (normal approximation, with a tie correction). A benchmark
+ *  regressed if its median grew by more than the threshold and the
+ *  test is significant. The exit status is 1 if any benchmark
+ *  regressed, 2 on errors, and 0 otherwise.
+ *
+ *  With only a few trials per side, the test cannot reach small
+ *  p-values (3 against 3 trials cannot go below 0.1); run enough
+ *  trials, e.g., BENCH_MIN_TRIALS=10, for the runs you compare.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_THRESHOLD 0.05
+#define DEFAULT_ALPHA 0.01
+
+/* ====================================================================== */
+
+/** A JSON value */
+typedef enum { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT } json_type_t;
+
+typedef struct json_t
+{
+  json_type_t type;
+  double number;         /*!< JSON_NUMBER, JSON_BOOL */
+  char* string;          /*!< JSON_STRING */
+  size_t n;              /*!< JSON_ARRAY, JSON_OBJECT: number of items */
+  char** keys;           /*!< JSON_OBJECT */
+  struct json_t* items;  /*!< JSON_ARRAY, JSON_OBJECT */
+} json_t;
+
+static void
+skipSpace (const char** s)
+{
+  while (**s == ' ' || **s == '\t' || **s == '\n' || **s == '\r')
+    ++*s;
+}
+
+static int parseValue (const char** s, json_t* v);
+
+static int
+parseWord (const char** s, const char* word)
+{
+  const size_t len = strlen (word);
+  if (strncmp (*s, word, len)) return -1;
+  *s += len;
+  return 0;
+}
+
+/** Parses a string at *s (just past its opening quote) into a new buffer */
+static char *
+parseString (const char** s)
+{
+  const char* p = *s;
+  char* out = (char *)malloc (strlen (p) + 1);
+  char* q = out;
+  assert (out);
+  while (*p && *p != '"') {
+    if (*p == '\\') {
+      ++p;
+      switch (*p) {
+      case 'n': *q++ = '\n'; break;
+      case 't': *q++ = '\t'; break;
+      case 'r': *q++ = '\r'; break;
+      case 'b': *q++ = '\b'; break;
+      case 'f': *q++ = '\f'; break;
+      case 'u': { /* Only the control characters results.c escapes */
+	char hex[5];
+	if (strlen (p) < 5) { free (out); return NULL; }
+	memcpy (hex, p + 1, 4);
+	hex[4] = 0;
+	*q++ = (char)strtol (hex, NULL, 16);
+	p += 4;
+	break;
+      }
+      case 0: free (out); return NULL;
+      default: *q++ = *p; break;
+      }
+      ++p;
+    } else {
+      *q++ = *p++;
+    }
+  }
+  if (*p != '"') { free (out); return NULL; }
+  *q = 0;
+  *s = p + 1;
+  return out;
+}
+
+/** Appends a new, null item to the array or object A, and returns it */
+static json_t *
+appendItem (json_t* A)
+{
+  A->items = (json_t *)realloc (A->items, (A->n + 1) * sizeof (json_t));
+  assert (A->items);
+  memset (&A->items[A->n], 0, sizeof (json_t));
+  return &A->items[A->n++];
+}
+
+static int
+parseContainer (const char** s, json_t* v, char close)
+{
+  ++*s;
+  skipSpace (s);
+  if (**s == close) { ++*s; return 0; }
+  for (;;) {
+    json_t* item;
+    skipSpace (s);
+    if (close == '}') {
+      char* key;
+      if (**s != '"') return -1;
+      ++*s;
+      if (!(key = parseString (s))) return -1;
+      v->keys = (char **)realloc (v->keys, (v->n + 1) * sizeof (char *));
+      assert (v->keys);
+      v->keys[v->n] = key;
+      skipSpace (s);
+      if (**s != ':') return -1;
+      ++*s;
+    }
+    item = appendItem (v);
+    if (parseValue (s, item)) return -1;
+    skipSpace (s);
+    if (**s == ',') { ++*s; continue; }
+    if (**s == close) { ++*s; return 0; }
+    return -1;
+  }
+}
+
+static int
+parseValue (const char** s, json_t* v)
+{
+  memset (v, 0, sizeof (json_t));
+  skipSpace (s);
+  switch (**s) {
+  case '{': v->type = JSON_OBJECT; return parseContainer (s, v, '}');
+  case '[': v->type = JSON_ARRAY; return parseContainer (s, v, ']');
+  case '"':
+    ++*s;
+    v->type = JSON_STRING;
+    return (v->string = parseString (s)) ? 0 : -1;
+  case 't': v->type = JSON_BOOL; v->number = 1; return parseWord (s, "true");
+  case 'f': v->type = JSON_BOOL; v->number = 0; return parseWord (s, "false");
+  case 'n': v->type = JSON_NULL; return parseWord (s, "null");
+  default: {
+    char* end;
+    v->type = JSON_NUMBER;
+    v->number = strtod (*s, &end);
+    if (end == *s) return -1;
+    *s = end;
+    return 0;
+  }
+  }
+}
+
+static void
+freeJson (json_t* v)
+{
+  size_t i;
+  for (i = 0; i < v->n; ++i) {
+    freeJson (&v->items[i]);
+    if (v->keys) free (v->keys[i]);
+  }
+  free (v->items);
+  free (v->keys);
+  free (v->string);
+}
+
+/** Returns the member 'key' of object v, or NULL */
+static const json_t *
+getMember (const json_t* v, const char* key)
+{
+  size_t i;
+  if (!v || v->type != JSON_OBJECT) return NULL;
+  for (i = 0; i < v->n; ++i)
+    if (!strcmp (v->keys[i], key))
+      return &v->items[i];
+  return NULL;
+}
+
+static const char *
+getString (const json_t* v, const char* key)
+{
+  const json_t* m = getMember (v, key);
+  return (m && m->type == JSON_STRING) ? m->string : "?";
+}
+
+/** Reads and parses a results file; returns 0 on success */
+static int
+loadResults (const char* path, json_t* root)
+{
+  FILE* fp = fopen (path, "r");
+  char* text;
+  const char* s;
+  long len;
+  int err;
+
+  if (!fp) {
+    fprintf (stderr, "*** Could not open '%s'. ***\n", path);
+    return -1;
+  }
+  fseek (fp, 0, SEEK_END);
+  len = ftell (fp);
+  fseek (fp, 0, SEEK_SET);
+  text = (char *)malloc (len + 1);
+  assert (text);
+  len = (long)fread (text, 1, len, fp);
+  text[len] = 0;
+  fclose (fp);
+
+  s = text;
+  err = parseValue (&s, root) || root->type != JSON_OBJECT
+    || !getMember (root, "results");
+  free (text);
+  if (err)
+    fprintf (stderr, "*** '%s' is not a complete results file. ***\n", path);
+  return err ? -1 : 0;
+}
+
+/* ====================================================================== */
+
+/** One benchmark of a results file */
+typedef struct
+{
+  char key[512];   /*!< "name (k=v, ...)" */
+  double* times;
+  size_t n;
+  double median;
+} entry_t;
+
+static int
+compareDoubles (const void* a, const void* b)
+{
+  const double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/** Collects the benchmarks of a results file that have times */
+static size_t
+getEntries (const json_t* root, entry_t** E_out)
+{
+  const json_t* results = getMember (root, "results");
+  entry_t* E = (entry_t *)calloc (results->n + 1, sizeof (entry_t));
+  size_t i, k, n = 0;
+  assert (E);
+  for (i = 0; i < results->n; ++i) {
+    const json_t* r = &results->items[i];
+    const json_t* params = getMember (r, "params");
+    const json_t* times = getMember (r, "times");
+    entry_t* e = &E[n];
+    int len;
+    if (!times || times->type != JSON_ARRAY || !times->n) continue;
+
+    len = snprintf (e->key, sizeof (e->key), "%s", getString (r, "name"));
+    for (k = 0; params && k < params->n && len < (int)sizeof (e->key); ++k) {
+      const json_t* p = &params->items[k];
+      len += snprintf (e->key + len, sizeof (e->key) - len, "%s%s=",
+		       k ? ", " : " (", params->keys[k]);
+      if (len >= (int)sizeof (e->key)) break;
+      if (p->type == JSON_STRING)
+	len += snprintf (e->key + len, sizeof (e->key) - len, "%s", p->string);
+      else
+	len += snprintf (e->key + len, sizeof (e->key) - len, "%g", p->number);
+    }
+    if (params && params->n && len < (int)sizeof (e->key) - 1)
+      strcat (e->key, ")");
+
+    e->times = (double *)malloc (times->n * sizeof (double));
+    assert (e->times);
+    for (k = 0; k < times->n; ++k)
+      e->times[e->n++] = times->items[k].number;
+    qsort (e->times, e->n, sizeof (double), compareDoubles);
+    e->median = (e->n % 2) ? e->times[e->n/2]
+      : 0.5 * (e->times[e->n/2 - 1] + e->times[e->n/2]);
+    ++n;
+  }
+  *E_out = E;
+  return n;
+}
+
+static const entry_t *
+findEntry (const entry_t* E, size_t n, const char* key)
+{
+  size_t i;
+  for (i = 0; i < n; ++i)
+    if (!strcmp (E[i].key, key))
+      return &E[i];
+  return NULL;
+}
+
+/**
+ *  Returns the two-sided p-value of the Mann-Whitney U test of the
+ *  sorted samples x[0:m-1] and y[0:n-1].
+ */
+static double
+mannWhitney (const double* x, size_t m, const double* y, size_t n)
+{
+  const double N = (double)(m + n);
+  double rank_x = 0, ties = 0, u, mu, sigma, z;
+  size_t i = 0, j = 0;
+
+  /* Walk the merged order, giving each run of ties its average rank */
+  while (i < m || j < n) {
+    const double v = (j >= n || (i < m && x[i] <= y[j])) ? x[i] : y[j];
+    size_t ci = 0, cj = 0;
+    double first, t;
+    while (i + ci < m && x[i + ci] == v) ++ci;
+    while (j + cj < n && y[j + cj] == v) ++cj;
+    first = (double)(i + j) + 1;
+    t = (double)(ci + cj);
+    rank_x += ci * (first + (t - 1) / 2);
+    ties += t * t * t - t;
+    i += ci;
+    j += cj;
+  }
+
+  u = rank_x - m * (m + 1) / 2.0;
+  mu = m * (double)n / 2;
+  sigma = sqrt (m * (double)n / 12 * ((N + 1) - ties / (N * (N - 1))));
+  if (sigma <= 0) return 1;
+  z = (fabs (u - mu) - 0.5) / sigma; /* continuity correction */
+  if (z < 0) z = 0;
+  return erfc (z / sqrt (2.0));
+}
+
+/* ====================================================================== */
+
+int
+main (int argc, char* argv[])
+{
+  double threshold = DEFAULT_THRESHOLD, alpha = DEFAULT_ALPHA;
+  json_t base, next;
+  entry_t* E_base;
+  entry_t* E_next;
+  size_t n_base, n_next, i;
+  int opt, n_regressed = 0, n_improved = 0, n_compared = 0;
+
+  while ((opt = getopt (argc, argv, "a:t:")) != -1) {
+    if (opt == 'a')
+      alpha = atof (optarg);
+    else if (opt == 't')
+      threshold = atof (optarg);
+    else
+      argc = 0; /* print usage */
+  }
+  if (argc - optind != 2 || alpha <= 0 || alpha >= 1 || threshold < 0) {
+    fprintf (stderr, "usage: %s [-a <alpha>] [-t <threshold>] <baseline.json> <new.json>\n", argv[0]);
+    fprintf (stderr, "where -a is the significance level (default: %g), and\n", DEFAULT_ALPHA);
+    fprintf (stderr, "-t is the relative slow-down of the median that counts as a\n"
+	     "regression (default: %g).\n", DEFAULT_THRESHOLD);
+    fprintf (stderr, "Exits with 1 if any benchmark regressed, 2 on errors.\n");
+    return 2;
+  }
+
+  if (loadResults (argv[optind], &base) || loadResults (argv[optind+1], &next))
+    return 2;
+
+  printf ("baseline: %s, %s on %s (%s)\n", argv[optind], getString (&base, "program"),
+	  getString (getMember (&base, "host"), "name"), getString (&base, "date"));
+  printf ("new:      %s, %s on %s (%s)\n", argv[optind+1], getString (&next, "program"),
+	  getString (getMember (&next, "host"), "name"), getString (&next, "date"));
+  if (strcmp (getString (getMember (&base, "host"), "cpu"),
+	      getString (getMember (&next, "host"), "cpu")))
+    printf ("# note: the runs are on different CPUs\n");
+  if (strcmp (getString (getMember (&base, "build"), "flags"),
+	      getString (getMember (&next, "build"), "flags")))
+    printf ("# note: the runs have different build flags\n");
+
+  n_base = getEntries (&base, &E_base);
+  n_next = getEntries (&next, &E_next);
+
+  printf ("#benchmark\tbaseline (s)\tnew (s)\tchange\tp\tverdict\n");
+  for (i = 0; i < n_next; ++i) {
+    const entry_t* b = findEntry (E_base, n_base, E_next[i].key);
+    const entry_t* e = &E_next[i];
+    const char* verdict;
+    double change, p;
+    if (!b) {
+      printf ("%s\t-\t%g\t-\t-\tnew\n", e->key, e->median);
+      continue;
+    }
+    change = e->median / b->median - 1;
+    p = mannWhitney (b->times, b->n, e->times, e->n);
+    if (p >= alpha)
+      verdict = "same";
+    else if (change > threshold)
+      verdict = "REGRESSION", ++n_regressed;
+    else if (change < -threshold)
+      verdict = "improved", ++n_improved;
+    else
+      verdict = (change > 0) ? "slower" : "faster";
+    printf ("%s\t%g\t%g\t%+.1f%%\t%.3g\t%s\n",
+	    e->key, b->median, e->median, 100 * change, p, verdict);
+    ++n_compared;
+  }
+  for (i = 0; i < n_base; ++i)
+    if (!findEntry (E_next, n_next, E_base[i].key))
+      printf ("%s\t%g\t-\t-\t-\tmissing\n", E_base[i].key, E_base[i].median);
+
+  printf ("# %d compared: %d regression(s) above %.1f%%, %d improvement(s) (alpha = %g)\n",
+	  n_compared, n_regressed, 100 * threshold, n_improved, alpha);
+
+  for (i = 0; i < n_next; ++i) free (E_next[i].times);
+  for (i = 0; i < n_base; ++i) free (E_base[i].times);
+  free (E_next);
+  free (E_base);
+  freeJson (&next);
+  freeJson (&base);
+  return n_regressed ? 1 : 0;
+}
+
+/* eof */